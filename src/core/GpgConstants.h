@@ -42,6 +42,12 @@ constexpr int kSecBufferSizeForFile = 4 * 1024 * 1024;  // 4MB
 constexpr int kGpgFrontendDefaultChannel = 0;   ///<
 constexpr int kGpgFrontendNonAsciiChannel = 2;  ///<
 
+// GpgME
+constexpr int kGpgContextPoolMaxSize = 32;  ///< contexts per channel
+
+// Thread
+constexpr int kTaskRunnerMaxWorkers = 64;  ///< executor workers per runner
+
 // HEADER
 constexpr const char* PGP_CRYPT_BEGIN = "-----BEGIN PGP MESSAGE-----";  ///<
 constexpr const char* PGP_CRYPT_END = "-----END PGP MESSAGE-----";      ///<
@@ -29,15 +29,19 @@
 
 #include <gpgme.h>
 
+#include <algorithm>
+
 #include "core/function/CacheManager.h"
 #include "core/function/CoreSignalStation.h"
 #include "core/function/GlobalSettingStation.h"
+#include "core/function/SettingsObjectStore.h"
 #include "core/function/basic/ChannelObject.h"
 #include "core/function/basic/SingletonStorage.h"
 #include "core/function/gpg/GpgContext.h"
 #include "core/function/gpg/GpgKeyGetter.h"
 #include "core/module/ModuleManager.h"
 #include "core/thread/Task.h"
+#include "core/thread/TaskMetrics.h"
 #include "core/thread/TaskRunnerGetter.h"
 #include "core/utils/CommonUtils.h"
 #include "core/utils/GpgUtils.h"
@@ -50,6 +54,7 @@ void DestroyGpgFrontendCore() {
   Thread::TaskRunnerGetter::GetInstance().StopAllTeakRunner();
 
   CacheManager::GetInstance().FlushCacheStorage();
+  SettingsObjectStore::GetInstance().Flush();
 
   // destroy all singleton objects
   SingletonStorageCollection::Destroy();
@@ -462,6 +467,9 @@ auto InitGpgFrontendCore(CoreInitArgs args) -> int {
 
   Module::UpsertRTValue("core", "env.state.gpgme", 1);
 
+  // task metrics of the runners, readable through the register table
+  Thread::TaskMetrics::GetInstance().StartPublishing();
+
   // decide gpgconf, gnupg and default home path
   if (!InitBasicPath()) {
     LOG_E() << "Oops, Basic Path init failed!"
@@ -491,6 +499,16 @@ auto InitGpgFrontendCore(CoreInitArgs args) -> int {
   auto auto_import_missing_key =
       settings.value("network/auto_import_missing_key", false).toBool();
 
+  // gpgme contexts per channel used by parallel operations
+  auto context_pool_size = std::clamp(
+      settings
+          .value("gnupg/context_pool_size",
+                 std::min(QThread::idealThreadCount(), 8))
+          .toInt(),
+      1, kGpgContextPoolMaxSize);
+
+  LOG_D() << "gpgme context pool size:" << context_pool_size;
+
   // unit test mode
   if (args.unit_test_mode) {
     Module::UpsertRTValue("core", "env.state.basic", 1);
@@ -524,6 +542,7 @@ auto InitGpgFrontendCore(CoreInitArgs args) -> int {
 
         args.offline_mode = forbid_all_gnupg_connection;
         args.auto_import_missing_key = auto_import_missing_key;
+        args.context_pool_size = context_pool_size;
 
         LOG_D() << "gpgme default context at channel 0, key db name:"
                 << args.db_name << "key db path:" << args.db_path;
@@ -575,6 +594,7 @@ auto InitGpgFrontendCore(CoreInitArgs args) -> int {
 
                 args.offline_mode = forbid_all_gnupg_connection;
                 args.auto_import_missing_key = auto_import_missing_key;
+                args.context_pool_size = context_pool_size;
 
                 LOG_D() << "new gpgme context, channel" << channel_index
                         << ", key db name" << args.db_name << "key db path"
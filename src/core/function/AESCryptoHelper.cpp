@@ -32,6 +32,8 @@
 #include <openssl/evp.h>
 #include <openssl/kdf.h>
 
+#include <QtEndian>
+
 #include "core/function/SecureRandomGenerator.h"
 
 namespace {
@@ -362,6 +364,354 @@ auto DecryptImpl(const EVP_CIPHER* cipher, const GpgFrontend::GFBuffer& raw_key,
   return plaintext;
 }
 
+// stream format, integers are big endian:
+//
+//   header: magic(8) | version(1) | cipher(1) | chunk size(4) | salt(16)
+//           | nonce prefix(8)
+//   frame:  length and final flag(4) | ciphertext(length) | tag(16)
+//
+// a chunk uses the nonce prefix followed by its 32-bit index as iv and
+// the header, its 64-bit index and the final flag as aad, so chunks can't
+// be reordered, dropped, moved between streams or cut off at the end.
+constexpr std::array<char, GpgFrontend::AESCryptoHelper::kStreamMagicSize>
+    kStreamMagic = {'G', 'F', 'G', 'C', 'M', 'S', 'T', 'M'};
+constexpr quint8 kStreamVersion = 1;
+constexpr quint8 kStreamCipherAES128GCM = 1;
+constexpr quint8 kStreamCipherAES256GCM = 2;
+constexpr size_t kStreamSaltLen = 16;
+constexpr size_t kStreamNoncePrefixLen = 8;
+constexpr size_t kStreamIvLen = 12;
+constexpr size_t kStreamTagLen = 16;
+constexpr size_t kStreamHeaderLen =
+    kStreamMagic.size() + 1 + 1 + 4 + kStreamSaltLen + kStreamNoncePrefixLen;
+constexpr size_t kStreamAADLen = kStreamHeaderLen + 8 + 1;
+constexpr size_t kStreamMaxChunkSize = 16 * 1024 * 1024;
+constexpr quint64 kStreamMaxChunks = 0xFFFFFFFFULL;
+constexpr quint32 kStreamFinalFlag = 0x80000000U;
+
+using StreamAAD = std::array<unsigned char, kStreamAADLen>;
+using StreamIV = std::array<unsigned char, kStreamIvLen>;
+using CipherCtxPtr =
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+auto AsBytes(GpgFrontend::GFBuffer& buffer) -> std::byte* {
+  return reinterpret_cast<std::byte*>(buffer.Data());
+}
+
+auto AsUChars(GpgFrontend::GFBuffer& buffer) -> unsigned char* {
+  return reinterpret_cast<unsigned char*>(buffer.Data());
+}
+
+/**
+ * @brief read until size bytes are read or the source ends
+ *
+ */
+auto ReadFull(const GpgFrontend::GFStreamReader& in, std::byte* buffer,
+              size_t size) -> ssize_t {
+  size_t total = 0;
+  while (total < size) {
+    auto n = in(buffer + total, size - total);
+    if (n < 0) return -1;
+    if (n == 0) break;
+    total += static_cast<size_t>(n);
+  }
+  return static_cast<ssize_t>(total);
+}
+
+auto WriteFull(const GpgFrontend::GFStreamWriter& out, const std::byte* buffer,
+               size_t size) -> bool {
+  size_t total = 0;
+  while (total < size) {
+    auto n = out(buffer + total, size - total);
+    if (n <= 0) return false;
+    total += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+auto NewStreamCipherCtx(const EVP_CIPHER* cipher,
+                        const GpgFrontend::GFBuffer& key, bool encrypt)
+    -> CipherCtxPtr {
+  CipherCtxPtr ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+  if (ctx == nullptr) {
+    LOG_E() << "EVP_CIPHER_CTX_new failed";
+    return ctx;
+  }
+
+  const int enc = encrypt ? 1 : 0;
+  auto ok =
+      EVP_CipherInit_ex(ctx.get(), cipher, nullptr, nullptr, nullptr, enc) ==
+          1 &&
+      EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, kStreamIvLen,
+                          nullptr) == 1 &&
+      EVP_CipherInit_ex(ctx.get(), nullptr, nullptr,
+                        reinterpret_cast<const unsigned char*>(key.Data()),
+                        nullptr, enc) == 1;
+  if (!ok) {
+    LOG_E() << "failed to set up the cipher context of stream";
+    ctx.reset();
+  }
+  return ctx;
+}
+
+void SetStreamChunkPosition(StreamAAD& aad, StreamIV& iv, quint64 index,
+                            bool final) {
+  qToBigEndian<quint64>(index, aad.data() + kStreamHeaderLen);
+  aad[kStreamHeaderLen + 8] = final ? 1 : 0;
+  qToBigEndian<quint32>(static_cast<quint32>(index),
+                        iv.data() + kStreamNoncePrefixLen);
+}
+
+/**
+ * @brief encrypt len bytes of in into out, the tag is written right after
+ * the ciphertext
+ *
+ */
+auto SealStreamChunk(EVP_CIPHER_CTX* ctx, const StreamIV& iv,
+                     const StreamAAD& aad, const unsigned char* in, size_t len,
+                     unsigned char* out) -> bool {
+  int out_len = 0;
+  if (EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, iv.data()) != 1) {
+    return false;
+  }
+  if (EVP_EncryptUpdate(ctx, nullptr, &out_len, aad.data(),
+                        static_cast<int>(aad.size())) != 1) {
+    return false;
+  }
+  if (len > 0 && EVP_EncryptUpdate(ctx, out, &out_len, in,
+                                   static_cast<int>(len)) != 1) {
+    return false;
+  }
+  if (EVP_EncryptFinal_ex(ctx, out + len, &out_len) != 1) return false;
+
+  return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, kStreamTagLen,
+                             out + len) == 1;
+}
+
+/**
+ * @brief authenticate and decrypt len bytes of in followed by the tag
+ *
+ */
+auto OpenStreamChunk(EVP_CIPHER_CTX* ctx, const StreamIV& iv,
+                     const StreamAAD& aad, unsigned char* in, size_t len,
+                     unsigned char* out) -> bool {
+  int out_len = 0;
+  if (EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, iv.data()) != 1) {
+    return false;
+  }
+  if (EVP_DecryptUpdate(ctx, nullptr, &out_len, aad.data(),
+                        static_cast<int>(aad.size())) != 1) {
+    return false;
+  }
+  if (len > 0 && EVP_DecryptUpdate(ctx, out, &out_len, in,
+                                   static_cast<int>(len)) != 1) {
+    return false;
+  }
+  if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, kStreamTagLen,
+                          in + len) != 1) {
+    return false;
+  }
+  return EVP_DecryptFinal_ex(ctx, out + len, &out_len) == 1;
+}
+
+auto EncryptStreamImpl(const EVP_CIPHER* cipher, quint8 cipher_id,
+                       const GpgFrontend::GFBuffer& raw_key,
+                       const GpgFrontend::GFStreamReader& in,
+                       const GpgFrontend::GFStreamWriter& out,
+                       size_t chunk_size) -> bool {
+  if (chunk_size == 0 || chunk_size > kStreamMaxChunkSize) {
+    LOG_E() << "invalid chunk size of stream: " << chunk_size;
+    return false;
+  }
+
+  auto salt = GpgFrontend::SecureRandomGenerator::OpenSSLGenerate(
+      kStreamSaltLen);
+  auto nonce_prefix = GpgFrontend::SecureRandomGenerator::OpenSSLGenerate(
+      kStreamNoncePrefixLen);
+  if (!salt || !nonce_prefix) return false;
+
+  auto key = DeriveKeyArgon2(raw_key, *salt, EVP_CIPHER_key_length(cipher));
+  if (!key) return false;
+
+  auto ctx = NewStreamCipherCtx(cipher, *key, true);
+  if (ctx == nullptr) return false;
+
+  // the header is the leading part of every chunk's aad
+  StreamAAD aad{};
+  auto* p = aad.data();
+  memcpy(p, kStreamMagic.data(), kStreamMagic.size());
+  p += kStreamMagic.size();
+  *p++ = kStreamVersion;
+  *p++ = cipher_id;
+  qToBigEndian<quint32>(static_cast<quint32>(chunk_size), p);
+  p += 4;
+  memcpy(p, salt->Data(), kStreamSaltLen);
+  p += kStreamSaltLen;
+  memcpy(p, nonce_prefix->Data(), kStreamNoncePrefixLen);
+
+  StreamIV iv{};
+  memcpy(iv.data(), nonce_prefix->Data(), kStreamNoncePrefixLen);
+
+  if (!WriteFull(out, reinterpret_cast<const std::byte*>(aad.data()),
+                 kStreamHeaderLen)) {
+    LOG_E() << "failed to write the header of stream";
+    return false;
+  }
+
+  GpgFrontend::GFBuffer current(chunk_size);
+  GpgFrontend::GFBuffer next(chunk_size);
+  GpgFrontend::GFBuffer sealed(chunk_size + kStreamTagLen);
+
+  auto current_len = ReadFull(in, AsBytes(current), chunk_size);
+  if (current_len < 0) {
+    LOG_E() << "failed to read plaintext of stream";
+    return false;
+  }
+
+  for (quint64 index = 0; index <= kStreamMaxChunks; index++) {
+    // read one chunk ahead to know whether the current one is the last,
+    // a short chunk is always the last one
+    ssize_t next_len = 0;
+    if (static_cast<size_t>(current_len) == chunk_size) {
+      next_len = ReadFull(in, AsBytes(next), chunk_size);
+      if (next_len < 0) {
+        LOG_E() << "failed to read plaintext of stream";
+        return false;
+      }
+    }
+
+    const bool final = next_len == 0;
+    const auto len = static_cast<size_t>(current_len);
+
+    SetStreamChunkPosition(aad, iv, index, final);
+    if (!SealStreamChunk(ctx.get(), iv, aad, AsUChars(current), len,
+                         AsUChars(sealed))) {
+      LOG_E() << "failed to encrypt chunk of stream: " << index;
+      return false;
+    }
+
+    std::array<std::byte, 4> frame;
+    qToBigEndian<quint32>(
+        static_cast<quint32>(len) | (final ? kStreamFinalFlag : 0),
+        frame.data());
+    if (!WriteFull(out, frame.data(), frame.size()) ||
+        !WriteFull(out, AsBytes(sealed), len + kStreamTagLen)) {
+      LOG_E() << "failed to write chunk of stream: " << index;
+      return false;
+    }
+
+    if (final) return true;
+
+    std::swap(current, next);
+    current_len = next_len;
+  }
+
+  LOG_E() << "plaintext is too long for the stream format";
+  return false;
+}
+
+auto DecryptStreamImpl(const GpgFrontend::GFBuffer& raw_key,
+                       const GpgFrontend::GFStreamReader& in,
+                       const GpgFrontend::GFStreamWriter& out) -> bool {
+  StreamAAD aad{};
+  auto n = ReadFull(in, reinterpret_cast<std::byte*>(aad.data()),
+                    kStreamHeaderLen);
+  if (n != static_cast<ssize_t>(kStreamHeaderLen) ||
+      memcmp(aad.data(), kStreamMagic.data(), kStreamMagic.size()) != 0) {
+    LOG_E() << "data is not an aes gcm stream";
+    return false;
+  }
+
+  const auto* p = aad.data() + kStreamMagic.size();
+  const auto version = *p++;
+  const auto cipher_id = *p++;
+  const auto chunk_size = static_cast<size_t>(qFromBigEndian<quint32>(p));
+  p += 4;
+
+  if (version != kStreamVersion) {
+    LOG_E() << "unsupported version of stream: " << version;
+    return false;
+  }
+
+  const EVP_CIPHER* cipher = nullptr;
+  if (cipher_id == kStreamCipherAES128GCM) cipher = EVP_aes_128_gcm();
+  if (cipher_id == kStreamCipherAES256GCM) cipher = EVP_aes_256_gcm();
+  if (cipher == nullptr) {
+    LOG_E() << "unsupported cipher of stream: " << cipher_id;
+    return false;
+  }
+
+  if (chunk_size == 0 || chunk_size > kStreamMaxChunkSize) {
+    LOG_E() << "invalid chunk size of stream: " << chunk_size;
+    return false;
+  }
+
+  GpgFrontend::GFBuffer salt(reinterpret_cast<const char*>(p),
+                             kStreamSaltLen);
+  p += kStreamSaltLen;
+
+  StreamIV iv{};
+  memcpy(iv.data(), p, kStreamNoncePrefixLen);
+
+  auto key = DeriveKeyArgon2(raw_key, salt, EVP_CIPHER_key_length(cipher));
+  if (!key) return false;
+
+  auto ctx = NewStreamCipherCtx(cipher, *key, false);
+  if (ctx == nullptr) return false;
+
+  GpgFrontend::GFBuffer sealed(chunk_size + kStreamTagLen);
+  GpgFrontend::GFBuffer plaintext(chunk_size);
+
+  for (quint64 index = 0; index <= kStreamMaxChunks; index++) {
+    std::array<std::byte, 4> frame;
+    if (ReadFull(in, frame.data(), frame.size()) !=
+        static_cast<ssize_t>(frame.size())) {
+      LOG_E() << "stream is truncated before chunk: " << index;
+      return false;
+    }
+
+    const auto word = qFromBigEndian<quint32>(frame.data());
+    const bool final = (word & kStreamFinalFlag) != 0;
+    const auto len = static_cast<size_t>(word & ~kStreamFinalFlag);
+
+    // only the last chunk may be shorter than the chunk size
+    if (len > chunk_size || (!final && len != chunk_size)) {
+      LOG_E() << "invalid length of chunk: " << index;
+      return false;
+    }
+
+    if (ReadFull(in, AsBytes(sealed), len + kStreamTagLen) !=
+        static_cast<ssize_t>(len + kStreamTagLen)) {
+      LOG_E() << "stream is truncated in chunk: " << index;
+      return false;
+    }
+
+    SetStreamChunkPosition(aad, iv, index, final);
+    if (!OpenStreamChunk(ctx.get(), iv, aad, AsUChars(sealed), len,
+                         AsUChars(plaintext))) {
+      LOG_E() << "authentication of chunk failed: " << index;
+      return false;
+    }
+
+    if (len > 0 && !WriteFull(out, AsBytes(plaintext), len)) {
+      LOG_E() << "failed to write plaintext of chunk: " << index;
+      return false;
+    }
+
+    if (!final) continue;
+
+    std::byte trailing;
+    if (ReadFull(in, &trailing, 1) != 0) {
+      LOG_E() << "unexpected data after the last chunk of stream";
+      return false;
+    }
+    return true;
+  }
+
+  LOG_E() << "stream has too many chunks";
+  return false;
+}
+
 }  // namespace
 
 namespace GpgFrontend {
@@ -389,4 +739,27 @@ auto AESCryptoHelper::GCMDecryptLite(const GpgFrontend::GFBuffer& raw_key,
   return DecryptImpl(EVP_aes_128_gcm(), raw_key, encrypted);
 }
 
+auto AESCryptoHelper::GCMEncryptStream(const GpgFrontend::GFBuffer& raw_key,
+                                       const GFStreamReader& in,
+                                       const GFStreamWriter& out, bool lite,
+                                       size_t chunk_size) -> bool {
+  if (lite) {
+    return EncryptStreamImpl(EVP_aes_128_gcm(), kStreamCipherAES128GCM,
+                             raw_key, in, out, chunk_size);
+  }
+  return EncryptStreamImpl(EVP_aes_256_gcm(), kStreamCipherAES256GCM, raw_key,
+                           in, out, chunk_size);
+}
+
+auto AESCryptoHelper::GCMDecryptStream(const GpgFrontend::GFBuffer& raw_key,
+                                       const GFStreamReader& in,
+                                       const GFStreamWriter& out) -> bool {
+  return DecryptStreamImpl(raw_key, in, out);
+}
+
+auto AESCryptoHelper::IsGCMStream(const GpgFrontend::GFBuffer& head) -> bool {
+  return head.Size() >= kStreamMagic.size() &&
+         memcmp(head.Data(), kStreamMagic.data(), kStreamMagic.size()) == 0;
+}
+
 }  // namespace GpgFrontend
@@ -30,6 +30,7 @@
 
 #include "core/function/basic/GpgFunctionObject.h"
 #include "core/model/GFBuffer.h"
+#include "core/typedef/CoreTypedef.h"
 
 namespace GpgFrontend {
 
@@ -53,5 +54,55 @@ class GF_CORE_EXPORT AESCryptoHelper
   static auto GCMDecryptLite(const GpgFrontend::GFBuffer& raw_key,
                              const GpgFrontend::GFBuffer& encrypted)
       -> GFBufferOrNone;
+
+  /**
+   * @brief default size of a plaintext chunk in the stream format
+   *
+   */
+  static constexpr size_t kStreamChunkSize = 64 * 1024;
+
+  /**
+   * @brief length of the magic that starts the stream format
+   *
+   */
+  static constexpr size_t kStreamMagicSize = 8;
+
+  /**
+   * @brief encrypt a stream of any length into a framed sequence of
+   * authenticated chunks. At most two plaintext chunks are held in memory.
+   *
+   * @param raw_key passphrase the key is derived from
+   * @param in plaintext source
+   * @param out ciphertext sink
+   * @param lite use AES-128-GCM instead of AES-256-GCM
+   * @param chunk_size plaintext bytes per chunk
+   * @return true on success
+   */
+  static auto GCMEncryptStream(const GpgFrontend::GFBuffer& raw_key,
+                               const GFStreamReader& in,
+                               const GFStreamWriter& out, bool lite = false,
+                               size_t chunk_size = kStreamChunkSize) -> bool;
+
+  /**
+   * @brief decrypt a stream written by GCMEncryptStream(). Every chunk is
+   * authenticated before it is written to the sink; on failure the sink
+   * may already hold a verified prefix and should be discarded.
+   *
+   * @param raw_key passphrase the key is derived from
+   * @param in ciphertext source
+   * @param out plaintext sink
+   * @return true if the whole stream was authenticated
+   */
+  static auto GCMDecryptStream(const GpgFrontend::GFBuffer& raw_key,
+                               const GFStreamReader& in,
+                               const GFStreamWriter& out) -> bool;
+
+  /**
+   * @brief check whether data starts with the magic of the stream format
+   *
+   * @param head at least kStreamMagicSize bytes of the data
+   * @return true if it is a stream
+   */
+  static auto IsGCMStream(const GpgFrontend::GFBuffer& head) -> bool;
 };
 }  // namespace GpgFrontend
\ No newline at end of file
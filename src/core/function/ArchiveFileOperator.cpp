@@ -32,46 +32,720 @@
 #include <archive_entry.h>
 #include <sys/fcntl.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/function/GlobalSettingStation.h"
+#include "core/thread/CancellationToken.h"
 #include "core/thread/TaskRunnerGetter.h"
 #include "core/utils/AsyncUtils.h"
 
 namespace {
-auto CopyData(struct archive *ar, struct archive *aw) -> int {
-  int r;
-  const void *buff;
-  size_t size;
-  int64_t offset;
 
-  for (;;) {
-    r = archive_read_data_block(ar, &buff, &size, &offset);
-    if (r == ARCHIVE_EOF) return (ARCHIVE_OK);
+constexpr qint64 kArchiveChunkSize = 1024 * 1024;  // 1MB per read
+constexpr qint64 kArchiveBufferedLimit =
+    static_cast<qint64>(64) * 1024 * 1024;  // 64MB between the stages
+
+/**
+ * @brief threads reading files for, or writing files from, an archive
+ *
+ */
+auto ArchiveWorkerCount() -> int {
+  return std::clamp(QThread::idealThreadCount(), 2, 8);
+}
+
+/**
+ * @brief put the configured compression filter in front of the writer,
+ * falling back to a plain tar stream if libarchive can't provide it
+ *
+ * A failed filter may be left half set up in the writer, so the fallback
+ * replaces the writer with a fresh one. A warning, e.g. gzip running as an
+ * external program, still counts as applied.
+ *
+ * @param archive the writer, replaced on fallback
+ * @param compression
+ * @return the filter actually in front of the writer
+ */
+auto AddCompressionFilter(struct archive *&archive,
+                          const GpgFrontend::ArchiveCompression &compression)
+    -> GpgFrontend::ArchiveCompression::Filter {
+  using GpgFrontend::ArchiveCompression;
+
+  const char *name = nullptr;
+  int r = ARCHIVE_OK;
+  switch (compression.filter) {
+    case ArchiveCompression::kFilter_Gzip:
+      name = "gzip";
+      r = archive_write_add_filter_gzip(archive);
+      break;
+    case ArchiveCompression::kFilter_Zstd:
+      name = "zstd";
+      r = archive_write_add_filter_zstd(archive);
+      break;
+    default:
+      archive_write_add_filter_none(archive);
+      return ArchiveCompression::kFilter_None;
+  }
+
+  if (r < ARCHIVE_WARN) {
+    FLOG_W("cannot add %s filter, ret: %d, reason: %s, writing plain tar",
+           name, r, archive_error_string(archive));
+    archive_write_free(archive);
+    archive = archive_write_new();
+    archive_write_add_filter_none(archive);
+    return ArchiveCompression::kFilter_None;
+  }
+
+  if (r != ARCHIVE_OK) {
+    FLOG_W("%s filter added with a warning, reason: %s", name,
+           archive_error_string(archive));
+  }
+
+  if (compression.level != 0) {
+    const auto level = QString::number(compression.level).toLatin1();
+    r = archive_write_set_filter_option(archive, name, "compression-level",
+                                        level.constData());
     if (r != ARCHIVE_OK) {
-      LOG_W() << "archive_read_data_block() failed: "
-              << archive_error_string(ar);
-      return (r);
+      FLOG_W("%s rejects compression level %d, reason: %s", name,
+             compression.level, archive_error_string(archive));
     }
-    r = archive_write_data_block(aw, buff, size, offset);
+  }
+
+  if (compression.filter == ArchiveCompression::kFilter_Zstd) {
+    const auto threads =
+        QString::number(compression.threads > 0 ? compression.threads
+                                                : QThread::idealThreadCount())
+            .toLatin1();
+    r = archive_write_set_filter_option(archive, name, "threads",
+                                        threads.constData());
     if (r != ARCHIVE_OK) {
-      LOG_W() << "archive_write_data_block() failed: "
-              << archive_error_string(aw);
-      return (r);
+      FLOG_W("zstd filter runs single threaded, reason: %s",
+             archive_error_string(archive));
     }
   }
+
+  return compression.filter;
 }
+
+/**
+ * @brief archives a directory in three stages: a scanner walking the tree,
+ * readers loading the files in parallel, and the calling thread writing the
+ * entries to the archive in the order they were found. Only the file being
+ * written may take the data buffered between the stages past the limit.
+ *
+ */
+class ArchiveWritePipeline {
+ public:
+  ArchiveWritePipeline(QString target_directory, struct archive *archive)
+      : target_directory_(std::move(target_directory)),
+        base_path_(QDir(target_directory_).absolutePath()),
+        archive_(archive) {}
+
+  auto Run() -> int {
+    std::thread scanner([this]() { scan(); });
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < ArchiveWorkerCount(); i++) {
+      readers.emplace_back([this]() { read(); });
+    }
+
+    auto ret = write();
+
+    abort();
+    scanner.join();
+    for (auto &reader : readers) reader.join();
+
+    return ret != 0 ? ret : scan_ret_;
+  }
+
+ private:
+  enum ItemState {
+    kItemState_Pending,
+    kItemState_Readable,
+    kItemState_Unreadable,
+  };
+
+  struct Item {
+    struct archive_entry *entry;
+    QString source_path;
+    ItemState state = kItemState_Pending;
+    bool done = false;  ///< all chunks are queued
+    std::deque<QByteArray> chunks;
+
+    Item(struct archive_entry *entry, QString source_path)
+        : entry(entry), source_path(std::move(source_path)) {}
+
+    ~Item() { archive_entry_free(entry); }
+  };
+
+  const QString target_directory_;
+  const QDir base_path_;
+  struct archive *archive_;
+
+  std::mutex lock_;
+  std::condition_variable changed_;
+  std::vector<std::unique_ptr<Item>> items_;
+  size_t next_read_ = 0;
+  size_t writing_ = 0;
+  qint64 buffered_ = 0;
+  bool scanned_ = false;
+  bool aborted_ = false;
+  int scan_ret_ = 0;
+
+  void abort() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      aborted_ = true;
+    }
+    changed_.notify_all();
+  }
+
+  void scan() {
+    auto ret = 0;
+    auto *disk = archive_read_disk_new();
+    archive_read_disk_set_standard_lookup(disk);
+
+#ifdef Q_OS_WINDOWS
+    auto target_directory_utf16_wstr = std::wstring(
+        reinterpret_cast<const wchar_t *>((target_directory_).utf16()));
+    auto r =
+        archive_read_disk_open_w(disk, target_directory_utf16_wstr.c_str());
+#else
+    auto r = archive_read_disk_open(disk, target_directory_.toUtf8());
+#endif
+
+    if (r != ARCHIVE_OK) {
+      FLOG_W("archive_read_disk_open() failed: %s, abort...",
+             archive_error_string(disk));
+      ret = -1;
+    }
+
+    while (ret == 0) {
+      auto *entry = archive_entry_new();
+      r = archive_read_next_header2(disk, entry);
+      if (r == ARCHIVE_EOF) {
+        archive_entry_free(entry);
+        break;
+      }
+      if (r != ARCHIVE_OK) {
+        FLOG_W("archive_read_next_header2() failed, ret: %d, explain: %s", r,
+               archive_error_string(disk));
+        archive_entry_free(entry);
+        ret = -1;
+        break;
+      }
+
+      archive_read_disk_descend(disk);
+
+#ifdef Q_OS_WINDOWS
+      auto source_path = QString::fromUtf16(
+          reinterpret_cast<const char16_t *>(archive_entry_pathname_w(entry)));
+#else
+      auto source_path = QString::fromUtf8(archive_entry_pathname(entry));
+#endif
+
+      // turn absolute path to relative path
+      auto relativ_path_name = base_path_.relativeFilePath(source_path);
+      archive_entry_set_pathname(entry, relativ_path_name.toUtf8());
+
+#ifdef Q_OS_WINDOWS
+      auto source_path_utf16_wstr =
+          std::wstring(reinterpret_cast<const wchar_t *>(source_path.utf16()));
+      archive_entry_copy_sourcepath_w(entry, source_path_utf16_wstr.c_str());
+#else
+      archive_entry_copy_sourcepath(entry, source_path.toUtf8());
+#endif
+
+      {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (aborted_) {
+          archive_entry_free(entry);
+          break;
+        }
+        items_.push_back(std::make_unique<Item>(entry, source_path));
+      }
+      changed_.notify_all();
+    }
+
+    archive_read_free(disk);
+
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      scanned_ = true;
+      scan_ret_ = ret;
+    }
+    changed_.notify_all();
+  }
+
+  void read() {
+    for (;;) {
+      size_t index;
+      Item *item;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        changed_.wait(lock, [this]() {
+          return next_read_ < items_.size() || scanned_ || aborted_;
+        });
+        if (aborted_ || next_read_ >= items_.size()) return;
+        index = next_read_++;
+        item = items_[index].get();
+      }
+
+      QFile file(item->source_path);
+      const auto readable = file.open(QIODevice::ReadOnly);
+      {
+        std::lock_guard<std::mutex> lock(lock_);
+        item->state = readable ? kItemState_Readable : kItemState_Unreadable;
+        item->done = !readable;
+      }
+      changed_.notify_all();
+      if (!readable) continue;
+
+      for (;;) {
+        // small files are read in one go, without a chunk sized allocation
+        auto chunk = file.read(
+            std::clamp(file.size() - file.pos(), qint64(1), kArchiveChunkSize));
+
+        std::unique_lock<std::mutex> lock(lock_);
+        if (chunk.isEmpty()) {
+          if (file.error() != QFileDevice::NoError) {
+            LOG_W() << "failed to read file:" << item->source_path
+                    << "error:" << file.errorString();
+          }
+          item->done = true;
+          lock.unlock();
+          changed_.notify_all();
+          break;
+        }
+
+        changed_.wait(lock, [=]() {
+          return buffered_ < kArchiveBufferedLimit || index == writing_ ||
+                 aborted_;
+        });
+        if (aborted_) return;
+
+        buffered_ += chunk.size();
+        item->chunks.push_back(std::move(chunk));
+        lock.unlock();
+        changed_.notify_all();
+      }
+    }
+  }
+
+  auto write() -> int {
+    const auto token = GpgFrontend::Thread::CancellationToken::Current();
+
+    for (size_t index = 0;; index++) {
+      Item *item;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        changed_.wait(lock, [=]() {
+          return index < items_.size() || scanned_ || aborted_;
+        });
+        if (aborted_ || index >= items_.size()) return 0;
+
+        // let the reader of this item past the limit
+        writing_ = index;
+        changed_.notify_all();
+
+        item = items_[index].get();
+        changed_.wait(lock, [=]() {
+          return item->state != kItemState_Pending || aborted_;
+        });
+      }
+
+      if (token.IsCanceled()) {
+        FLOG_W("archive creation was canceled, abort...");
+        return -1;
+      }
+
+      // e.g. directories, their files bring them back on extraction
+      if (item->state == kItemState_Unreadable) {
+        release(index);
+        continue;
+      }
+
+      auto r = archive_write_header(archive_, item->entry);
+      if (r == ARCHIVE_FATAL) {
+        FLOG_W("archive_write_header() failed, ret: %d, explain: %s, abort ...",
+               r, archive_error_string(archive_));
+        return -1;
+      }
+      if (r < ARCHIVE_OK) {
+        FLOG_W("archive_write_header() failed, ret: %d, explain: %s", r,
+               archive_error_string(archive_));
+      }
+
+      for (;;) {
+        QByteArray chunk;
+        {
+          std::unique_lock<std::mutex> lock(lock_);
+          changed_.wait(lock, [=]() {
+            return !item->chunks.empty() || item->done || aborted_;
+          });
+          if (aborted_ || item->chunks.empty()) break;
+
+          chunk = std::move(item->chunks.front());
+          item->chunks.pop_front();
+          buffered_ -= chunk.size();
+        }
+        changed_.notify_all();
+
+        if (r > ARCHIVE_FAILED &&
+            archive_write_data(archive_, chunk.constData(), chunk.size()) < 0) {
+          FLOG_W("archive_write_data() failed, explain: %s, abort ...",
+                 archive_error_string(archive_));
+          return -1;
+        }
+      }
+
+      archive_write_finish_entry(archive_);
+      release(index);
+    }
+  }
+
+  void release(size_t index) {
+    std::lock_guard<std::mutex> lock(lock_);
+    items_[index].reset();
+  }
+};
+
+/**
+ * @brief extracts an archive read by the calling thread with several
+ * writers, each entry is written to disk by one of them while the next
+ * entries are read. Entries under the same top level path go to the same
+ * writer as long as one of them is pending, so an entry and the entries
+ * below or replacing it are written in archive order. Hard links wait for
+ * the entries before them, their targets have to exist, and an entry for
+ * the extraction root is written with no other entry pending.
+ *
+ */
+class ArchiveExtractPipeline {
+ public:
+  ArchiveExtractPipeline(struct archive *archive, QString target_path)
+      : archive_(archive),
+        target_path_(std::move(target_path)),
+        writers_(ArchiveWorkerCount()) {}
+
+  auto Run() -> int {
+    std::vector<std::thread> threads;
+    for (auto &writer : writers_) {
+      threads.emplace_back([this, &writer]() { write(writer); });
+    }
+
+    auto ret = read();
+
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      finished_ = true;
+      if (ret != 0) aborted_ = true;
+    }
+    changed_.notify_all();
+    for (auto &thread : threads) thread.join();
+
+    return ret != 0 ? ret : write_ret_;
+  }
+
+ private:
+  struct Job {
+    struct archive_entry *entry;
+    QString key;  ///< top level path, empty for the extraction root
+    std::deque<std::pair<la_int64_t, QByteArray>> chunks;
+    bool done = false;  ///< all chunks are queued
+
+    Job(struct archive_entry *entry, QString key)
+        : entry(entry), key(std::move(key)) {}
+
+    ~Job() { archive_entry_free(entry); }
+  };
+
+  struct Writer {
+    std::deque<std::shared_ptr<Job>> jobs;
+    int pending = 0;  ///< jobs queued or being written
+  };
+
+  struct Route {
+    size_t writer;
+    int pending;
+  };
+
+  struct archive *archive_;
+  const QString target_path_;
+
+  std::mutex lock_;
+  std::condition_variable changed_;
+  std::vector<Writer> writers_;
+  QHash<QString, Route> routes_;
+  int pending_ = 0;
+  qint64 buffered_ = 0;
+  bool finished_ = false;
+  bool aborted_ = false;
+  int write_ret_ = 0;
+
+  /**
+   * @brief the first component of an entry path, two entries of which one
+   * is the other or below it always share it
+   *
+   */
+  static auto RouteKey(const QString &path_name) -> QString {
+    auto path = QDir::cleanPath(path_name);
+    while (path.startsWith('/')) path.remove(0, 1);
+    if (path == ".") return {};
+    return path.section('/', 0, 0);
+  }
+
+  auto read() -> int {
+    const auto token = GpgFrontend::Thread::CancellationToken::Current();
+
+    for (;;) {
+      if (token.IsCanceled()) {
+        FLOG_W("archive extraction was canceled, abort...");
+        return -1;
+      }
+
+      struct archive_entry *entry;
+      auto r = archive_read_next_header(archive_, &entry);
+      if (r == ARCHIVE_EOF) return 0;
+      if (r != ARCHIVE_OK) {
+        FLOG_W("archive_read_next_header(), ret: %d, reason: %s", r,
+               archive_error_string(archive_));
+        return r;
+      }
+
+      auto path_name = QString::fromUtf8(archive_entry_pathname(entry));
+      auto target_path_name = target_path_ + "/" + path_name;
+
+#ifdef Q_OS_WINDOWS
+      auto target_path_utf16_wstr = std::wstring(
+          reinterpret_cast<const wchar_t *>((target_path_name).utf16()));
+      archive_entry_copy_pathname_w(entry, target_path_utf16_wstr.c_str());
+#else
+      archive_entry_set_pathname(entry, target_path_name.toUtf8());
+#endif
+
+      auto job = std::make_shared<Job>(archive_entry_clone(entry),
+                                       RouteKey(path_name));
+      const auto barrier =
+          job->key.isEmpty() || archive_entry_hardlink(entry) != nullptr;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        if (barrier) {
+          changed_.wait(lock, [this]() { return pending_ == 0 || aborted_; });
+        }
+        if (aborted_) return -1;
+        dispatch(job);
+      }
+      changed_.notify_all();
+
+      if (!read_data(job)) return -1;
+
+      // the root entry may change what the entries below it land in
+      if (job->key.isEmpty()) {
+        std::unique_lock<std::mutex> lock(lock_);
+        changed_.wait(lock, [this]() { return pending_ == 0 || aborted_; });
+      }
+    }
+  }
+
+  /**
+   * @brief queue a job on the writer of its key, or on the least busy one
+   * if no job with that key is pending. Called with lock_ held.
+   *
+   */
+  void dispatch(const std::shared_ptr<Job> &job) {
+    auto it = routes_.find(job->key);
+    if (it == routes_.end()) {
+      size_t writer = 0;
+      for (size_t i = 1; i < writers_.size(); i++) {
+        if (writers_[i].pending < writers_[writer].pending) writer = i;
+      }
+      it = routes_.insert(job->key, Route{writer, 0});
+    }
+
+    it->pending++;
+    auto &writer = writers_[it->writer];
+    writer.jobs.push_back(job);
+    writer.pending++;
+    pending_++;
+  }
+
+  void complete(Writer &writer, const Job &job) {
+    std::lock_guard<std::mutex> lock(lock_);
+    writer.pending--;
+    pending_--;
+    auto it = routes_.find(job.key);
+    if (--it->pending == 0) routes_.erase(it);
+  }
+
+  void fail(int ret) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (write_ret_ == 0) write_ret_ = ret;
+  }
+
+  auto read_data(const std::shared_ptr<Job> &job) -> bool {
+    for (;;) {
+      const void *buff;
+      size_t size;
+      la_int64_t offset;
+
+      auto r = archive_read_data_block(archive_, &buff, &size, &offset);
+      if (r != ARCHIVE_OK) {
+        if (r != ARCHIVE_EOF) {
+          LOG_W() << "archive_read_data_block() failed: "
+                  << archive_error_string(archive_);
+        }
+        break;
+      }
+
+      QByteArray chunk(static_cast<const char *>(buff),
+                       static_cast<qsizetype>(size));
+
+      std::unique_lock<std::mutex> lock(lock_);
+      changed_.wait(lock, [this]() {
+        return buffered_ < kArchiveBufferedLimit || aborted_;
+      });
+      if (aborted_) return false;
+
+      buffered_ += chunk.size();
+      job->chunks.emplace_back(offset, std::move(chunk));
+      lock.unlock();
+      changed_.notify_all();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      job->done = true;
+    }
+    changed_.notify_all();
+    return true;
+  }
+
+  void write(Writer &writer) {
+    auto *ext = archive_write_disk_new();
+    auto r = archive_write_disk_set_options(ext, 0);
+    if (r != ARCHIVE_OK) {
+      FLOG_W("archive_write_disk_set_options(), ret: %d, reason: %s", r,
+             archive_error_string(ext));
+    }
+
+    for (;;) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        changed_.wait(lock, [&]() {
+          return !writer.jobs.empty() || finished_ || aborted_;
+        });
+        if (aborted_ || writer.jobs.empty()) break;
+
+        job = writer.jobs.front();
+        writer.jobs.pop_front();
+      }
+
+      write_job(ext, *job);
+      complete(writer, *job);
+      changed_.notify_all();
+    }
+
+    r = archive_write_free(ext);
+    if (r != ARCHIVE_OK) {
+      FLOG_W("archive_write_free(), ret: %d", r);
+    }
+  }
+
+  void write_job(struct archive *ext, Job &job) {
+    auto r = archive_write_header(ext, job.entry);
+    if (r != ARCHIVE_OK) {
+      FLOG_W("archive_write_header(), ret: %d, reason: %s", r,
+             archive_error_string(ext));
+    }
+    if (r < ARCHIVE_WARN) fail(r);
+
+    for (;;) {
+      std::pair<la_int64_t, QByteArray> chunk;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        changed_.wait(lock, [&]() {
+          return !job.chunks.empty() || job.done || aborted_;
+        });
+        if (aborted_ || job.chunks.empty()) break;
+
+        chunk = std::move(job.chunks.front());
+        job.chunks.pop_front();
+        buffered_ -= chunk.second.size();
+      }
+      changed_.notify_all();
+
+      if (r != ARCHIVE_OK) continue;
+      r = archive_write_data_block(ext, chunk.second.constData(),
+                                   chunk.second.size(), chunk.first);
+      if (r != ARCHIVE_OK) {
+        LOG_W() << "archive_write_data_block() failed: "
+                << archive_error_string(ext);
+      }
+      if (r < ARCHIVE_WARN) fail(r);
+    }
+
+    r = archive_write_finish_entry(ext);
+    if (r < ARCHIVE_WARN) {
+      FLOG_W("archive_write_finish_entry(), ret: %d, reason: %s", r,
+             archive_error_string(ext));
+      fail(r);
+    }
+  }
+};
+
 }  // namespace
 
 namespace GpgFrontend {
 
+auto ArchiveCompression::FromSettings() -> ArchiveCompression {
+  auto settings = GetSettings();
+
+  ArchiveCompression compression;
+  const auto filter =
+      settings.value("archive/compression", "none").toString().toLower();
+  if (filter == "gzip") {
+    compression.filter = kFilter_Gzip;
+    compression.level = std::clamp(
+        settings.value("archive/compression_level", 0).toInt(), 0, 9);
+  } else if (filter == "zstd") {
+    compression.filter = kFilter_Zstd;
+    compression.level = std::clamp(
+        settings.value("archive/compression_level", 0).toInt(), 0, 19);
+  }
+  compression.threads = std::clamp(
+      settings.value("archive/compression_threads", 0).toInt(), 0, 64);
+  return compression;
+}
+
+auto ArchiveCompression::IsEnabled() const -> bool {
+  return filter != kFilter_None;
+}
+
+auto ArchiveCompression::Applied() const -> ArchiveCompression {
+  if (!IsEnabled()) return *this;
+
+  // adding a filter doesn't start it, a scratch writer tells whether
+  // libarchive was built with it
+  auto *archive = archive_write_new();
+  auto applied = *this;
+  applied.filter = AddCompressionFilter(archive, *this);
+  archive_write_free(archive);
+  return applied;
+}
+
 struct ArchiveReadClientData {
   GFDataExchanger *ex;
-  std::array<std::byte, 1024> buf;
-  const std::byte *p_buf = buf.data();
+  std::vector<std::byte> buf = std::vector<std::byte>(kArchiveChunkSize);
 };
 
 auto ArchiveReadCallback(struct archive *, void *client_data,
                          const void **buffer) -> ssize_t {
   auto *rdata = static_cast<ArchiveReadClientData *>(client_data);
-  *buffer = reinterpret_cast<const void *>(rdata->p_buf);
+  *buffer = reinterpret_cast<const void *>(rdata->buf.data());
   return rdata->ex->Read(rdata->buf.data(), rdata->buf.size());
 }
 
@@ -90,109 +764,25 @@ auto ArchiveCloseWriteCallback(struct archive *, void *client_data) -> int {
 void ArchiveFileOperator::NewArchive2DataExchanger(
     const QString &target_directory,
     const QSharedPointer<GFDataExchanger> &exchanger,
-    const OperationCallback &cb) {
+    const OperationCallback &cb, const ArchiveCompression &compression) {
   auto *task = new Thread::Task{
       [=](const DataObjectPtr &) -> int {
-        auto ret = 0;
-        const auto base_path = QDir(QDir(target_directory).absolutePath());
-
+        // a writer the filter failed on is replaced by a fresh one
         auto *archive = archive_write_new();
-        archive_write_add_filter_none(archive);
+        AddCompressionFilter(archive, compression);
         archive_write_set_format_pax_restricted(archive);
         archive_write_set_format_option(archive, "pax", "hdrcharset", "BINARY");
 
+        // hand the exchanger large blocks, and don't pad the last one
+        archive_write_set_bytes_per_block(archive, kArchiveChunkSize);
+        archive_write_set_bytes_in_last_block(archive, 1);
+
         archive_write_open(archive, exchanger.get(), nullptr,
                            ArchiveWriteCallback, ArchiveCloseWriteCallback);
 
-        auto *disk = archive_read_disk_new();
-        archive_read_disk_set_standard_lookup(disk);
-
-#ifdef Q_OS_WINDOWS
-        auto target_directory_utf16_wstr = std::wstring(
-            reinterpret_cast<const wchar_t *>((target_directory).utf16()));
-        auto r =
-            archive_read_disk_open_w(disk, target_directory_utf16_wstr.c_str());
-#else
-        auto r = archive_read_disk_open(disk, target_directory.toUtf8());
-#endif
-
-        if (r != ARCHIVE_OK) {
-          FLOG_W("archive_read_disk_open() failed: %s, abort...",
-                 archive_error_string(disk));
-          archive_read_free(disk);
-          archive_write_free(archive);
-          return -1;
-        }
-
-        for (;;) {
-          auto *entry = archive_entry_new();
-          r = archive_read_next_header2(disk, entry);
-          if (r == ARCHIVE_EOF) break;
-          if (r != ARCHIVE_OK) {
-            FLOG_W("archive_read_next_header2() failed, ret: %d, explain: %s",
-                   r, archive_error_string(disk));
-            ret = -1;
-            break;
-          }
-
-          archive_read_disk_descend(disk);
+        auto ret = ArchiveWritePipeline(target_directory, archive).Run();
 
-#ifdef Q_OS_WINDOWS
-          auto source_path =
-              QString::fromUtf16(reinterpret_cast<const char16_t *>(
-                  archive_entry_pathname_w(entry)));
-#else
-          auto source_path = QString::fromUtf8(archive_entry_pathname(entry));
-#endif
-
-          QFile file(source_path);
-
-          if (file.open(QIODevice::ReadOnly)) {
-            // turn absolute path to relative path
-            auto relativ_path_name = base_path.relativeFilePath(source_path);
-            archive_entry_set_pathname(entry, relativ_path_name.toUtf8());
-
-#ifdef Q_OS_WINDOWS
-            auto source_path_utf16_wstr = std::wstring(
-                reinterpret_cast<const wchar_t *>(source_path.utf16()));
-            archive_entry_copy_sourcepath_w(entry,
-                                            source_path_utf16_wstr.c_str());
-#else
-
-            archive_entry_copy_sourcepath(entry, source_path.toUtf8());
-#endif
-
-            r = archive_write_header(archive, entry);
-            if (r < ARCHIVE_OK) {
-              FLOG_W("archive_write_header() failed, ret: %d, explain: %s", r,
-                     archive_error_string(archive));
-              continue;
-            }
-
-            if (r == ARCHIVE_FATAL) {
-              FLOG_W(
-                  "archive_write_header() failed, ret: %d, explain: %s, "
-                  "abort ...",
-                  r, archive_error_string(archive));
-              ret = -1;
-              break;
-            }
-
-            if (r > ARCHIVE_FAILED) {
-              auto buffer = file.read(1024);
-              while (!buffer.isEmpty()) {
-                archive_write_data(archive, buffer.data(), buffer.size());
-                buffer = file.read(1024);
-              }
-            }
-          }
-          archive_write_finish_entry(archive);
-          archive_entry_free(entry);
-        }
-
-        archive_read_free(disk);
         archive_write_free(archive);
-
         return ret;
       },
       "new_archive_2_data_exchanger", TransferParams(), cb};
@@ -207,10 +797,10 @@ void ArchiveFileOperator::ExtractArchiveFromDataExchanger(
     const OperationCallback &cb) {
   auto *task = new Thread::Task{
       [=](const DataObjectPtr &) -> GFError {
-        int ret = 0;
         auto *archive = archive_read_new();
-        auto *ext = archive_write_disk_new();
 
+        // gzip or zstd written by NewArchive2DataExchanger is recognised by
+        // its magic bytes, plain tar from older versions still reads as is
         auto r = archive_read_support_filter_all(archive);
         if (r != ARCHIVE_OK) {
           FLOG_W("archive_read_support_filter_all(), ret: %d, reason: %s", r,
@@ -237,54 +827,11 @@ void ArchiveFileOperator::ExtractArchiveFromDataExchanger(
           return r;
         }
 
-        r = archive_write_disk_set_options(ext, 0);
-        if (r != ARCHIVE_OK) {
-          FLOG_W("archive_write_disk_set_options(), ret: %d, reason: %s", r,
-                 archive_error_string(archive));
-          return r;
-        }
-
-        for (;;) {
-          struct archive_entry *entry;
-          r = archive_read_next_header(archive, &entry);
-          if (r == ARCHIVE_EOF) break;
-          if (r != ARCHIVE_OK) {
-            FLOG_W("archive_read_next_header(), ret: %d, reason: %s", r,
-                   archive_error_string(archive));
-            ret = r;
-            break;
-          }
-
-          auto path_name = QString::fromUtf8(archive_entry_pathname(entry));
-          auto target_path_name = target_path + "/" + path_name;
-
-#ifdef Q_OS_WINDOWS
-          auto target_path_utf16_wstr = std::wstring(
-              reinterpret_cast<const wchar_t *>((target_path_name).utf16()));
-          archive_entry_copy_pathname_w(entry, target_path_utf16_wstr.c_str());
-#else
-
-          archive_entry_set_pathname(entry, target_path_name.toUtf8());
-#endif
-
-          r = archive_write_header(ext, entry);
-          if (r != ARCHIVE_OK) {
-            FLOG_W("archive_write_header(), ret: %d, reason: %s", r,
-                   archive_error_string(archive));
-          } else {
-            r = CopyData(archive, ext);
-          }
-        }
+        auto ret = ArchiveExtractPipeline(archive, target_path).Run();
 
         r = archive_read_free(archive);
         if (r != ARCHIVE_OK) {
-          FLOG_W("archive_read_free(), ret: %d, reason: %s", r,
-                 archive_error_string(archive));
-        }
-        r = archive_write_free(ext);
-        if (r != ARCHIVE_OK) {
-          FLOG_W("archive_read_free(), ret: %d, reason: %s", r,
-                 archive_error_string(archive));
+          FLOG_W("archive_read_free(), ret: %d", r);
         }
 
         return ret;
@@ -35,6 +35,48 @@
 
 namespace GpgFrontend {
 
+/**
+ * @brief compression filter stage between the tar writer and the exchanger,
+ * applied to archives of directories before they are encrypted
+ *
+ */
+struct GF_CORE_EXPORT ArchiveCompression {
+  enum Filter {
+    kFilter_None = 0,
+    kFilter_Gzip,
+    kFilter_Zstd,
+  };
+
+  Filter filter = kFilter_None;
+  int level = 0;    ///< 0 keeps the default level of the filter
+  int threads = 0;  ///< zstd workers, 0 uses all cores
+
+  /**
+   * @brief read archive/compression, archive/compression_level and
+   * archive/compression_threads from the settings
+   *
+   * @return ArchiveCompression
+   */
+  static auto FromSettings() -> ArchiveCompression;
+
+  /**
+   * @brief whether the archive leaves the writer compressed, in which case
+   * gpg should not compress it a second time
+   *
+   * @return true
+   * @return false
+   */
+  [[nodiscard]] auto IsEnabled() const -> bool;
+
+  /**
+   * @brief the compression the writer is able to apply, with the filter
+   * set to none if libarchive can't provide it
+   *
+   * @return ArchiveCompression
+   */
+  [[nodiscard]] auto Applied() const -> ArchiveCompression;
+};
+
 class GF_CORE_EXPORT ArchiveFileOperator {
  public:
   /**
@@ -47,20 +89,22 @@ class GF_CORE_EXPORT ArchiveFileOperator {
   /**
    * @brief Create a Archive object
    *
-   * @param base_path
-   * @param archive_path
-   * @param compress
-   * @param files
+   * @param target_directory
+   * @param exchanger
+   * @param cb
+   * @param compression filter applied to the tar stream
    */
-  static void NewArchive2DataExchanger(const QString &target_directory,
-                                       const QSharedPointer<GFDataExchanger> &,
-                                       const OperationCallback &cb);
+  static void NewArchive2DataExchanger(
+      const QString &target_directory, const QSharedPointer<GFDataExchanger> &,
+      const OperationCallback &cb, const ArchiveCompression &compression = {});
 
   /**
-   * @brief
+   * @brief extract an archive, the compression filter (if any) is detected
+   * from the stream itself
    *
-   * @param archive_path
-   * @param base_path
+   * @param fd
+   * @param target_path
+   * @param cb
    */
   static void ExtractArchiveFromDataExchanger(
       const QSharedPointer<GFDataExchanger> &fd, const QString &target_path,
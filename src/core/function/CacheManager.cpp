@@ -29,9 +29,17 @@
 #include "CacheManager.h"
 
 #include <algorithm>
+#include <array>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <utility>
 
 #include "core/function/DataObjectOperator.h"
+#include "core/function/GlobalSettingStation.h"
+#include "core/thread/TaskRunnerGetter.h"
 #include "core/utils/MemoryUtils.h"
 
 namespace GpgFrontend {
@@ -40,7 +48,6 @@ template <typename Key, typename Value>
 class ThreadSafeMap {
  public:
   using MapType = std::map<Key, Value>;
-  using IteratorType = typename MapType::iterator;
 
   void insert(const Key& key, const Value& value) {
     std::unique_lock lock(mutex_);
@@ -61,16 +68,6 @@ class ThreadSafeMap {
     return map_->count(key) > 0;
   }
 
-  auto begin() -> IteratorType { return map_mirror_->begin(); }
-
-  auto end() -> IteratorType { return map_mirror_->end(); }
-
-  auto mirror() -> ThreadSafeMap& {
-    std::shared_lock lock(mutex_);
-    *map_mirror_ = *map_;
-    return *this;
-  }
-
   auto remove(const QString& key) -> bool {
     std::unique_lock lock(mutex_);
     auto it = map_->find(key);
@@ -82,24 +79,201 @@ class ThreadSafeMap {
   }
 
  private:
-  std::unique_ptr<MapType, SecureObjectDeleter<MapType>> map_mirror_ =
-      std::move(SecureCreateUniqueObject<MapType>());
   std::unique_ptr<MapType, SecureObjectDeleter<MapType>> map_ =
       std::move(SecureCreateUniqueObject<MapType>());
   mutable std::shared_mutex mutex_;
 };
 
+/**
+ * @brief runtime cache split into independently locked shards, each one an
+ * LRU list bounded by the bytes its entries take. entries with a ttl are
+ * also kept in an expiry index, so sweeping only touches expired entries.
+ *
+ */
+class ShardedLRUCache {
+ public:
+  static constexpr int kShardCount = 16;
+
+  explicit ShardedLRUCache(qint64 capacity)
+      : shard_capacity_(std::max<qint64>(capacity / kShardCount, 1)) {}
+
+  void Insert(const QString& key, const GFBuffer& value, qint64 expire_at) {
+    auto& shard = shard_of(key);
+    std::lock_guard lock(shard.mutex);
+
+    if (auto it = shard.index.find(key); it != shard.index.end()) {
+      erase(shard, it.value());
+    }
+
+    shard.lru.push_front(
+        Entry{key, value, expire_at, Cost(key, value), shard.expiry.end()});
+    auto entry = shard.lru.begin();
+    if (expire_at >= 0) entry->expiry = shard.expiry.emplace(expire_at, key);
+    shard.index.insert(key, entry);
+    shard.bytes += entry->cost;
+
+    // the newest entry stays even if it alone exceeds the shard budget
+    while (shard.bytes > shard_capacity_ && shard.lru.size() > 1) {
+      erase(shard, std::prev(shard.lru.end()));
+      evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  auto Get(const QString& key, qint64 now) -> std::optional<GFBuffer> {
+    auto& shard = shard_of(key);
+    std::lock_guard lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    auto entry = it.value();
+    if (entry->expire_at >= 0 && now >= entry->expire_at) {
+      erase(shard, entry);
+      expirations_.fetch_add(1, std::memory_order_relaxed);
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return entry->value;
+  }
+
+  void Remove(const QString& key) {
+    auto& shard = shard_of(key);
+    std::lock_guard lock(shard.mutex);
+
+    if (auto it = shard.index.find(key); it != shard.index.end()) {
+      erase(shard, it.value());
+    }
+  }
+
+  auto SweepExpired(qint64 now) -> int {
+    int swept = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      while (!shard.expiry.empty() && shard.expiry.begin()->first <= now) {
+        erase(shard, shard.index.value(shard.expiry.begin()->second));
+        swept++;
+      }
+    }
+    expirations_.fetch_add(swept, std::memory_order_relaxed);
+    return swept;
+  }
+
+  [[nodiscard]] auto Stats() -> CacheManager::RuntimeCacheStats {
+    CacheManager::RuntimeCacheStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.evictions = evictions_.load(std::memory_order_relaxed);
+    stats.expirations = expirations_.load(std::memory_order_relaxed);
+    stats.capacity = shard_capacity_ * kShardCount;
+
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      stats.entries += static_cast<qint64>(shard.lru.size());
+      stats.bytes += shard.bytes;
+    }
+    return stats;
+  }
+
+ private:
+  struct Entry {
+    QString key;
+    GFBuffer value;
+    qint64 expire_at;  ///< msecs since epoch, -1 never expires
+    qint64 cost;
+    std::multimap<qint64, QString>::iterator expiry;
+  };
+  using EntryIterator = std::list<Entry>::iterator;
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<Entry> lru;  ///< most recently used first
+    QHash<QString, EntryIterator> index;
+    std::multimap<qint64, QString> expiry;
+    qint64 bytes = 0;
+  };
+
+  std::array<Shard, kShardCount> shards_;
+  const qint64 shard_capacity_;
+  std::atomic<qint64> hits_{};
+  std::atomic<qint64> misses_{};
+  std::atomic<qint64> evictions_{};
+  std::atomic<qint64> expirations_{};
+
+  /**
+   * @brief bytes charged for an entry: key, value and a rough per node
+   * overhead for the list, index and expiry nodes
+   *
+   */
+  static auto Cost(const QString& key, const GFBuffer& value) -> qint64 {
+    return static_cast<qint64>(value.Size()) + key.size() * 2 + 128;
+  }
+
+  auto shard_of(const QString& key) -> Shard& {
+    return shards_[qHash(key) % kShardCount];
+  }
+
+  static void erase(Shard& shard, EntryIterator entry) {
+    if (entry->expiry != shard.expiry.end()) shard.expiry.erase(entry->expiry);
+    shard.index.remove(entry->key);
+    shard.bytes -= entry->cost;
+    shard.lru.erase(entry);
+  }
+};
+
 class CacheManager::Impl : public QObject {
   Q_OBJECT
  public:
   explicit Impl(int channel)
-      : channel_(channel), flush_timer_(new QTimer(this)) {
-    connect(flush_timer_, &QTimer::timeout, this,
-            &Impl::slot_flush_cache_storage);
-    flush_timer_->start(15000);
-
+      : channel_(channel),
+        runner_(Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
+            Thread::TaskRunnerGetter::kTaskRunnerType_IO)),
+        runtime_cache_(RuntimeCacheCapacity()) {
     // load data from storage
     load_all_cache_storage();
+
+    // the periodic runs go through the guard, they may still be posted or
+    // running on an IO worker when this is destroyed
+    run_guard_->impl = this;
+
+    Thread::TaskScheduler::Options flush_options;
+    flush_options.delay = flush_options.period = std::chrono::seconds(15);
+    flush_options.coalesce_key = QString("cache_manager/%1/flush").arg(channel);
+    flush_timer_ = runner_->PostScheduleTask(
+        "cache_manager_flush",
+        [guard = run_guard_](const DataObjectPtr&) -> int {
+          std::shared_lock lock(guard->lock);
+          if (guard->impl != nullptr) guard->impl->slot_flush_cache_storage();
+          return 0;
+        },
+        flush_options);
+
+    Thread::TaskScheduler::Options expire_options;
+    expire_options.delay = expire_options.period = std::chrono::seconds(5);
+    expire_options.coalesce_key =
+        QString("cache_manager/%1/expire").arg(channel);
+    expire_timer_ = runner_->PostScheduleTask(
+        "cache_manager_expire",
+        [guard = run_guard_](const DataObjectPtr&) -> int {
+          std::shared_lock lock(guard->lock);
+          if (guard->impl != nullptr) guard->impl->remove_expired_cache();
+          return 0;
+        },
+        expire_options);
+  }
+
+  ~Impl() override {
+    runner_->CancelScheduleTask(flush_timer_);
+    runner_->CancelScheduleTask(expire_timer_);
+
+    // waits for a run in progress, the runs posted later find no Impl
+    std::unique_lock lock(run_guard_->lock);
+    run_guard_->impl = nullptr;
   }
 
   void SaveDurableCache(const QString& key, const QJsonDocument& value,
@@ -109,23 +283,23 @@ class CacheManager::Impl : public QObject {
 
   void SaveSecDurableCache(const QString& key, const GFBuffer& value,
                            bool flush) {
-    auto data_object_key = get_data_object_key(key);
     durable_cache_storage_.insert(key, value);
 
-    if (!key_storage_.contains(key)) {
-      key_storage_.push_back(key);
+    {
+      std::lock_guard lock(dirty_lock_);
+      dirty_keys_.insert(key);
+      if (!key_storage_.contains(key)) {
+        key_storage_.push_back(key);
+        key_list_dirty_ = true;
+      }
     }
 
-    durable_cache_modified_ = true;
     if (flush) slot_flush_cache_storage();
   }
 
   auto LoadDurableCache(const QString& key) -> QJsonDocument {
-    auto data_object_key = get_data_object_key(key);
-
     if (!durable_cache_storage_.exists(key)) {
       durable_cache_storage_.insert(key, load_cache_storage(key, {}));
-      durable_cache_modified_ = true;
     }
 
     auto cache = LoadSecDurableCache(key);
@@ -150,11 +324,8 @@ class CacheManager::Impl : public QObject {
   }
 
   auto LoadSecDurableCache(const QString& key) -> GFBuffer {
-    auto data_object_key = get_data_object_key(key);
-
     if (!durable_cache_storage_.exists(key)) {
       durable_cache_storage_.insert(key, load_cache_storage(key, {}));
-      durable_cache_modified_ = true;
     }
 
     auto cache = durable_cache_storage_.get(key);
@@ -171,8 +342,6 @@ class CacheManager::Impl : public QObject {
   }
 
   auto ResetDurableCache(const QString& key) -> bool {
-    auto data_object_key = get_data_object_key(key);
-    durable_cache_modified_ = true;
     return durable_cache_storage_.remove(key);
   }
 
@@ -184,10 +353,9 @@ class CacheManager::Impl : public QObject {
 
   void SaveSecCache(const QString& key, const GFBuffer& value, qint64 ttl) {
     LOG_D() << "save cache, key: " << key << "ttl: " << ttl;
-    runtime_cache_storage_.insert(
-        key,
-        new CacheObject(
-            value, ttl < 0 ? -1 : QDateTime::currentSecsSinceEpoch() + ttl));
+    runtime_cache_.Insert(
+        key, value,
+        ttl < 0 ? -1 : QDateTime::currentMSecsSinceEpoch() + ttl * 1000);
   }
 
   auto LoadCache(const QString& key) -> QString {
@@ -195,31 +363,20 @@ class CacheManager::Impl : public QObject {
   }
 
   auto LoadSecCache(const QString& key) -> GFBuffer {
-    if (!runtime_cache_storage_.contains(key)) return {};
-    LOG_D() << "hit cache, key: " << key;
-
-    auto* value = runtime_cache_storage_.object(key);
-    if (value == nullptr) {
-      LOG_E() << "hit cache but got nullptr by value, key" << key;
-      return {};
-    }
+    auto value =
+        runtime_cache_.Get(key, QDateTime::currentMSecsSinceEpoch());
+    if (!value) return {};
 
-    if (value->ttl < 0) return value->value;
+    LOG_D() << "hit cache, key: " << key;
+    return *value;
+  }
 
-    // deal with expiration
-    auto current_timestamp = QDateTime::currentSecsSinceEpoch();
-    if (current_timestamp > value->ttl) {
-      LOG_D() << "hit cache but expired, key: " << key
-              << "expiration timestamp:" << value->ttl;
-      ResetCache(key);
-      return {};
-    }
+  void ResetCache(const QString& key) { runtime_cache_.Remove(key); }
 
-    return value->value;
+  auto GetRuntimeCacheStats() -> RuntimeCacheStats {
+    return runtime_cache_.Stats();
   }
 
-  void ResetCache(const QString& key) { runtime_cache_storage_.remove(key); }
-
  private slots:
 
   /**
@@ -227,19 +384,49 @@ class CacheManager::Impl : public QObject {
    *
    */
   void slot_flush_cache_storage() {
-    if (!durable_cache_modified_) return;
+    // flushes may come from the timer and from callers at the same time,
+    // let them write one after the other
+    std::lock_guard flush_lock(flush_lock_);
+
+    QSet<QString> dirty_keys;
+    QJsonArray key_list;
+    bool key_list_dirty;
+    {
+      std::lock_guard lock(dirty_lock_);
+      dirty_keys.swap(dirty_keys_);
+      key_list_dirty = std::exchange(key_list_dirty_, false);
+      if (key_list_dirty) key_list = key_storage_;
+    }
+    if (dirty_keys.isEmpty() && !key_list_dirty) return;
 
-    FLOG_D() << "flushing durable cache to disk...";
+    FLOG_D("flushing %lld durable cache entries to disk",
+           static_cast<long long>(dirty_keys.size()));
 
-    for (const auto& cache : durable_cache_storage_.mirror()) {
-      if (cache.second.Empty()) continue;
+    // however often a key changed since the last flush, it's written once
+    QStringList keys;
+    QContainer<QPair<QString, GFBuffer>> objects;
+    for (const auto& key : dirty_keys) {
+      auto value = durable_cache_storage_.get(key);
+      if (!value || value->Empty()) continue;
 
-      auto key = get_data_object_key(cache.first);
-      opera_.StoreSecDataObj(key, cache.second);
+      keys.append(key);
+      objects.push_back({get_data_object_key(key), *value});
     }
+    if (key_list_dirty) {
+      objects.push_back(
+          {drk_key_, GFBuffer(QJsonDocument(key_list).toJson())});
+    }
+
+    auto refs = opera_.StoreSecDataObjs(objects);
 
-    opera_.StoreDataObj(drk_key_, QJsonDocument(key_storage_));
-    durable_cache_modified_ = false;
+    // what failed is written again by the next flush
+    std::lock_guard lock(dirty_lock_);
+    for (qsizetype i = 0; i < keys.size(); i++) {
+      if (refs.value(i).isEmpty()) dirty_keys_.insert(keys[i]);
+    }
+    if (key_list_dirty && refs.value(keys.size()).isEmpty()) {
+      key_list_dirty_ = true;
+    }
   }
 
  private:
@@ -285,10 +472,7 @@ class CacheManager::Impl : public QObject {
       opera_.StoreDataObj(drk_key_, QJsonDocument(QJsonArray()));
     }
 
-    for (const auto& key : registered_key_list) {
-      load_cache_storage(key.toString(), {});
-    }
-
+    // the entries themselves are read from the store when first asked for
     key_storage_ = registered_key_list;
   }
 
@@ -299,23 +483,47 @@ class CacheManager::Impl : public QObject {
    */
   void register_cache_key(const QString& key) {}
 
-  struct CacheObject {
-    GFBuffer value;
-    qint64 ttl;
+  /**
+   * @brief drop the runtime cache entries whose ttl passed, so that values
+   * nobody asks for again don't stay in memory
+   *
+   */
+  void remove_expired_cache() {
+    auto swept =
+        runtime_cache_.SweepExpired(QDateTime::currentMSecsSinceEpoch());
+    if (swept > 0) LOG_D() << "swept expired runtime cache entries:" << swept;
+  }
 
-    CacheObject(const GFBuffer& value, qint64 ttl) : value(value), ttl(ttl) {}
-  };
+  /**
+   * @brief byte budget of the runtime cache, cache/runtime_capacity_mb
+   *
+   */
+  static auto RuntimeCacheCapacity() -> qint64 {
+    auto mb = GetSettings().value("cache/runtime_capacity_mb", 16).toInt();
+    return static_cast<qint64>(std::clamp(mb, 1, 1024)) * 1024 * 1024;
+  }
 
   int channel_;
+  Thread::TaskRunnerPtr runner_;
   GpgFrontend::DataObjectOperator& opera_ =
       GpgFrontend::DataObjectOperator::GetInstance(channel_);
 
-  QCache<QString, CacheObject> runtime_cache_storage_;
+  ShardedLRUCache runtime_cache_;
   ThreadSafeMap<QString, GFBuffer> durable_cache_storage_;
-  QJsonArray key_storage_;
-  QTimer* flush_timer_;
+  QJsonArray key_storage_;  ///< guarded by dirty_lock_
+  QSet<QString> dirty_keys_;
+  bool key_list_dirty_ = false;
+  std::mutex dirty_lock_;
+  std::mutex flush_lock_;
+  Thread::TaskScheduler::TimerID flush_timer_;
+  Thread::TaskScheduler::TimerID expire_timer_;
   const QString drk_key_ = "__cache_manage_data_register_key_list";
-  std::atomic<bool> durable_cache_modified_{};
+
+  struct RunGuard {
+    std::shared_mutex lock;
+    Impl* impl = nullptr;
+  };
+  std::shared_ptr<RunGuard> run_guard_ = std::make_shared<RunGuard>();
 };
 
 CacheManager::CacheManager(int channel)
@@ -378,6 +586,10 @@ auto CacheManager::LoadSecCache(const QString& key) -> GFBuffer {
 }
 
 void CacheManager::FlushCacheStorage() { p_->FlushCacheStorage(); }
+
+auto CacheManager::GetRuntimeCacheStats() -> RuntimeCacheStats {
+  return p_->GetRuntimeCacheStats();
+}
 }  // namespace GpgFrontend
 
 #include "CacheManager.moc"
\ No newline at end of file
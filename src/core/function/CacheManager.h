@@ -36,6 +36,20 @@ namespace GpgFrontend {
 class GF_CORE_EXPORT CacheManager
     : public SingletonFunctionObject<CacheManager> {
  public:
+  /**
+   * @brief counters of the runtime (non durable) cache
+   *
+   */
+  struct RuntimeCacheStats {
+    qint64 hits = 0;
+    qint64 misses = 0;
+    qint64 evictions = 0;    ///< dropped to stay within the capacity
+    qint64 expirations = 0;  ///< dropped because their ttl passed
+    qint64 entries = 0;
+    qint64 bytes = 0;
+    qint64 capacity = 0;
+  };
+
   /**
    * @brief Construct a new Cache Manager object
    *
@@ -162,6 +176,13 @@ class GF_CORE_EXPORT CacheManager
    */
   void FlushCacheStorage();
 
+  /**
+   * @brief Get the counters of the runtime cache
+   *
+   * @return RuntimeCacheStats
+   */
+  auto GetRuntimeCacheStats() -> RuntimeCacheStats;
+
  private:
   class Impl;
   SecureUniquePtr<Impl> p_;
@@ -73,6 +73,13 @@ class GF_CORE_EXPORT CoreSignalStation : public QObject {
    *
    */
   void SignalCoreFullyLoaded();
+
+  /**
+   * @brief a settings object got a new value, emitted when it changes in
+   * memory, before it is written back
+   *
+   */
+  void SignalSettingsObjectChanged(QString name);
 };
 
 }  // namespace GpgFrontend
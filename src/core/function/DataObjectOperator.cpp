@@ -31,7 +31,14 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/kdf.h>
+#include <openssl/params.h>
 
+#include <list>
+#include <mutex>
+#include <utility>
+
+#include "core/function/AESCryptoHelper.h"
+#include "core/function/DataObjectStore.h"
 #include "core/function/GFBufferFactory.h"
 #include "core/function/PassphraseGenerator.h"
 #include "core/utils/IOUtils.h"
@@ -45,64 +52,125 @@ auto LogOpenSSLError(const QString& context) -> void {
   LOG_E() << context << " failed: " << err_buf.data();
 }
 
-auto DeriveObjectKey(const GpgFrontend::GFBuffer& key,
-                     const GpgFrontend::GFBuffer& context)
-    -> GpgFrontend::GFBufferOrNone {
-  GpgFrontend::GFBuffer out(32);
-  auto outlen = out.Size();
-
-  EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
-  if (pctx == nullptr) {
-    LogOpenSSLError("EVP_PKEY_CTX_new_id");
-    return {};
+/**
+ * @brief HKDF-SHA256 context of the current thread, fetched once and reset
+ * for each derivation instead of being created and freed every time
+ *
+ */
+class HKDFContext {
+ public:
+  HKDFContext() {
+    kdf_ = EVP_KDF_fetch(nullptr, "HKDF", nullptr);
+    if (kdf_ != nullptr) ctx_ = EVP_KDF_CTX_new(kdf_);
+    if (ctx_ == nullptr) LogOpenSSLError("EVP_KDF_CTX_new");
   }
 
-  if (EVP_PKEY_derive_init(pctx) <= 0) {
-    LogOpenSSLError("EVP_PKEY_derive_init");
-    EVP_PKEY_CTX_free(pctx);
-    return {};
+  ~HKDFContext() {
+    EVP_KDF_CTX_free(ctx_);
+    EVP_KDF_free(kdf_);
   }
 
-  if (EVP_PKEY_CTX_set_hkdf_md(pctx, EVP_sha256()) <= 0) {
-    LogOpenSSLError("EVP_PKEY_CTX_set_hkdf_md");
-    EVP_PKEY_CTX_free(pctx);
-    return {};
+  HKDFContext(const HKDFContext&) = delete;
+  auto operator=(const HKDFContext&) -> HKDFContext& = delete;
+
+  auto Derive(const GpgFrontend::GFBuffer& key,
+              const GpgFrontend::GFBuffer& context)
+      -> GpgFrontend::GFBufferOrNone {
+    if (ctx_ == nullptr) return {};
+    EVP_KDF_CTX_reset(ctx_);
+
+    std::array<char, 7> digest = {"SHA256"};
+    std::array<unsigned char, 1> empty_salt = {{0}};
+    std::array<OSSL_PARAM, 5> params = {
+        {OSSL_PARAM_utf8_string("digest", digest.data(), 0),
+         OSSL_PARAM_octet_string("key", const_cast<char*>(key.Data()),
+                                 key.Size()),
+         OSSL_PARAM_octet_string("salt", empty_salt.data(), empty_salt.size()),
+         OSSL_PARAM_octet_string("info", const_cast<char*>(context.Data()),
+                                 context.Size()),
+         OSSL_PARAM_END}};
+
+    GpgFrontend::GFBuffer out(32);
+    if (EVP_KDF_derive(ctx_, reinterpret_cast<unsigned char*>(out.Data()),
+                       out.Size(), params.data()) != 1) {
+      LogOpenSSLError("EVP_KDF_derive");
+      return {};
+    }
+    return out;
   }
 
-  std::array<unsigned char, 1> empty_salt = {{0}};
-  if (EVP_PKEY_CTX_set1_hkdf_salt(pctx, empty_salt.data(), empty_salt.size()) <=
-      0) {
-    LogOpenSSLError("EVP_PKEY_CTX_set1_hkdf_salt");
-    EVP_PKEY_CTX_free(pctx);
-    return {};
-  }
+ private:
+  EVP_KDF* kdf_ = nullptr;
+  EVP_KDF_CTX* ctx_ = nullptr;
+};
 
-  if (EVP_PKEY_CTX_set1_hkdf_key(
-          pctx, reinterpret_cast<const unsigned char*>(key.Data()),
-          static_cast<int>(key.Size())) <= 0) {
-    LogOpenSSLError("EVP_PKEY_CTX_set1_hkdf_key");
-    EVP_PKEY_CTX_free(pctx);
-    return {};
-  }
+/**
+ * @brief least recently used derived object keys, by key id and ref. it
+ * forgets everything once the app secure keys change.
+ *
+ */
+class DerivedKeyCache {
+ public:
+  static constexpr int kCapacity = 512;
 
-  if (EVP_PKEY_CTX_add1_hkdf_info(
-          pctx, reinterpret_cast<const unsigned char*>(context.Data()),
-          static_cast<int>(context.Size())) <= 0) {
-    LogOpenSSLError("EVP_PKEY_CTX_add1_hkdf_info");
-    EVP_PKEY_CTX_free(pctx);
-    return {};
+  auto Get(const QByteArray& id, quint64 version)
+      -> GpgFrontend::GFBufferOrNone {
+    std::lock_guard lock(mutex_);
+    if (version != version_) return {};
+
+    auto it = index_.find(id);
+    if (it == index_.end()) return {};
+
+    lru_.splice(lru_.begin(), lru_, it.value());
+    return it.value()->second;
   }
 
-  if (EVP_PKEY_derive(pctx, reinterpret_cast<unsigned char*>(out.Data()),
-                      &outlen) <= 0) {
-    LogOpenSSLError("EVP_PKEY_derive failed");
-    EVP_PKEY_CTX_free(pctx);
-    return {};
+  void Put(const QByteArray& id, quint64 version,
+           const GpgFrontend::GFBuffer& derived) {
+    std::lock_guard lock(mutex_);
+    if (version != version_) {
+      index_.clear();
+      lru_.clear();
+      version_ = version;
+    }
+
+    if (auto it = index_.find(id); it != index_.end()) {
+      lru_.erase(it.value());
+    }
+    lru_.emplace_front(id, derived);
+    index_.insert(id, lru_.begin());
+
+    while (lru_.size() > kCapacity) {
+      index_.remove(lru_.back().first);
+      lru_.pop_back();
+    }
   }
 
-  EVP_PKEY_CTX_free(pctx);
-  out.Resize(static_cast<ssize_t>(outlen));
-  return out;
+ private:
+  using Entry = std::pair<QByteArray, GpgFrontend::GFBuffer>;
+
+  std::mutex mutex_;
+  std::list<Entry> lru_;
+  QHash<QByteArray, std::list<Entry>::iterator> index_;
+  quint64 version_ = 0;
+};
+
+auto DeriveObjectKey(const GpgFrontend::GFBuffer& key_id,
+                     const GpgFrontend::GFBuffer& key,
+                     const GpgFrontend::GFBuffer& ref)
+    -> GpgFrontend::GFBufferOrNone {
+  static DerivedKeyCache cache;
+  thread_local HKDFContext hkdf;
+
+  const auto version = GpgFrontend::GlobalSettingStation::GetInstance()
+                           .GetAppSecureKeysVersion();
+  const auto id = key_id.ConvertToQByteArray() + ref.ConvertToQByteArray();
+
+  if (auto derived = cache.Get(id, version); derived) return derived;
+
+  auto derived = hkdf.Derive(key, ref);
+  if (derived) cache.Put(id, version, *derived);
+  return derived;
 }
 }  // namespace
 
@@ -117,6 +185,8 @@ DataObjectOperator::DataObjectOperator(int channel)
 
   l_key_ = gss_.GetLegacyAppSecureKey();
   Q_ASSERT(!l_key_.Empty());
+
+  store_ = DataObjectStore::Open(gss_.GetDataObjectsDir());
 }
 
 auto DataObjectOperator::StoreDataObj(const QString& key,
@@ -138,15 +208,31 @@ auto DataObjectOperator::GetDataObjectByRef(const QString& ref)
 
 auto DataObjectOperator::StoreSecDataObj(const QString& key,
                                          const GFBuffer& value) -> QString {
-  if (key_.Empty()) return {};
+  return StoreSecDataObjs({{key, value}}).value(0);
+}
 
-  // recreate if not exists
-  if (!QDir(gss_.GetDataObjectsDir()).exists()) {
-    QDir(gss_.GetDataObjectsDir()).mkpath(".");
+auto DataObjectOperator::StoreSecDataObjs(
+    const QContainer<QPair<QString, GFBuffer>>& objects) -> QStringList {
+  QStringList refs;
+  QContainer<QPair<GFBuffer, GFBuffer>> batch;
+
+  for (const auto& object : objects) {
+    auto ref = get_object_ref(object.first);
+    auto encrypted =
+        key_.Empty() ? GFBufferOrNone{} : encrypt_object(ref, object.second);
+    if (!encrypted) {
+      refs.append(QString{});
+      continue;
+    }
+
+    refs.append(QString(ref.ConvertToQByteArray().toHex()));
+    batch.push_back({ref, *encrypted});
   }
 
-  auto ref = get_object_ref(key);
-  return write_encr_object(ref, value);
+  if (!batch.isEmpty() && !store_->Put(batch)) {
+    for (auto& ref : refs) ref.clear();
+  }
+  return refs;
 }
 
 auto DataObjectOperator::GetSecDataObject(const QString& key)
@@ -177,19 +263,20 @@ auto DataObjectOperator::get_object_ref(const QString& obj_name) -> GFBuffer {
 auto DataObjectOperator::read_decr_object(const GFBuffer& ref)
     -> GFBufferOrNone {
   const auto ref_hex = ref.ConvertToQByteArray().toHex();
-  const auto ref_path = gss_.GetDataObjectsDir() + "/" + ref_hex;
-  if (!QFileInfo(ref_path).exists()) {
+
+  auto stored = store_->Get(ref);
+  if (!stored) {
     LOG_W() << "data object not found from disk, ref: " << ref_hex;
     return {};
   }
 
-  auto [succ, data] = ReadFileGFBuffer(ref_path);
-  if (!succ) {
-    LOG_W() << "failed to read data object from disk, ref: " << ref_hex;
+  constexpr size_t kKeyIdSize = 32;
+  if (stored->Size() <= kKeyIdSize) {
+    LOG_W() << "data object from disk is empty, ref: " << ref_hex;
     return {};
   }
 
-  auto key_id = data.Left(32);
+  auto key_id = stored->Left(kKeyIdSize);
   auto key = gss_.GetAppSecureKey(key_id);
 
   if (key.Empty()) {
@@ -198,18 +285,28 @@ auto DataObjectOperator::read_decr_object(const GFBuffer& ref)
     return {};
   }
 
-  auto encrypted = data.Right(static_cast<int>(data.Size() - key_id.Size()));
-  if (encrypted.Empty()) {
-    LOG_W() << "data object from disk is empty, ref: " << ref_hex;
-    return {};
-  }
-
-  auto drv_key = DeriveObjectKey(key, ref);
+  auto drv_key = DeriveObjectKey(key_id, key, ref);
   if (!drv_key) {
     LOG_W() << "failed to derive key from ref: " << ref_hex;
     return {};
   }
 
+  auto encrypted = stored->Mid(static_cast<ssize_t>(kKeyIdSize),
+                               static_cast<ssize_t>(stored->Size()) -
+                                   static_cast<ssize_t>(kKeyIdSize));
+
+  // large objects were encrypted chunk by chunk
+  if (GFBufferFactory::IsEncryptedStream(
+          encrypted.Left(AESCryptoHelper::kStreamMagicSize))) {
+    GFBuffer plaintext;
+    if (!GFBufferFactory::DecryptStream(*drv_key, MakeStreamReader(encrypted),
+                                        MakeStreamWriter(plaintext))) {
+      LOG_W() << "failed to decrypt data object ref: " << ref_hex;
+      return {};
+    }
+    return plaintext;
+  }
+
   auto plaintext = GFBufferFactory::DecryptLite(*drv_key, encrypted);
   if (!plaintext) {
     LOG_W() << "failed to decrypt data object ref: " << ref_hex;
@@ -233,30 +330,36 @@ auto DataObjectOperator::read_decr_json_object(const GFBuffer& ref)
   }
 }
 
-auto DataObjectOperator::write_encr_object(const GFBuffer& ref,
-                                           const GFBuffer& value) -> QString {
+auto DataObjectOperator::encrypt_object(const GFBuffer& ref,
+                                        const GFBuffer& value)
+    -> GFBufferOrNone {
   const auto ref_hex = ref.ConvertToQByteArray().toHex();
-  const auto ref_path = gss_.GetDataObjectsDir() + "/" + ref_hex;
 
-  auto drv_key = DeriveObjectKey(key_, ref);
+  auto drv_key = DeriveObjectKey(key_id_, key_, ref);
   if (!drv_key) {
     LOG_W() << "failed to derive key from ref: " << ref_hex;
     return {};
   }
 
+  GFBuffer data(key_id_);
+
+  // large objects are encrypted chunk by chunk
+  if (value.Size() >= GFBufferFactory::kStreamEncryptThreshold) {
+    if (!GFBufferFactory::EncryptLiteStream(*drv_key, MakeStreamReader(value),
+                                            MakeStreamWriter(data))) {
+      LOG_E() << "failed to encrypt data object: " << ref_hex;
+      return {};
+    }
+    return data;
+  }
+
   auto encrypted = GFBufferFactory::EncryptLite(*drv_key, value);
   if (!encrypted) {
     LOG_E() << "failed to encrypt data object: " << ref_hex;
     return {};
   }
 
-  GFBuffer data;
-  data.Combine({key_id_, *encrypted});
-
-  if (!WriteFileGFBuffer(ref_path, data)) {
-    LOG_E() << "failed to write data object to disk: " << ref_hex;
-  }
-
-  return ref_hex;
+  data.Append(*encrypted);
+  return data;
 }
 }  // namespace GpgFrontend
\ No newline at end of file
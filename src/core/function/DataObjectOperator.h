@@ -36,6 +36,8 @@
 
 namespace GpgFrontend {
 
+class DataObjectStore;
+
 class GF_CORE_EXPORT DataObjectOperator
     : public SingletonFunctionObject<DataObjectOperator> {
  public:
@@ -81,6 +83,17 @@ class GF_CORE_EXPORT DataObjectOperator
    */
   auto StoreSecDataObj(const QString &key, const GFBuffer &value) -> QString;
 
+  /**
+   * @brief store several objects at once, appended to the object store as
+   * one batch and synced to disk once. a crash leaves either the old or
+   * the new version of every object.
+   *
+   * @param objects key and value of each object
+   * @return QStringList refs in the same order, empty where storing failed
+   */
+  auto StoreSecDataObjs(const QContainer<QPair<QString, GFBuffer>> &objects)
+      -> QStringList;
+
   /**
    * @brief Get the Sec Data Object object
    *
@@ -103,6 +116,7 @@ class GF_CORE_EXPORT DataObjectOperator
   GFBuffer l_key_;                          ///< Legacy key
   GFBuffer key_;                            ///< Active key
   GFBuffer key_id_;                         ///< Active key Id
+  QSharedPointer<DataObjectStore> store_;   ///< Encrypted objects by ref
 
   /**
    * @brief Get the object ref object
@@ -121,12 +135,15 @@ class GF_CORE_EXPORT DataObjectOperator
   auto read_decr_object(const GFBuffer &ref) -> GFBufferOrNone;
 
   /**
-   * @brief
+   * @brief encrypt an object, the result is the active key id followed by
+   * the ciphertext
    *
    * @param ref
+   * @param value
    * @return GFBufferOrNone
    */
-  auto write_encr_object(const GFBuffer &ref, const GFBuffer &value) -> QString;
+  auto encrypt_object(const GFBuffer &ref, const GFBuffer &value)
+      -> GFBufferOrNone;
 
   /**
    * @brief
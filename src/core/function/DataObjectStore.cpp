@@ -0,0 +1,531 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "DataObjectStore.h"
+
+#include <array>
+#include <filesystem>
+#include <mutex>
+
+#include "core/utils/IOUtils.h"
+
+namespace {
+
+constexpr auto kStoreFileName = "objects.gfstore";
+constexpr std::array<char, 8> kStoreMagic = {'G', 'F', 'D', 'O',
+                                             'S', 'T', '0', '1'};
+constexpr auto kStoreHeaderSize = static_cast<qint64>(kStoreMagic.size());
+
+constexpr quint32 kRecordMagic = 0x52444647;  // "GFDR"
+constexpr quint32 kRecordPut = 1;
+constexpr quint32 kRecordRemove = 2;
+constexpr qint64 kRecordHeaderSize = 5 * sizeof(quint32);
+constexpr quint32 kMaxRefSize = 64;
+constexpr quint32 kMaxPayloadSize = 1024 * 1024 * 1024;
+
+// recovery stops at the first record outside these limits, so they bound
+// what may be written as well
+auto RecordSizeValid(quint64 ref_size, quint64 payload_size) -> bool {
+  return ref_size != 0 && ref_size <= kMaxRefSize &&
+         payload_size <= kMaxPayloadSize;
+}
+
+// compact once the overwritten records outweigh the live ones
+constexpr qint64 kCompactMinDeadBytes = 1024 * 1024;
+
+// legacy objects moved into the store per batch
+constexpr int kMigrateBatchSize = 256;
+
+auto Crc32(quint32 crc, const char* data, qint64 size) -> quint32 {
+  static const auto kTable = [] {
+    std::array<quint32, 256> table{};
+    for (quint32 i = 0; i < 256; i++) {
+      quint32 c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    return table;
+  }();
+
+  crc = ~crc;
+  for (qint64 i = 0; i < size; i++) {
+    crc = kTable[(crc ^ static_cast<quint8>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+/**
+ * @brief fixed size head of a record, followed by the ref and the payload.
+ * the crc covers type, sizes, ref and payload.
+ *
+ */
+struct RecordHeader {
+  quint32 magic = kRecordMagic;
+  quint32 type = kRecordPut;
+  quint32 ref_size = 0;
+  quint32 payload_size = 0;
+  quint32 crc = 0;
+
+  [[nodiscard]] auto Encode() const -> std::array<char, kRecordHeaderSize> {
+    std::array<char, kRecordHeaderSize> out{};
+    const std::array<quint32, 5> fields = {magic, type, ref_size,
+                                           payload_size, crc};
+    for (size_t i = 0; i < fields.size(); i++) {
+      qToLittleEndian(fields[i], out.data() + i * sizeof(quint32));
+    }
+    return out;
+  }
+
+  static auto Decode(const char* in) -> RecordHeader {
+    RecordHeader h;
+    h.magic = qFromLittleEndian<quint32>(in);
+    h.type = qFromLittleEndian<quint32>(in + 4);
+    h.ref_size = qFromLittleEndian<quint32>(in + 8);
+    h.payload_size = qFromLittleEndian<quint32>(in + 12);
+    h.crc = qFromLittleEndian<quint32>(in + 16);
+    return h;
+  }
+
+  /**
+   * @brief crc of the header fields, to be continued over ref and payload
+   *
+   */
+  [[nodiscard]] auto HeadCrc() const -> quint32 {
+    const auto encoded = Encode();
+    return Crc32(0, encoded.data() + 4, 3 * sizeof(quint32));
+  }
+
+  [[nodiscard]] auto Size() const -> qint64 {
+    return kRecordHeaderSize + ref_size + payload_size;
+  }
+};
+
+auto RecordOf(quint32 type, const GpgFrontend::GFBuffer& ref,
+              const GpgFrontend::GFBuffer& payload) -> RecordHeader {
+  RecordHeader h;
+  h.type = type;
+  h.ref_size = static_cast<quint32>(ref.Size());
+  h.payload_size = static_cast<quint32>(payload.Size());
+  h.crc = h.HeadCrc();
+  h.crc = Crc32(h.crc, ref.Data(), static_cast<qint64>(ref.Size()));
+  h.crc = Crc32(h.crc, payload.Data(), static_cast<qint64>(payload.Size()));
+  return h;
+}
+
+auto WriteRecord(QFile& file, const RecordHeader& h,
+                 const GpgFrontend::GFBuffer& ref,
+                 const GpgFrontend::GFBuffer& payload) -> bool {
+  const auto head = h.Encode();
+  return file.write(head.data(), kRecordHeaderSize) == kRecordHeaderSize &&
+         file.write(ref.Data(), static_cast<qint64>(ref.Size())) ==
+             static_cast<qint64>(ref.Size()) &&
+         file.write(payload.Data(), static_cast<qint64>(payload.Size())) ==
+             static_cast<qint64>(payload.Size());
+}
+
+/**
+ * @brief move objects kept as one file per ref (named by the hex ref) into
+ * the store. a file is deleted only after its object is on disk in the log.
+ *
+ */
+void MigrateLegacyObjects(const QString& dir,
+                          GpgFrontend::DataObjectStore& store) {
+  static const QRegularExpression kLegacyName("^[0-9a-f]{64}$");
+
+  QDir object_dir(dir);
+  auto names = object_dir.entryList(QDir::Files);
+
+  int migrated = 0;
+  QStringList done;
+  QContainer<QPair<GpgFrontend::GFBuffer, GpgFrontend::GFBuffer>> batch;
+
+  auto flush = [&]() {
+    if (batch.isEmpty()) return;
+    if (store.Put(batch)) {
+      for (const auto& name : done) QFile::remove(object_dir.filePath(name));
+      migrated += static_cast<int>(done.size());
+    }
+    batch.clear();
+    done.clear();
+  };
+
+  for (const auto& name : names) {
+    // leftovers of an interrupted write of the old layout
+    if (name.endsWith(".tmp")) {
+      QFile::remove(object_dir.filePath(name));
+      continue;
+    }
+    if (!kLegacyName.match(name).hasMatch()) continue;
+
+    auto [succ, payload] =
+        GpgFrontend::ReadFileGFBuffer(object_dir.filePath(name));
+    if (!succ || payload.Empty()) continue;
+
+    batch.push_back(
+        {GpgFrontend::GFBuffer(QByteArray::fromHex(name.toLatin1())),
+         payload});
+    done.append(name);
+    if (batch.size() >= kMigrateBatchSize) flush();
+  }
+  flush();
+
+  if (migrated > 0) {
+    LOG_I() << "moved" << migrated << "data objects into the object store";
+  }
+}
+
+}  // namespace
+
+namespace GpgFrontend {
+
+class DataObjectStore::Impl {
+ public:
+  explicit Impl(QString path) : path_(std::move(path)) { open(); }
+
+  ~Impl() { file_.close(); }
+
+  auto Get(const GFBuffer& ref) -> GFBufferOrNone {
+    std::lock_guard lock(mutex_);
+
+    auto it = index_.find(ref.ConvertToQByteArray());
+    if (it == index_.end()) return {};
+
+    GFBuffer payload(static_cast<size_t>(it->payload_size));
+    if (!file_.seek(it->payload_offset) ||
+        file_.read(payload.Data(), it->payload_size) != it->payload_size) {
+      LOG_W() << "failed to read data object from store:" << path_;
+      return {};
+    }
+    return payload;
+  }
+
+  auto Put(const QContainer<QPair<GFBuffer, GFBuffer>>& objects) -> bool {
+    std::lock_guard lock(mutex_);
+    if (!file_.isOpen()) return false;
+
+    for (const auto& object : objects) {
+      if (!RecordSizeValid(object.first.Size(), object.second.Size())) {
+        LOG_E() << "data object out of store limits, ref size:"
+                << object.first.Size()
+                << "payload size:" << object.second.Size();
+        return false;
+      }
+    }
+
+    const auto start = file_.size();
+    if (!file_.seek(start)) return false;
+
+    QContainer<QPair<QByteArray, Entry>> written;
+    auto offset = start;
+    for (const auto& object : objects) {
+      const auto h = RecordOf(kRecordPut, object.first, object.second);
+      if (!WriteRecord(file_, h, object.first, object.second)) break;
+
+      written.push_back({object.first.ConvertToQByteArray(),
+                         Entry{offset + kRecordHeaderSize + h.ref_size,
+                               h.payload_size, h.Size()}});
+      offset += h.Size();
+    }
+
+    // one sync for the whole batch, the index learns about the records
+    // only once they are on disk
+    if (written.size() != objects.size() || !SyncFileToDisk(file_)) {
+      LOG_E() << "failed to append data objects to store:" << path_;
+      file_.resize(start);
+      return false;
+    }
+
+    for (const auto& record : written) insert(record.first, record.second);
+    appended_ += written.size();
+
+    maybe_compact();
+    return true;
+  }
+
+  auto Remove(const GFBuffer& ref) -> bool {
+    std::lock_guard lock(mutex_);
+
+    auto it = index_.find(ref.ConvertToQByteArray());
+    if (it == index_.end() || !file_.seek(file_.size())) return false;
+
+    const auto h = RecordOf(kRecordRemove, ref, {});
+    if (!WriteRecord(file_, h, ref, {}) || !SyncFileToDisk(file_)) {
+      LOG_E() << "failed to remove data object from store:" << path_;
+      return false;
+    }
+
+    live_bytes_ -= it->record_size;
+    index_.erase(it);
+    appended_++;
+
+    maybe_compact();
+    return true;
+  }
+
+  void Clear() {
+    std::lock_guard lock(mutex_);
+
+    file_.close();
+    QFile::remove(path_);
+    index_.clear();
+    live_bytes_ = 0;
+    open();
+  }
+
+  auto Compact() -> bool {
+    std::lock_guard lock(mutex_);
+    return compact();
+  }
+
+  auto GetStats() -> Stats {
+    std::lock_guard lock(mutex_);
+
+    Stats stats;
+    stats.objects = index_.size();
+    stats.appended = appended_;
+    stats.compactions = compactions_;
+    stats.live_bytes = live_bytes_;
+    stats.file_bytes = file_.size();
+    return stats;
+  }
+
+ private:
+  struct Entry {
+    qint64 payload_offset;
+    qint64 payload_size;
+    qint64 record_size;
+  };
+
+  QString path_;
+  QFile file_;
+  QHash<QByteArray, Entry> index_;
+  qint64 live_bytes_ = 0;
+  qint64 appended_ = 0;
+  qint64 compactions_ = 0;
+  std::mutex mutex_;
+
+  void insert(const QByteArray& key, const Entry& entry) {
+    if (auto it = index_.find(key); it != index_.end()) {
+      live_bytes_ -= it->record_size;
+    }
+    index_.insert(key, entry);
+    live_bytes_ += entry.record_size;
+  }
+
+  void open() {
+    // a compaction that didn't get to its rename left the old log intact
+    QFile::remove(path_ + ".compact");
+
+    file_.setFileName(path_);
+    if (!file_.open(QIODevice::ReadWrite)) {
+      LOG_E() << "failed to open data object store:" << path_;
+      return;
+    }
+    file_.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    if (file_.size() == 0) {
+      file_.write(kStoreMagic.data(), kStoreHeaderSize);
+      SyncFileToDisk(file_);
+      return;
+    }
+
+    std::array<char, kStoreMagic.size()> magic{};
+    if (file_.read(magic.data(), kStoreHeaderSize) != kStoreHeaderSize ||
+        magic != kStoreMagic) {
+      LOG_E() << "not a data object store, moving it aside:" << path_;
+      file_.close();
+      QFile::remove(path_ + ".corrupt");
+      QFile::rename(path_, path_ + ".corrupt");
+      open();
+      return;
+    }
+
+    recover();
+  }
+
+  /**
+   * @brief rebuild the index from the log, cutting off the first record
+   * that is incomplete or damaged together with everything after it
+   *
+   */
+  void recover() {
+    qint64 offset = kStoreHeaderSize;
+    const auto size = file_.size();
+    std::array<char, kRecordHeaderSize> head{};
+    QByteArray chunk;
+
+    while (offset < size) {
+      if (size - offset < kRecordHeaderSize || !file_.seek(offset) ||
+          file_.read(head.data(), head.size()) != kRecordHeaderSize) {
+        break;
+      }
+
+      const auto h = RecordHeader::Decode(head.data());
+      if (h.magic != kRecordMagic ||
+          (h.type != kRecordPut && h.type != kRecordRemove) ||
+          !RecordSizeValid(h.ref_size, h.payload_size) ||
+          size - offset < h.Size()) {
+        break;
+      }
+
+      const auto ref = file_.read(h.ref_size);
+      auto crc = Crc32(h.HeadCrc(), ref.constData(), ref.size());
+      for (qint64 left = h.payload_size; left > 0; left -= chunk.size()) {
+        chunk = file_.read(std::min<qint64>(left, 64 * 1024));
+        if (chunk.isEmpty()) break;
+        crc = Crc32(crc, chunk.constData(), chunk.size());
+      }
+      if (crc != h.crc) break;
+
+      if (h.type == kRecordPut) {
+        insert(ref, Entry{offset + kRecordHeaderSize + h.ref_size,
+                          h.payload_size, h.Size()});
+      } else if (auto it = index_.find(ref); it != index_.end()) {
+        live_bytes_ -= it->record_size;
+        index_.erase(it);
+      }
+      offset += h.Size();
+    }
+
+    if (offset < size) {
+      LOG_W() << "data object store has a damaged tail, dropping"
+              << size - offset << "bytes:" << path_;
+      file_.resize(offset);
+      SyncFileToDisk(file_);
+    }
+  }
+
+  void maybe_compact() {
+    const auto dead = file_.size() - kStoreHeaderSize - live_bytes_;
+    if (dead > kCompactMinDeadBytes && dead > live_bytes_) compact();
+  }
+
+  /**
+   * @brief copy the live records into a new log, then swap it in with a
+   * rename. a crash before the rename keeps the old log.
+   *
+   */
+  auto compact() -> bool {
+    QFile out(path_ + ".compact");
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    out.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    QHash<QByteArray, Entry> index;
+    qint64 offset = kStoreHeaderSize;
+    auto succ = out.write(kStoreMagic.data(), kStoreHeaderSize) ==
+                kStoreHeaderSize;
+
+    for (auto it = index_.cbegin(); succ && it != index_.cend(); it++) {
+      GFBuffer payload(static_cast<size_t>(it->payload_size));
+      succ = file_.seek(it->payload_offset) &&
+             file_.read(payload.Data(), it->payload_size) == it->payload_size;
+      if (!succ) break;
+
+      const auto ref = GFBuffer(it.key());
+      const auto h = RecordOf(kRecordPut, ref, payload);
+      succ = WriteRecord(out, h, ref, payload);
+      index.insert(it.key(), Entry{offset + kRecordHeaderSize + h.ref_size,
+                                   h.payload_size, h.Size()});
+      offset += h.Size();
+    }
+
+    if (!succ || !SyncFileToDisk(out)) {
+      LOG_W() << "failed to compact data object store:" << path_;
+      out.remove();
+      return false;
+    }
+    out.close();
+    file_.close();
+
+    std::error_code ec;
+    std::filesystem::rename(
+        std::filesystem::path(out.fileName().toStdU16String()),
+        std::filesystem::path(path_.toStdU16String()), ec);
+    SyncDirectoryToDisk(QFileInfo(path_).absolutePath());
+
+    if (!file_.open(QIODevice::ReadWrite)) {
+      LOG_E() << "failed to reopen data object store:" << path_;
+      return false;
+    }
+    if (ec) {
+      LOG_W() << "failed to replace data object store:"
+              << QString::fromStdString(ec.message());
+      QFile::remove(out.fileName());
+      return false;
+    }
+
+    index_ = index;
+    compactions_++;
+    return true;
+  }
+};
+
+auto DataObjectStore::Open(const QString& dir)
+    -> QSharedPointer<DataObjectStore> {
+  static std::mutex lock;
+  static QMap<QString, QWeakPointer<DataObjectStore>> stores;
+
+  std::lock_guard guard(lock);
+  const auto path = QDir(dir).absoluteFilePath(kStoreFileName);
+  if (auto store = stores.value(path).toStrongRef(); store != nullptr) {
+    return store;
+  }
+
+  QDir(dir).mkpath(".");
+  auto store = QSharedPointer<DataObjectStore>::create(path);
+  MigrateLegacyObjects(dir, *store);
+
+  stores.insert(path, store);
+  return store;
+}
+
+DataObjectStore::DataObjectStore(const QString& path)
+    : p_(SecureCreateUniqueObject<Impl>(path)) {}
+
+DataObjectStore::~DataObjectStore() = default;
+
+auto DataObjectStore::Get(const GFBuffer& ref) -> GFBufferOrNone {
+  return p_->Get(ref);
+}
+
+auto DataObjectStore::Put(const QContainer<QPair<GFBuffer, GFBuffer>>& objects)
+    -> bool {
+  return p_->Put(objects);
+}
+
+auto DataObjectStore::Remove(const GFBuffer& ref) -> bool {
+  return p_->Remove(ref);
+}
+
+void DataObjectStore::Clear() { p_->Clear(); }
+
+auto DataObjectStore::Compact() -> bool { return p_->Compact(); }
+
+auto DataObjectStore::GetStats() -> Stats { return p_->GetStats(); }
+
+}  // namespace GpgFrontend
@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#pragma once
+
+#include "core/model/GFBuffer.h"
+#include "core/typedef/CoreTypedef.h"
+#include "core/utils/MemoryUtils.h"
+
+namespace GpgFrontend {
+
+/**
+ * @brief append only store keeping all data objects of a directory in a
+ * single log file. every record holds an object ref and its (already
+ * encrypted) payload, an in memory index maps refs to the latest record.
+ * a torn record at the end of the log is cut off when the store opens,
+ * and the log is compacted once most of it is overwritten objects.
+ *
+ */
+class GF_CORE_EXPORT DataObjectStore {
+ public:
+  struct Stats {
+    qint64 objects = 0;   ///< live objects
+    qint64 appended = 0;  ///< records appended since the store was opened
+    qint64 compactions = 0;
+    qint64 live_bytes = 0;
+    qint64 file_bytes = 0;
+  };
+
+  /**
+   * @brief open the store of a directory, shared by everyone opening the
+   * same directory. objects a previous version kept as one file per ref
+   * are moved into the store the first time.
+   *
+   * @param dir
+   * @return QSharedPointer<DataObjectStore>
+   */
+  static auto Open(const QString& dir) -> QSharedPointer<DataObjectStore>;
+
+  /**
+   * @brief Construct a new Data Object Store object on a log file,
+   * prefer Open() which shares the instance and migrates old objects
+   *
+   * @param path
+   */
+  explicit DataObjectStore(const QString& path);
+
+  /**
+   * @brief Destroy the Data Object Store object
+   *
+   */
+  ~DataObjectStore();
+
+  /**
+   * @brief Get the payload of an object
+   *
+   * @param ref
+   * @return GFBufferOrNone
+   */
+  auto Get(const GFBuffer& ref) -> GFBufferOrNone;
+
+  /**
+   * @brief append objects as one batch, synced to disk once. the batch
+   * is rejected as a whole if any ref is empty or longer than 64 bytes,
+   * or any payload is larger than 1 GiB.
+   *
+   * @param objects ref and payload of each object
+   * @return true
+   * @return false
+   */
+  auto Put(const QContainer<QPair<GFBuffer, GFBuffer>>& objects) -> bool;
+
+  /**
+   * @brief drop an object
+   *
+   * @param ref
+   * @return true if the object existed
+   */
+  auto Remove(const GFBuffer& ref) -> bool;
+
+  /**
+   * @brief drop all objects and start a new, empty log
+   *
+   */
+  void Clear();
+
+  /**
+   * @brief rewrite the log with the live objects only
+   *
+   * @return true
+   * @return false
+   */
+  auto Compact() -> bool;
+
+  /**
+   * @brief Get the Stats object
+   *
+   * @return Stats
+   */
+  auto GetStats() -> Stats;
+
+ private:
+  class Impl;
+  SecureUniquePtr<Impl> p_;
+};
+
+}  // namespace GpgFrontend
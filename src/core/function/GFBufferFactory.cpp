@@ -163,4 +163,26 @@ auto GFBufferFactory::DecryptLite(const GFBuffer& passphase,
   if (buffer.Empty()) return {};
   return AESCryptoHelper::GCMDecryptLite(passphase, buffer);
 }
+
+auto GFBufferFactory::EncryptStream(const GFBuffer& passphase,
+                                    const GFStreamReader& in,
+                                    const GFStreamWriter& out) -> bool {
+  return AESCryptoHelper::GCMEncryptStream(passphase, in, out, false);
+}
+
+auto GFBufferFactory::EncryptLiteStream(const GFBuffer& passphase,
+                                        const GFStreamReader& in,
+                                        const GFStreamWriter& out) -> bool {
+  return AESCryptoHelper::GCMEncryptStream(passphase, in, out, true);
+}
+
+auto GFBufferFactory::DecryptStream(const GFBuffer& passphase,
+                                    const GFStreamReader& in,
+                                    const GFStreamWriter& out) -> bool {
+  return AESCryptoHelper::GCMDecryptStream(passphase, in, out);
+}
+
+auto GFBufferFactory::IsEncryptedStream(const GFBuffer& head) -> bool {
+  return AESCryptoHelper::IsGCMStream(head);
+}
 }  // namespace GpgFrontend
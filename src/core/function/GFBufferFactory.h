@@ -31,6 +31,7 @@
 #include "core/function/PassphraseGenerator.h"
 #include "core/function/basic/GpgFunctionObject.h"
 #include "core/model/GFBuffer.h"
+#include "core/typedef/CoreTypedef.h"
 
 namespace GpgFrontend {
 
@@ -69,6 +70,35 @@ class GF_CORE_EXPORT GFBufferFactory
   static auto DecryptLite(const GFBuffer& passphase, const GFBuffer& buffer)
       -> GFBufferOrNone;
 
+  /**
+   * @brief payloads of at least this size should be encrypted with the
+   * stream functions
+   *
+   */
+  static constexpr size_t kStreamEncryptThreshold = 4 * 1024 * 1024;
+
+  static auto EncryptStream(const GFBuffer& passphase, const GFStreamReader& in,
+                            const GFStreamWriter& out) -> bool;
+
+  static auto EncryptLiteStream(const GFBuffer& passphase,
+                                const GFStreamReader& in,
+                                const GFStreamWriter& out) -> bool;
+
+  /**
+   * @brief decrypt a stream written by EncryptStream() or
+   * EncryptLiteStream(), the cipher is read from the stream header
+   *
+   */
+  static auto DecryptStream(const GFBuffer& passphase, const GFStreamReader& in,
+                            const GFStreamWriter& out) -> bool;
+
+  /**
+   * @brief check whether the data starts like the output of EncryptStream()
+   *
+   * @param head the first bytes of the data
+   */
+  static auto IsEncryptedStream(const GFBuffer& head) -> bool;
+
   static auto RandomOpenSSLPassphase(int len) -> GFBufferOrNone;
 
   auto RandomGpgPassphase(int len) -> GFBufferOrNone;
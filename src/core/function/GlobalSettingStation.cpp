@@ -31,6 +31,7 @@
 #include "GpgFrontendBuildInstallInfo.h"
 
 //
+#include "core/function/DataObjectStore.h"
 #include "core/module/ModuleManager.h"
 #include "core/utils/FilesystemUtils.h"
 
@@ -118,6 +119,9 @@ class GlobalSettingStation::Impl {
 
   void ClearAllDataObjects() const {
     DeleteAllFilesByPattern(app_data_objs_path(), "*");
+
+    // the store is open in this process, let it start over on a new log
+    DataObjectStore::Open(app_data_objs_path())->Clear();
   }
 
   /**
@@ -212,11 +216,19 @@ class GlobalSettingStation::Impl {
 
   void AppendAppSecureKeys(const QMap<GFBuffer, GFBuffer>& keys) {
     app_secure_keys_.insert(keys);
+    secure_keys_version_++;
+  }
+
+  [[nodiscard]] auto GetAppSecureKeysVersion() const -> quint64 {
+    return secure_keys_version_;
   }
 
   auto GetAppSecureKeyPath() -> QString { return app_secure_key_path(); }
 
-  void SetActiveKeyId(const GFBuffer& id) { active_key_id_ = id; }
+  void SetActiveKeyId(const GFBuffer& id) {
+    active_key_id_ = id;
+    secure_keys_version_++;
+  }
 
   auto GetActiveKeyId() -> GFBuffer { return active_key_id_; }
 
@@ -272,6 +284,7 @@ class GlobalSettingStation::Impl {
   QMap<GFBuffer, GFBuffer> app_secure_keys_;
   GFBuffer active_key_id_;
   GFBuffer legacy_key_id_;
+  std::atomic<quint64> secure_keys_version_{};
 };
 
 GlobalSettingStation::GlobalSettingStation(int channel) noexcept
@@ -341,6 +354,10 @@ auto GlobalSettingStation::GetConfigDirPath() const -> QString {
   return p_->GetConfigDirPath();
 }
 
+auto GlobalSettingStation::GetAppSecureKeysVersion() const -> quint64 {
+  return p_->GetAppSecureKeysVersion();
+}
+
 void GlobalSettingStation::AppendAppSecureKeys(
     const QMap<GFBuffer, GFBuffer>& keys) {
   p_->AppendAppSecureKeys(keys);
@@ -217,6 +217,14 @@ class GF_CORE_EXPORT GlobalSettingStation
    */
   void AppendAppSecureKeys(const QMap<GFBuffer, GFBuffer>& keys);
 
+  /**
+   * @brief changes whenever the secure keys or the active key change, so
+   * anything derived from the keys knows when to drop it
+   *
+   * @return quint64
+   */
+  auto GetAppSecureKeysVersion() const -> quint64;
+
   /**
    * @brief Get the Legacy Secure Key object
    *
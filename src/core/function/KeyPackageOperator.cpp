@@ -28,6 +28,7 @@
 
 #include "KeyPackageOperator.h"
 
+#include "core/function/AESCryptoHelper.h"
 #include "core/function/KeyPackageOperator.h"
 #include "core/function/gpg/GpgKeyImportExporter.h"
 #include "core/model/GpgImportInformation.h"
@@ -67,20 +68,32 @@ void KeyPackageOperator::GenerateKeyPackage(const QString& key_package_path,
               return;
             }
 
-            // AES encrypt
-            auto encrypted = GFBufferFactory::Encrypt(*p, gf_buffer);
-            if (!encrypted) {
-              cb(-1, TransferParams(QString{"Encrypt Key Data Failed"}));
-              return;
-            }
-
             auto encrypted_phrase = GFBufferFactory::Encrypt(pin, *p);
             if (!encrypted_phrase) {
               cb(-1, TransferParams(QString{"Encrypt Passphase Failed"}));
               return;
             }
 
-            auto succ = WriteFileGFBuffer(key_package_path, *encrypted);
+            // AES encrypt, large key data is streamed into the file
+            auto succ = false;
+            if (gf_buffer.Size() >= GFBufferFactory::kStreamEncryptThreshold) {
+              QFile file(key_package_path);
+              succ = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+              if (succ) {
+                file.setPermissions(QFileDevice::ReadOwner |
+                                    QFileDevice::WriteOwner);
+                succ = GFBufferFactory::EncryptStream(
+                    *p, MakeStreamReader(gf_buffer), MakeStreamWriter(&file));
+              }
+            } else {
+              auto encrypted = GFBufferFactory::Encrypt(*p, gf_buffer);
+              if (!encrypted) {
+                cb(-1, TransferParams(QString{"Encrypt Key Data Failed"}));
+                return;
+              }
+              succ = WriteFileGFBuffer(key_package_path, *encrypted);
+            }
+
             if (!succ) {
               cb(-1, TransferParams(QString{"Write Key Package Failed"}));
               return;
@@ -102,8 +115,13 @@ auto KeyPackageOperator::ImportKeyPackage(const QString& key_package_path,
                                           const QString& key_path,
                                           const GFBuffer& pin)
     -> std::tuple<QString, QSharedPointer<GpgImportInformation>> {
-  auto [succ_e, encrypted] = ReadFileGFBuffer(key_package_path);
-  if (!succ_e || encrypted.Empty()) return {{"Read Key Package Failed"}, {}};
+  QFile file(key_package_path);
+  if (!file.open(QIODevice::ReadOnly)) return {{"Read Key Package Failed"}, {}};
+
+  GFBuffer head(AESCryptoHelper::kStreamMagicSize);
+  head.Resize(std::max<qint64>(
+      file.peek(head.Data(), static_cast<qint64>(head.Size())), 0));
+  if (head.Empty()) return {{"Read Key Package Failed"}, {}};
 
   auto [succ_p, encrypted_passphrase] = ReadFileGFBuffer(key_path);
   if (!succ_p || encrypted_passphrase.Empty()) {
@@ -113,7 +131,21 @@ auto KeyPackageOperator::ImportKeyPackage(const QString& key_package_path,
   auto passphrase = GFBufferFactory::Decrypt(pin, encrypted_passphrase);
   if (!passphrase) return {{"Decrypt the Key of Key Package Failed"}, {}};
 
-  auto key_data = GFBufferFactory::Decrypt(*passphrase, encrypted);
+  GFBufferOrNone key_data;
+  if (GFBufferFactory::IsEncryptedStream(head)) {
+    key_data = GFBuffer{};
+    if (!GFBufferFactory::DecryptStream(*passphrase, MakeStreamReader(&file),
+                                        MakeStreamWriter(*key_data))) {
+      key_data.reset();
+    }
+  } else {
+    GFBuffer encrypted(static_cast<size_t>(file.size()));
+    if (file.read(encrypted.Data(), static_cast<qint64>(encrypted.Size())) !=
+        static_cast<qint64>(encrypted.Size())) {
+      return {{"Read Key Package Failed"}, {}};
+    }
+    key_data = GFBufferFactory::Decrypt(*passphrase, encrypted);
+  }
   if (!key_data) return {{"Decrypt the Key Package Failed"}, {}};
 
   auto p_info =
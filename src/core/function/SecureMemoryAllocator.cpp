@@ -25,21 +25,134 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  *
  */
-
 #include "SecureMemoryAllocator.h"
 
 #include <openssl/crypto.h>
 
+#include <array>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
 
 namespace GpgFrontend {
 class SecureMemoryAllocator;
 }
 
 namespace {
+
 QMutex instance_mutex;
-GpgFrontend::SecureMemoryAllocator* instance = nullptr;
+std::atomic<GpgFrontend::SecureMemoryAllocator*> instance = nullptr;
+
+constexpr quint32 kChunkInUse = 0x474D4155;  ///< "GMAU"
+constexpr quint32 kChunkFree = 0x474D4146;   ///< "GMAF"
+
+constexpr int kSizeClasses = 8;         ///< payloads of 32 B up to 4 KiB
+constexpr size_t kMinBlockShift = 5;    ///< the smallest block is 32 B
+constexpr quint8 kLargeChunk = 0xFF;    ///< size class of unpooled chunks
+constexpr int kThreadCacheLimit = 64;   ///< free blocks a thread keeps
+constexpr int kTransferBatch = 32;      ///< blocks moved to or from a depot
+constexpr size_t kSlabSize = 64 * 1024;
+constexpr size_t kSecSlabSize = 16 * 1024;  ///< the secure heap is small
+
+/**
+ * @brief header in front of every pooled chunk, and of the large chunks
+ * outside the secure heap, it replaces a global table of allocations
+ *
+ */
+struct alignas(16) ChunkHeader {
+  quint32 magic;      ///< kChunkInUse or kChunkFree
+  quint8 size_class;  ///< index of the size class or kLargeChunk
+  quint8 secure;      ///< whether it lives in the OpenSSL secure heap
+  union {
+    size_t size;        ///< requested size while in use
+    ChunkHeader* next;  ///< next free block while cached
+  };
+};
+static_assert(sizeof(ChunkHeader) == 16, "chunk header must keep alignment");
+
+/**
+ * @brief the payload a block of the size class holds, the header comes on
+ * top, so power of two requests like kSecBufferSize fit their class
+ *
+ */
+auto BlockSize(int size_class) -> size_t {
+  return size_t{1} << (static_cast<size_t>(size_class) + kMinBlockShift);
+}
+
+auto BlockStride(int size_class) -> size_t {
+  return BlockSize(size_class) + sizeof(ChunkHeader);
+}
+
+/**
+ * @brief the smallest size class fitting size
+ *
+ * @return int -1 if the allocation is too large to be pooled
+ */
+auto SizeClassOf(size_t size) -> int {
+  for (int c = 0; c < kSizeClasses; c++) {
+    if (size <= BlockSize(c)) return c;
+  }
+  return -1;
+}
+
+auto HeaderOf(void* ptr) -> ChunkHeader* {
+  return static_cast<ChunkHeader*>(ptr) - 1;
+}
+
+/**
+ * @brief intrusive list of free, zeroized blocks of one size class
+ *
+ */
+struct FreeList {
+  ChunkHeader* head = nullptr;
+  int count = 0;
+
+  void Push(ChunkHeader* chunk) {
+    chunk->next = head;
+    head = chunk;
+    count++;
+  }
+
+  auto Pop() -> ChunkHeader* {
+    auto* chunk = head;
+    if (chunk == nullptr) return nullptr;
+
+    head = chunk->next;
+    chunk->next = nullptr;
+    count--;
+    return chunk;
+  }
+
+  void MoveTo(FreeList& other, int n) {
+    while (n-- > 0 && head != nullptr) other.Push(Pop());
+  }
+};
+
+using FreeLists = std::array<std::array<FreeList, kSizeClasses>, 2>;
+
+/**
+ * @brief free blocks owned by the calling thread, the fast path of both
+ * allocation and deallocation touches nothing else
+ *
+ */
+struct ThreadCache {
+  FreeLists lists;
+
+  ~ThreadCache();
+};
+
+thread_local bool thread_cache_destroyed = false;
+
+auto LocalThreadCache() -> ThreadCache* {
+  // blocks freed by other thread_local destructors after this cache is
+  // gone go straight to the depots
+  if (thread_cache_destroyed) return nullptr;
+
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
 }  // namespace
 
 namespace GpgFrontend {
@@ -65,14 +178,56 @@ class SecureMemoryAllocator {
 
   void SecDeallocate(void*);
 
+  /**
+   * @brief hand blocks of a thread back to the shared depots
+   *
+   */
+  void ReturnToDepot(FreeLists& lists);
+
  private:
+  /**
+   * @brief shared free blocks of one size class, refilled from and
+   * drained by the thread caches in batches
+   *
+   */
+  struct Depot {
+    QMutex mutex;
+    FreeList list;
+  };
+
   int secure_level_;
-  QMutex mutex_;
-  QHash<void*, size_t> allocated_;
+  std::array<std::array<Depot, kSizeClasses>, 2> depots_;
+
+  /// sizes of the large chunks in the secure heap. it hands out power of
+  /// two blocks, a header in front would double a power of two request.
+  QMutex large_secure_mutex_;
+  std::unordered_map<void*, size_t> large_secure_chunks_;
+  std::atomic<size_t> large_secure_count_{0};  ///< skips the lookup if 0
 
   explicit SecureMemoryAllocator(int secure_level);
 
   ~SecureMemoryAllocator();
+
+  auto pool_allocate(size_t size, bool secure) -> void*;
+
+  auto pool_reallocate(void* ptr, size_t size, bool secure) -> void*;
+
+  void pool_deallocate(void* ptr);
+
+  void refill(FreeList& list, int size_class, bool secure);
+
+  void carve_slab(FreeList& list, int size_class, bool secure);
+
+  auto large_secure_allocate(size_t size) -> void*;
+
+  /**
+   * @brief Get the size of a large chunk in the secure heap
+   *
+   * @return size_t 0 if ptr is not one
+   */
+  auto large_secure_size(void* ptr) -> size_t;
+
+  void large_secure_deallocate(void* ptr, size_t size);
 };
 
 SecureMemoryAllocator::SecureMemoryAllocator(int secure_level)
@@ -87,16 +242,7 @@ auto SecureMemoryAllocator::Allocate(size_t size) -> void* {
   // should not do allocate
   if (size == 0) return nullptr;
 
-  auto* addr = OPENSSL_zalloc(size);
-  if (size != 0 && addr == nullptr) FLOG_F("OPENSSL_zalloc failed");
-
-  {
-    QMutexLocker locker(&mutex_);
-    Q_ASSERT(!allocated_.contains(addr));
-
-    allocated_[addr] = size;
-  }
-  return addr;
+  return pool_allocate(size, false);
 }
 
 auto SecureMemoryAllocator::Reallocate(void* ptr, size_t size) -> void* {
@@ -106,27 +252,7 @@ auto SecureMemoryAllocator::Reallocate(void* ptr, size_t size) -> void* {
   // low secure level
   if (secure_level_ < 1) return realloc(ptr, size);
 
-  if (ptr == nullptr) return Allocate(size);
-
-  {
-    QMutexLocker locker(&mutex_);
-    Q_ASSERT(allocated_.count(ptr) != 0);
-    if (allocated_.count(ptr) == 0) {
-      FLOG_W()
-          << "this memory address was not allocated by SecureMemoryAllocator: "
-          << ptr;
-      return nullptr;
-    }
-
-    const auto ptr_size = allocated_.value(ptr);
-    auto* addr = OPENSSL_clear_realloc(ptr, ptr_size, size);
-    if (size != 0 && addr == nullptr) FLOG_F("OPENSSL_clear_realloc failed");
-
-    allocated_.remove(ptr);
-    allocated_[addr] = size;
-
-    return addr;
-  }
+  return pool_reallocate(ptr, size, false);
 }
 
 void SecureMemoryAllocator::Deallocate(void* ptr) {
@@ -138,27 +264,17 @@ void SecureMemoryAllocator::Deallocate(void* ptr) {
 
   if (ptr == nullptr) return;
 
-  {
-    QMutexLocker locker(&mutex_);
-
-    Q_ASSERT(allocated_.contains(ptr));
-    if (!allocated_.contains(ptr)) {
-      FLOG_W()
-          << "this memory address was not allocated by SecureMemoryAllocator: "
-          << ptr;
-      return;
-    }
-
-    const auto ptr_size = allocated_.value(ptr);
-    OPENSSL_clear_free(ptr, ptr_size);
-    allocated_.remove(ptr);
-  }
+  pool_deallocate(ptr);
 }
 
 auto SecureMemoryAllocator::GetInstance() -> SecureMemoryAllocator* {
+  auto* p = instance.load(std::memory_order_acquire);
+  if (p != nullptr) return p;
+
   QMutexLocker locker(&instance_mutex);
 
-  if (instance == nullptr) {
+  p = instance.load(std::memory_order_relaxed);
+  if (p == nullptr) {
     auto secure_level = qApp->property("GFSecureLevel").toInt();
 
     void* addr = nullptr;
@@ -170,10 +286,11 @@ auto SecureMemoryAllocator::GetInstance() -> SecureMemoryAllocator* {
     }
     Q_ASSERT(addr != nullptr);
 
-    instance = new (addr) SecureMemoryAllocator(secure_level);
+    p = new (addr) SecureMemoryAllocator(secure_level);
+    instance.store(p, std::memory_order_release);
   }
 
-  return instance;
+  return p;
 }
 
 auto SMAMalloc(size_t size) -> void* {
@@ -192,33 +309,16 @@ auto SecureMemoryAllocator::SecAllocate(size_t size) -> void* {
   // middle secure level
   if (secure_level_ < 2) return Allocate(size);
 
-  auto* addr = OPENSSL_secure_zalloc(size);
-  if (addr == nullptr) FLOG_F("OPENSSL_secure_malloc failed");
-
-  {
-    QMutexLocker locker(&mutex_);
-    Q_ASSERT(!allocated_.contains(addr));
+  if (size == 0) return nullptr;
 
-    allocated_[addr] = size;
-  }
-  return addr;
+  return pool_allocate(size, true);
 }
 
 auto SecureMemoryAllocator::SecReallocate(void* ptr, size_t size) -> void* {
   // middle secure level
   if (secure_level_ < 2) return Reallocate(ptr, size);
 
-  void* new_addr = SecAllocate(size);
-  Q_ASSERT(new_addr != ptr);
-
-  if (ptr != nullptr) {
-    auto old_size = OPENSSL_secure_actual_size(ptr);
-    std::memcpy(new_addr, ptr, std::min(size, old_size));
-
-    SecDeallocate(ptr);
-  }
-
-  return new_addr;
+  return pool_reallocate(ptr, size, true);
 }
 
 void SecureMemoryAllocator::SecDeallocate(void* ptr) {
@@ -230,21 +330,199 @@ void SecureMemoryAllocator::SecDeallocate(void* ptr) {
 
   if (ptr == nullptr) return;
 
-  {
-    QMutexLocker locker(&mutex_);
-
-    Q_ASSERT(allocated_.contains(ptr));
-    if (!allocated_.contains(ptr)) {
-      FLOG_W()
-          << "this memory address was not allocated by SecureMemoryAllocator: "
-          << ptr;
-      return;
+  pool_deallocate(ptr);
+}
+
+auto SecureMemoryAllocator::pool_allocate(size_t size, bool secure) -> void* {
+  ChunkHeader* chunk = nullptr;
+
+  const auto size_class = SizeClassOf(size);
+  if (size_class < 0 && secure) return large_secure_allocate(size);
+  if (size_class < 0) {
+    const auto total = size + sizeof(ChunkHeader);
+    chunk = static_cast<ChunkHeader*>(OPENSSL_zalloc(total));
+    if (chunk == nullptr) FLOG_F("OPENSSL_zalloc failed");
+    chunk->size_class = kLargeChunk;
+  } else if (auto* cache = LocalThreadCache(); cache != nullptr) {
+    auto& list = cache->lists[secure ? 1 : 0][size_class];
+    if (list.head == nullptr) refill(list, size_class, secure);
+    chunk = list.Pop();
+  } else {
+    FreeList list;
+    refill(list, size_class, secure);
+    chunk = list.Pop();
+
+    FreeLists rest;
+    list.MoveTo(rest[secure ? 1 : 0][size_class], list.count);
+    ReturnToDepot(rest);
+  }
+
+  chunk->magic = kChunkInUse;
+  chunk->secure = secure ? 1 : 0;
+  chunk->size = size;
+  return chunk + 1;
+}
+
+auto SecureMemoryAllocator::pool_reallocate(void* ptr, size_t size,
+                                            bool secure) -> void* {
+  if (ptr == nullptr) return pool_allocate(size, secure);
+
+  if (const auto large_size = large_secure_size(ptr); large_size != 0) {
+    auto* addr = pool_allocate(size, true);
+    std::memcpy(addr, ptr, std::min(size, large_size));
+    large_secure_deallocate(ptr, large_size);
+    return addr;
+  }
+
+  auto* chunk = HeaderOf(ptr);
+  Q_ASSERT(chunk->magic == kChunkInUse);
+  if (chunk->magic != kChunkInUse) {
+    FLOG_W()
+        << "this memory address was not allocated by SecureMemoryAllocator: "
+        << ptr;
+    return nullptr;
+  }
+
+  // resize in place while the block is large enough
+  if (chunk->size_class != kLargeChunk &&
+      size <= BlockSize(chunk->size_class)) {
+    if (size < chunk->size) {
+      OPENSSL_cleanse(static_cast<char*>(ptr) + size, chunk->size - size);
+    }
+    chunk->size = size;
+    return ptr;
+  }
+
+  auto* addr = pool_allocate(size, chunk->secure != 0);
+  std::memcpy(addr, ptr, std::min(size, chunk->size));
+  pool_deallocate(ptr);
+  return addr;
+}
+
+void SecureMemoryAllocator::pool_deallocate(void* ptr) {
+  if (const auto large_size = large_secure_size(ptr); large_size != 0) {
+    large_secure_deallocate(ptr, large_size);
+    return;
+  }
+
+  auto* chunk = HeaderOf(ptr);
+
+  Q_ASSERT(chunk->magic == kChunkInUse);
+  if (chunk->magic != kChunkInUse) {
+    FLOG_W()
+        << "this memory address was not allocated by SecureMemoryAllocator: "
+        << ptr;
+    return;
+  }
+
+  if (chunk->size_class == kLargeChunk) {
+    const auto total = chunk->size + sizeof(ChunkHeader);
+    chunk->magic = kChunkFree;
+    if (chunk->secure != 0) {
+      OPENSSL_secure_clear_free(chunk, total);
+    } else {
+      OPENSSL_clear_free(chunk, total);
     }
+    return;
+  }
+
+  // blocks are kept zeroized, so they need no clearing on allocation
+  OPENSSL_cleanse(ptr, chunk->size);
+  chunk->magic = kChunkFree;
 
-    auto sz = OPENSSL_secure_actual_size(ptr);
-    OPENSSL_secure_clear_free(ptr, sz);
-    allocated_.remove(ptr);
+  const auto secure = chunk->secure;
+  const auto size_class = chunk->size_class;
+
+  auto* cache = LocalThreadCache();
+  if (cache == nullptr) {
+    FreeLists lists;
+    lists[secure][size_class].Push(chunk);
+    ReturnToDepot(lists);
+    return;
   }
+
+  auto& list = cache->lists[secure][size_class];
+  list.Push(chunk);
+  if (list.count <= kThreadCacheLimit) return;
+
+  auto& depot = depots_[secure][size_class];
+  QMutexLocker locker(&depot.mutex);
+  list.MoveTo(depot.list, kTransferBatch);
+}
+
+void SecureMemoryAllocator::ReturnToDepot(FreeLists& lists) {
+  for (size_t s = 0; s < lists.size(); s++) {
+    for (size_t c = 0; c < lists[s].size(); c++) {
+      auto& list = lists[s][c];
+      if (list.head == nullptr) continue;
+
+      auto& depot = depots_[s][c];
+      QMutexLocker locker(&depot.mutex);
+      list.MoveTo(depot.list, list.count);
+    }
+  }
+}
+
+void SecureMemoryAllocator::refill(FreeList& list, int size_class,
+                                   bool secure) {
+  {
+    auto& depot = depots_[secure ? 1 : 0][size_class];
+    QMutexLocker locker(&depot.mutex);
+    depot.list.MoveTo(list, kTransferBatch);
+  }
+
+  if (list.head == nullptr) carve_slab(list, size_class, secure);
+}
+
+void SecureMemoryAllocator::carve_slab(FreeList& list, int size_class,
+                                       bool secure) {
+  const auto block_size = BlockStride(size_class);
+
+  // a power of two, which the secure heap hands out without rounding up,
+  // holding a few blocks at least
+  auto slab_size = secure ? kSecSlabSize : kSlabSize;
+  while (slab_size < 4 * block_size) slab_size *= 2;
+
+  // slabs stay with the allocator for the lifetime of the process
+  auto* slab = static_cast<std::byte*>(secure ? OPENSSL_secure_zalloc(slab_size)
+                                              : OPENSSL_zalloc(slab_size));
+  if (slab == nullptr) FLOG_F("OPENSSL_zalloc failed");
+
+  for (size_t offset = 0; offset + block_size <= slab_size;
+       offset += block_size) {
+    auto* chunk = reinterpret_cast<ChunkHeader*>(slab + offset);
+    chunk->magic = kChunkFree;
+    chunk->size_class = static_cast<quint8>(size_class);
+    chunk->secure = secure ? 1 : 0;
+    list.Push(chunk);
+  }
+}
+
+auto SecureMemoryAllocator::large_secure_allocate(size_t size) -> void* {
+  auto* ptr = OPENSSL_secure_zalloc(size);
+  if (ptr == nullptr) FLOG_F("OPENSSL_secure_zalloc failed");
+
+  QMutexLocker locker(&large_secure_mutex_);
+  large_secure_chunks_.emplace(ptr, size);
+  large_secure_count_++;
+  return ptr;
+}
+
+auto SecureMemoryAllocator::large_secure_size(void* ptr) -> size_t {
+  if (large_secure_count_.load() == 0) return 0;
+
+  QMutexLocker locker(&large_secure_mutex_);
+  auto it = large_secure_chunks_.find(ptr);
+  return it != large_secure_chunks_.end() ? it->second : 0;
+}
+
+void SecureMemoryAllocator::large_secure_deallocate(void* ptr, size_t size) {
+  {
+    QMutexLocker locker(&large_secure_mutex_);
+    large_secure_chunks_.erase(ptr);
+    large_secure_count_--;
+  }
+  OPENSSL_secure_clear_free(ptr, size);
 }
 
 auto SMASecMalloc(size_t size) -> void* {
@@ -259,4 +537,15 @@ void SMASecFree(void* ptr) {
   SecureMemoryAllocator::GetInstance()->SecDeallocate(ptr);
 }
 
-}  // namespace GpgFrontend
\ No newline at end of file
+}  // namespace GpgFrontend
+
+namespace {
+
+ThreadCache::~ThreadCache() {
+  thread_cache_destroyed = true;
+
+  auto* allocator = instance.load(std::memory_order_acquire);
+  if (allocator != nullptr) allocator->ReturnToDepot(lists);
+}
+
+}  // namespace
@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "SettingsObjectStore.h"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include "core/function/CoreSignalStation.h"
+#include "core/function/DataObjectOperator.h"
+#include "core/thread/TaskRunnerGetter.h"
+#include "core/utils/MemoryUtils.h"
+
+namespace GpgFrontend {
+
+class SettingsObjectStore::Impl {
+ public:
+  explicit Impl(int channel)
+      : channel_(channel),
+        runner_(Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
+            Thread::TaskRunnerGetter::kTaskRunnerType_IO)) {
+    // the flush runs go through the guard, they may still be posted or
+    // running on an IO worker when this is destroyed
+    run_guard_->impl = this;
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard lock(lock_);
+      runner_->CancelScheduleTask(flush_timer_);
+    }
+
+    // waits for a run in progress, the runs posted later find no Impl
+    std::unique_lock lock(run_guard_->lock);
+    run_guard_->impl = nullptr;
+  }
+
+  auto Load(const QString& name) -> QJsonObject {
+    GFBuffer cached;
+    {
+      std::lock_guard lock(lock_);
+      auto it = objects_.constFind(name);
+      if (it != objects_.cend()) cached = it.value();
+    }
+
+    if (cached.Empty()) {
+      cached = load_object(name);
+
+      std::lock_guard lock(lock_);
+      // another thread may have loaded or changed it in the meantime
+      auto it = objects_.constFind(name);
+      if (it != objects_.cend()) {
+        cached = it.value();
+      } else {
+        objects_.insert(name, cached);
+      }
+    }
+
+    return QJsonDocument::fromJson(cached.ConvertToQByteArray()).object();
+  }
+
+  void Save(const QString& name, const QJsonObject& value) {
+    auto serialized =
+        GFBuffer(QJsonDocument(value).toJson(QJsonDocument::Compact));
+
+    {
+      std::lock_guard lock(lock_);
+      auto it = objects_.find(name);
+      if (it != objects_.end() && it.value() == serialized) return;
+
+      objects_.insert(name, serialized);
+      dirty_.insert(name);
+      schedule_flush();
+    }
+
+    emit CoreSignalStation::GetInstance()->SignalSettingsObjectChanged(name);
+  }
+
+  void Flush() {
+    std::lock_guard flush_lock(flush_lock_);
+
+    QStringList names;
+    QContainer<QPair<QString, GFBuffer>> objects;
+    {
+      std::lock_guard lock(lock_);
+      for (const auto& name : dirty_) {
+        names.append(name);
+        objects.push_back({name, objects_.value(name)});
+      }
+      dirty_.clear();
+    }
+    if (objects.isEmpty()) return;
+
+    FLOG_D("writing back %lld settings objects",
+           static_cast<long long>(objects.size()));
+
+    auto refs = opera_.StoreSecDataObjs(objects);
+
+    std::lock_guard lock(lock_);
+    for (qsizetype i = 0; i < names.size(); i++) {
+      if (refs.value(i).isEmpty()) {
+        LOG_W() << "failed to write back settings object:" << names[i];
+        dirty_.insert(names[i]);
+        continue;
+      }
+      write_count_++;
+    }
+  }
+
+  auto GetWriteCount() -> qint64 {
+    std::lock_guard lock(lock_);
+    return write_count_;
+  }
+
+ private:
+  /**
+   * @brief read a settings object from the data object store, an empty
+   * object if there isn't one yet
+   *
+   * @param name
+   * @return GFBuffer compact json
+   */
+  auto load_object(const QString& name) -> GFBuffer {
+    QJsonObject object;
+    try {
+      auto json = opera_.GetDataObject(name);
+      if (json.has_value() && json->isObject()) object = json->object();
+    } catch (std::exception& e) {
+      LOG_W() << "load setting object error:" << e.what();
+    }
+    return GFBuffer(QJsonDocument(object).toJson(QJsonDocument::Compact));
+  }
+
+  /**
+   * @brief write the changes back shortly, changes made in the meantime are
+   * written by the same run. the caller holds lock_.
+   *
+   */
+  void schedule_flush() {
+    Thread::TaskScheduler::Options options;
+    options.delay = std::chrono::seconds(1);
+    options.coalesce_key =
+        QString("settings_object_store/%1/flush").arg(channel_);
+    flush_timer_ = runner_->PostScheduleTask(
+        "settings_object_store_flush",
+        [guard = run_guard_](const DataObjectPtr&) -> int {
+          std::shared_lock lock(guard->lock);
+          if (guard->impl != nullptr) guard->impl->Flush();
+          return 0;
+        },
+        options);
+  }
+
+  int channel_;
+  Thread::TaskRunnerPtr runner_;
+  DataObjectOperator& opera_ = DataObjectOperator::GetInstance(channel_);
+
+  std::mutex lock_;
+  std::mutex flush_lock_;
+  QMap<QString, GFBuffer> objects_;
+  QSet<QString> dirty_;
+  qint64 write_count_ = 0;
+  Thread::TaskScheduler::TimerID flush_timer_ =
+      Thread::TaskScheduler::kInvalidTimerID;
+
+  struct RunGuard {
+    std::shared_mutex lock;
+    Impl* impl = nullptr;
+  };
+  std::shared_ptr<RunGuard> run_guard_ = std::make_shared<RunGuard>();
+};
+
+SettingsObjectStore::SettingsObjectStore(int channel)
+    : SingletonFunctionObject<SettingsObjectStore>(channel),
+      p_(SecureCreateUniqueObject<Impl>(channel)) {}
+
+SettingsObjectStore::~SettingsObjectStore() = default;
+
+auto SettingsObjectStore::Load(const QString& name) -> QJsonObject {
+  return p_->Load(name);
+}
+
+void SettingsObjectStore::Save(const QString& name, const QJsonObject& value) {
+  p_->Save(name, value);
+}
+
+void SettingsObjectStore::Flush() { p_->Flush(); }
+
+auto SettingsObjectStore::GetWriteCount() -> qint64 {
+  return p_->GetWriteCount();
+}
+
+}  // namespace GpgFrontend
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#pragma once
+
+#include "core/function/basic/GpgFunctionObject.h"
+
+namespace GpgFrontend {
+
+/**
+ * @brief process wide cache of the settings objects. values are kept
+ * decrypted in secure memory, changed objects are written back in batches
+ * shortly after the change and when the core shuts down.
+ *
+ */
+class GF_CORE_EXPORT SettingsObjectStore
+    : public SingletonFunctionObject<SettingsObjectStore> {
+ public:
+  /**
+   * @brief Construct a new Settings Object Store object
+   *
+   * @param channel
+   */
+  explicit SettingsObjectStore(
+      int channel = SingletonFunctionObject::GetDefaultChannel());
+
+  /**
+   * @brief Destroy the Settings Object Store object
+   *
+   */
+  ~SettingsObjectStore() override;
+
+  /**
+   * @brief Get a settings object, read from disk only the first time
+   *
+   * @param name
+   * @return QJsonObject
+   */
+  auto Load(const QString& name) -> QJsonObject;
+
+  /**
+   * @brief Set a settings object. nothing happens if the value didn't
+   * change, otherwise SignalSettingsObjectChanged is emitted and a write
+   * back is scheduled.
+   *
+   * @param name
+   * @param value
+   */
+  void Save(const QString& name, const QJsonObject& value);
+
+  /**
+   * @brief write all changed settings objects to disk now
+   *
+   */
+  void Flush();
+
+  /**
+   * @brief Get the number of settings objects written to disk so far
+   *
+   * @return qint64
+   */
+  auto GetWriteCount() -> qint64;
+
+ private:
+  class Impl;
+  SecureUniquePtr<Impl> p_;
+};
+
+}  // namespace GpgFrontend
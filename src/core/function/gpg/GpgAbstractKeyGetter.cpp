@@ -62,6 +62,15 @@ auto GpgAbstractKeyGetter::FlushCache() -> bool {
   return key_.FlushKeyCache() && kg_.FlushCache();
 }
 
+auto GpgAbstractKeyGetter::UpdateCache(const KeyIdArgsList& key_ids)
+    -> GpgKeyPtrList {
+  auto keys = key_.UpdateKeyCache(key_ids);
+
+  // key groups depend on the state of their keys
+  kg_.FlushCache();
+  return keys;
+}
+
 auto GpgAbstractKeyGetter::GetKey(const QString& key_id) -> GpgAbstractKeyPtr {
   if (IsKeyGroupID(key_id)) {
     return kg_.KeyGroup(key_id);
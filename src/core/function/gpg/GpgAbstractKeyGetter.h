@@ -86,6 +86,14 @@ class GF_CORE_EXPORT GpgAbstractKeyGetter
    */
   auto FlushCache() -> bool;
 
+  /**
+   * @brief refresh only the given keys in the cache
+   *
+   * @param key_ids fingerprints or ids of the touched keys
+   * @return GpgKeyPtrList the refreshed keys which still exist
+   */
+  auto UpdateCache(const KeyIdArgsList& key_ids) -> GpgKeyPtrList;
+
   /**
    * @brief
    *
@@ -92,7 +92,8 @@ void GpgBasicOperator::Encrypt(const GpgAbstractKeyPtrList& keys,
       [=](const DataObjectPtr& data_object) {
         return EncryptImpl(ctx_, keys, in_buffer, ascii, data_object);
       },
-      cb, "gpgme_op_encrypt", "2.2.0");
+      cb, "gpgme_op_encrypt", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::EncryptSync(const GpgAbstractKeyPtrList& keys,
@@ -113,7 +114,8 @@ void GpgBasicOperator::EncryptSymmetric(const GFBuffer& in_buffer, bool ascii,
       [=](const DataObjectPtr& data_object) {
         return EncryptImpl(ctx_, {}, in_buffer, ascii, data_object);
       },
-      cb, "gpgme_op_encrypt_symmetric", "2.2.0");
+      cb, "gpgme_op_encrypt_symmetric", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::EncryptSymmetricSync(const GFBuffer& in_buffer,
@@ -149,7 +151,8 @@ void GpgBasicOperator::Decrypt(const GFBuffer& in_buffer,
       [=](const DataObjectPtr& data_object) {
         return DecryptImpl(ctx_, in_buffer, data_object);
       },
-      cb, "gpgme_op_decrypt", "2.2.0");
+      cb, "gpgme_op_decrypt", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::DecryptSync(const GFBuffer& in_buffer)
@@ -195,7 +198,8 @@ void GpgBasicOperator::Verify(const GFBuffer& in_buffer,
       [=](const DataObjectPtr& data_object) -> GpgError {
         return VerifyImpl(ctx_, in_buffer, sig_buffer, data_object);
       },
-      cb, "gpgme_op_verify", "2.2.0");
+      cb, "gpgme_op_verify", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::VerifySync(const GFBuffer& in_buffer,
@@ -240,7 +244,8 @@ void GpgBasicOperator::Sign(const GpgAbstractKeyPtrList& signers,
       [=](const DataObjectPtr& data_object) {
         return SignImpl(ctx_, signers, in_buffer, mode, ascii, data_object);
       },
-      cb, "gpgme_op_sign", "2.2.0");
+      cb, "gpgme_op_sign", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::SignSync(const GpgAbstractKeyPtrList& signers,
@@ -281,7 +286,8 @@ void GpgBasicOperator::DecryptVerify(const GFBuffer& in_buffer,
       [=](const DataObjectPtr& data_object) {
         return DecryptVerifyImpl(ctx_, in_buffer, data_object);
       },
-      cb, "gpgme_op_decrypt_verify", "2.2.0");
+      cb, "gpgme_op_decrypt_verify", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::DecryptVerifySync(const GFBuffer& in_buffer)
@@ -333,7 +339,8 @@ void GpgBasicOperator::EncryptSign(const GpgAbstractKeyPtrList& keys,
         return EncryptSignImpl(ctx_, keys, signers, in_buffer, ascii,
                                data_object);
       },
-      cb, "gpgme_op_encrypt_sign", "2.2.0");
+      cb, "gpgme_op_encrypt_sign", "2.2.0",
+      Thread::Task::kPriority_Interactive);
 }
 
 auto GpgBasicOperator::EncryptSignSync(const GpgAbstractKeyPtrList& keys,
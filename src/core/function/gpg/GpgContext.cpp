@@ -32,6 +32,7 @@
 #include <gpgme.h>
 
 #include <cassert>
+#include <condition_variable>
 #include <mutex>
 
 #include "core/function/CoreSignalStation.h"
@@ -42,6 +43,13 @@
 #include "core/utils/GpgUtils.h"
 #include "core/utils/MemoryUtils.h"
 
+namespace {
+
+// pooled context slot leased to the current thread, per context
+thread_local QHash<const void *, int> leased_pool_slots;
+
+}  // namespace
+
 namespace GpgFrontend {
 
 class GpgAgentProcess {
@@ -164,13 +172,53 @@ class GpgContext::Impl {
     if (binary_ctx_ref_ != nullptr) {
       gpgme_release(binary_ctx_ref_);
     }
+
+    for (const auto &pair : pool_) {
+      gpgme_release(pair.default_ctx);
+      gpgme_release(pair.binary_ctx);
+    }
   }
 
   [[nodiscard]] auto BinaryContext() const -> gpgme_ctx_t {
-    return binary_ctx_ref_;
+    const auto slot = leased_pool_slots.value(this, -1);
+    return slot < 0 ? binary_ctx_ref_ : pool_[slot].binary_ctx;
+  }
+
+  [[nodiscard]] auto DefaultContext() const -> gpgme_ctx_t {
+    const auto slot = leased_pool_slots.value(this, -1);
+    return slot < 0 ? ctx_ref_ : pool_[slot].default_ctx;
+  }
+
+  [[nodiscard]] auto ContextPoolSize() const -> int {
+    return static_cast<int>(pool_.size());
+  }
+
+  /**
+   * @brief lease a free pooled context pair to the calling thread
+   *
+   * @return int the slot, -1 if nothing was leased (nested lease or no pool)
+   */
+  auto AcquirePoolSlot() -> int {
+    if (pool_.isEmpty() || leased_pool_slots.contains(this)) return -1;
+
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    pool_cv_.wait(lock, [this] { return !free_pool_slots_.isEmpty(); });
+
+    const auto slot = free_pool_slots_.takeLast();
+    leased_pool_slots.insert(this, slot);
+    return slot;
   }
 
-  [[nodiscard]] auto DefaultContext() const -> gpgme_ctx_t { return ctx_ref_; }
+  void ReleasePoolSlot(int slot) {
+    if (slot < 0) return;
+    leased_pool_slots.remove(this);
+
+    {
+      std::lock_guard<std::mutex> const lock(pool_mutex_);
+      free_pool_slots_.append(slot);
+    }
+    pool_cv_.notify_one();
+  }
 
   [[nodiscard]] auto Good() const -> bool { return good_; }
 
@@ -245,6 +293,16 @@ class GpgContext::Impl {
   gpgme_ctx_t cms_binary_ctx_ref_ = nullptr;  ///<
   bool good_ = true;
 
+  struct ContextPair {
+    gpgme_ctx_t default_ctx = nullptr;
+    gpgme_ctx_t binary_ctx = nullptr;
+  };
+
+  QVector<ContextPair> pool_;     ///< leased to parallel operations
+  QVector<int> free_pool_slots_;  ///<
+  std::mutex pool_mutex_;
+  std::condition_variable pool_cv_;
+
   std::mutex ctx_ref_lock_;
   std::mutex binary_ctx_ref_lock_;
 
@@ -266,6 +324,12 @@ class GpgContext::Impl {
     good_ = launch_gpg_agent() && default_ctx_initialize(args) &&
             binary_ctx_initialize(args) && cms_default_ctx_initialize(args) &&
             cms_binary_ctx_initialize(args);
+
+    // operations fall back to the primary contexts without a pool
+    if (good_ && !pool_initialize(args)) {
+      LOG_W() << "gpg context pool init failed, channel:"
+              << parent_->GetChannel();
+    }
   }
 
   static auto component_type_to_q_string(GpgComponentType type) -> QString {
@@ -482,6 +546,43 @@ class GpgContext::Impl {
     return true;
   }
 
+  auto new_openpgp_ctx(const GpgContextInitArgs &args, bool armor)
+      -> gpgme_ctx_t {
+    gpgme_ctx_t p_ctx;
+    if (CheckGpgError(gpgme_new(&p_ctx)) != GPG_ERR_NO_ERROR) {
+      FLOG_W("get new ctx failed, pool");
+      return nullptr;
+    }
+
+    if (!common_ctx_initialize(p_ctx, args)) {
+      gpgme_release(p_ctx);
+      return nullptr;
+    }
+
+    gpgme_set_armor(p_ctx, armor ? 1 : 0);
+    return p_ctx;
+  }
+
+  auto pool_initialize(const GpgContextInitArgs &args) -> bool {
+    for (int i = 0; i < args.context_pool_size; i++) {
+      ContextPair pair{new_openpgp_ctx(args, true),
+                       new_openpgp_ctx(args, false)};
+
+      if (pair.default_ctx == nullptr || pair.binary_ctx == nullptr) {
+        gpgme_release(pair.default_ctx);
+        gpgme_release(pair.binary_ctx);
+        return false;
+      }
+
+      pool_.append(pair);
+      free_pool_slots_.append(i);
+    }
+
+    LOG_D() << "gpg context pool initialized, channel:"
+            << parent_->GetChannel() << "size:" << pool_.size();
+    return true;
+  }
+
   void get_gpg_conf_dirs() {
     auto gpgconf_path = QFileInfo(this->gpgconf_path_).absoluteFilePath();
     LOG_D() << "context: " << parent_->GetChannel()
@@ -588,6 +689,15 @@ auto GpgContext::DefaultContext() -> gpgme_ctx_t {
   return p_->DefaultContext();
 }
 
+auto GpgContext::ContextPoolSize() const -> int {
+  return p_->ContextPoolSize();
+}
+
+GpgContext::ContextLease::ContextLease(GpgContext *ctx)
+    : ctx_(ctx), slot_(ctx->p_->AcquirePoolSlot()) {}
+
+GpgContext::ContextLease::~ContextLease() { ctx_->p_->ReleasePoolSlot(slot_); }
+
 GpgContext::~GpgContext() = default;
 
 auto GpgContext::HomeDirectory() const -> QString {
@@ -47,6 +47,8 @@ struct GpgContextInitArgs {
   bool test_mode = false;                ///<
   bool offline_mode = false;             ///<
   bool auto_import_missing_key = false;  ///<
+
+  int context_pool_size = 1;  ///< contexts available to parallel operations
 };
 
 enum class GpgComponentType : std::uint8_t {
@@ -62,6 +64,28 @@ enum class GpgComponentType : std::uint8_t {
  */
 class GF_CORE_EXPORT GpgContext : public SingletonFunctionObject<GpgContext> {
  public:
+  /**
+   * @brief borrows a context pair from the pool of this channel. While a
+   * lease is alive, DefaultContext() and BinaryContext() called from the
+   * same thread resolve to the leased pair instead of the primary one.
+   * Constructing a lease blocks until a pooled pair is free.
+   *
+   */
+  class GF_CORE_EXPORT ContextLease {
+   public:
+    explicit ContextLease(GpgContext* ctx);
+
+    ~ContextLease();
+
+    ContextLease(const ContextLease&) = delete;
+
+    auto operator=(const ContextLease&) -> ContextLease& = delete;
+
+   private:
+    GpgContext* ctx_;
+    int slot_;
+  };
+
   explicit GpgContext(int channel);
 
   explicit GpgContext(GpgContextInitArgs args, int channel);
@@ -90,6 +114,13 @@ class GF_CORE_EXPORT GpgContext : public SingletonFunctionObject<GpgContext> {
    */
   auto DefaultContext() -> gpgme_ctx_t;
 
+  /**
+   * @brief
+   *
+   * @return int number of pooled context pairs
+   */
+  [[nodiscard]] auto ContextPoolSize() const -> int;
+
   /**
    * @brief
    *
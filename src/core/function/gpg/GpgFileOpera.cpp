@@ -50,30 +50,48 @@ auto ExtractArchiveHelper(const QString& out_path)
 }
 
 void CreateArchiveHelper(const QString& in_path,
-                         const QSharedPointer<GFDataExchanger>& ex) {
+                         const QSharedPointer<GFDataExchanger>& ex,
+                         const ArchiveCompression& compression) {
   auto w_ex = QWeakPointer<GFDataExchanger>(ex);
 
   ArchiveFileOperator::NewArchive2DataExchanger(
-      in_path, ex, [=](GFError err, const DataObjectPtr&) {
+      in_path, ex,
+      [=](GFError err, const DataObjectPtr&) {
         FLOG_D("new archive 2 data exchanger operation, err: %d", err);
         if (decltype(ex) p_ex = w_ex.lock(); err < 0 && p_ex != nullptr) {
           ex->CloseWrite();
         }
-      });
+      },
+      compression);
+}
+
+/**
+ * @brief an archive compressed by our own filter stage gains nothing from a
+ * second, single threaded compression pass in gpg. the compression has to
+ * be the applied one, an archive whose filter fell back to plain tar is
+ * still left to gpg to compress
+ *
+ */
+auto DirectoryEncryptFlags(const ArchiveCompression& compression)
+    -> gpgme_encrypt_flags_t {
+  auto flags = static_cast<unsigned int>(GPGME_ENCRYPT_ALWAYS_TRUST);
+  if (compression.IsEnabled()) flags |= GPGME_ENCRYPT_NO_COMPRESS;
+  return static_cast<gpgme_encrypt_flags_t>(flags);
 }
 
 GpgFileOpera::GpgFileOpera(int channel)
     : SingletonFunctionObject<GpgFileOpera>(channel) {}
 
-auto EncryptFileGpgDataImpl(GpgContext& ctx_, const GpgAbstractKeyPtrList& keys,
-                            GpgData& data_in, bool ascii, GpgData& data_out,
-                            const DataObjectPtr& data_object) -> GpgError {
+auto EncryptFileGpgDataImpl(
+    GpgContext& ctx_, const GpgAbstractKeyPtrList& keys, GpgData& data_in,
+    bool ascii, GpgData& data_out, const DataObjectPtr& data_object,
+    gpgme_encrypt_flags_t flags = GPGME_ENCRYPT_ALWAYS_TRUST) -> GpgError {
   auto recipients = Convert2RawGpgMEKeyList(ctx_.GetChannel(), keys);
   auto* ctx = ascii ? ctx_.DefaultContext() : ctx_.BinaryContext();
 
   auto err = CheckGpgError(
       gpgme_op_encrypt(ctx, keys.isEmpty() ? nullptr : recipients.data(),
-                       GPGME_ENCRYPT_ALWAYS_TRUST, data_in, data_out));
+                       flags, data_in, data_out));
   data_object->Swap({GpgEncryptResult(gpgme_op_encrypt_result(ctx))});
   return err;
 }
@@ -99,7 +117,8 @@ void GpgFileOpera::EncryptFile(const GpgAbstractKeyPtrList& keys,
         return EncryptFileImpl(ctx_, keys, in_path, ascii, out_path,
                                data_object);
       },
-      cb, "gpgme_op_encrypt", "2.2.0");
+      cb, "gpgme_op_encrypt", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::EncryptFileSync(const GpgAbstractKeyPtrList& keys,
@@ -120,6 +139,7 @@ void GpgFileOpera::EncryptDirectory(const GpgAbstractKeyPtrList& keys,
                                     const QString& out_path,
                                     const GpgOperationCallback& cb) {
   auto ex = CreateStandardGFDataExchanger();
+  auto compression = ArchiveCompression::FromSettings().Applied();
 
   RunGpgOperaAsync(
       GetChannel(),
@@ -128,11 +148,13 @@ void GpgFileOpera::EncryptDirectory(const GpgAbstractKeyPtrList& keys,
         GpgData data_out(out_path, false);
 
         return EncryptFileGpgDataImpl(ctx_, keys, data_in, ascii, data_out,
-                                      data_object);
+                                      data_object,
+                                      DirectoryEncryptFlags(compression));
       },
-      cb, "gpgme_op_encrypt", "2.2.0");
+      cb, "gpgme_op_encrypt", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 
-  CreateArchiveHelper(in_path, ex);
+  CreateArchiveHelper(in_path, ex, compression);
 }
 
 auto DecryptFileGpgDataImpl(GpgContext& ctx_, GpgData& data_in,
@@ -162,7 +184,8 @@ void GpgFileOpera::DecryptFile(const QString& in_path, const QString& out_path,
       [=](const DataObjectPtr& data_object) {
         return DecryptFileImpl(ctx_, in_path, out_path, data_object);
       },
-      cb, "gpgme_op_decrypt", "2.2.0");
+      cb, "gpgme_op_decrypt", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::DecryptFileSync(const QString& in_path,
@@ -189,7 +212,8 @@ void GpgFileOpera::DecryptArchive(const QString& in_path,
 
         return DecryptFileGpgDataImpl(ctx_, data_in, data_out, data_object);
       },
-      cb, "gpgme_op_decrypt", "2.2.0");
+      cb, "gpgme_op_decrypt", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto SignFileGpgDataImpl(GpgContext& ctx_, GpgBasicOperator& basic_opera_,
@@ -232,7 +256,8 @@ void GpgFileOpera::SignFile(const GpgAbstractKeyPtrList& keys,
         return SignFileImpl(ctx_, basic_opera_, keys, in_path, ascii, out_path,
                             data_object);
       },
-      cb, "gpgme_op_sign", "2.2.0");
+      cb, "gpgme_op_sign", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::SignFileSync(const GpgAbstractKeyPtrList& keys,
@@ -279,7 +304,8 @@ void GpgFileOpera::VerifyFile(const QString& data_path,
       [=](const DataObjectPtr& data_object) -> GpgError {
         return VerifyFileImpl(ctx_, data_path, sign_path, data_object);
       },
-      cb, "gpgme_op_verify", "2.2.0");
+      cb, "gpgme_op_verify", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::VerifyFileSync(const QString& data_path,
@@ -298,15 +324,17 @@ auto EncryptSignFileGpgDataImpl(GpgContext& ctx_,
                                 const GpgAbstractKeyPtrList& keys,
                                 const GpgAbstractKeyPtrList& signer_keys,
                                 GpgData& data_in, bool ascii, GpgData& data_out,
-                                const DataObjectPtr& data_object) -> GpgError {
+                                const DataObjectPtr& data_object,
+                                gpgme_encrypt_flags_t flags =
+                                    GPGME_ENCRYPT_ALWAYS_TRUST) -> GpgError {
   GpgError err;
   auto recipients = Convert2RawGpgMEKeyList(ctx_.GetChannel(), keys);
 
   basic_opera_.SetSigners(signer_keys, ascii);
 
   auto* ctx = ascii ? ctx_.DefaultContext() : ctx_.BinaryContext();
-  err = CheckGpgError(gpgme_op_encrypt_sign(
-      ctx, recipients.data(), GPGME_ENCRYPT_ALWAYS_TRUST, data_in, data_out));
+  err = CheckGpgError(gpgme_op_encrypt_sign(ctx, recipients.data(), flags,
+                                            data_in, data_out));
 
   data_object->Swap({
       GpgEncryptResult(gpgme_op_encrypt_result(ctx)),
@@ -340,7 +368,8 @@ void GpgFileOpera::EncryptSignFile(const GpgAbstractKeyPtrList& keys,
         return EncryptSignFileImpl(ctx_, basic_opera_, keys, signer_keys,
                                    in_path, ascii, out_path, data_object);
       },
-      cb, "gpgme_op_encrypt_sign", "2.2.0");
+      cb, "gpgme_op_encrypt_sign", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::EncryptSignFileSync(const GpgAbstractKeyPtrList& keys,
@@ -362,6 +391,7 @@ void GpgFileOpera::EncryptSignDirectory(
     const QString& in_path, bool ascii, const QString& out_path,
     const GpgOperationCallback& cb) {
   auto ex = CreateStandardGFDataExchanger();
+  auto compression = ArchiveCompression::FromSettings().Applied();
 
   RunGpgOperaAsync(
       GetChannel(),
@@ -369,13 +399,14 @@ void GpgFileOpera::EncryptSignDirectory(
         GpgData data_in(ex);
         GpgData data_out(out_path, false);
 
-        return EncryptSignFileGpgDataImpl(ctx_, basic_opera_, keys, signer_keys,
-                                          data_in, ascii, data_out,
-                                          data_object);
+        return EncryptSignFileGpgDataImpl(
+            ctx_, basic_opera_, keys, signer_keys, data_in, ascii, data_out,
+            data_object, DirectoryEncryptFlags(compression));
       },
-      cb, "gpgme_op_encrypt_sign", "2.2.0");
+      cb, "gpgme_op_encrypt_sign", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 
-  CreateArchiveHelper(in_path, ex);
+  CreateArchiveHelper(in_path, ex, compression);
 }
 
 auto DecryptVerifyFileGpgDataImpl(GpgContext& ctx_, GpgData& data_in,
@@ -409,7 +440,8 @@ void GpgFileOpera::DecryptVerifyFile(const QString& in_path,
       [=](const DataObjectPtr& data_object) -> GpgError {
         return DecryptVerifyFileImpl(ctx_, in_path, out_path, data_object);
       },
-      cb, "gpgme_op_decrypt_verify", "2.2.0");
+      cb, "gpgme_op_decrypt_verify", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::DecryptVerifyFileSync(const QString& in_path,
@@ -436,7 +468,8 @@ void GpgFileOpera::DecryptVerifyArchive(const QString& in_path,
         return DecryptVerifyFileGpgDataImpl(ctx_, data_in, data_out,
                                             data_object);
       },
-      cb, "gpgme_op_decrypt_verify", "2.2.0");
+      cb, "gpgme_op_decrypt_verify", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 void GpgFileOpera::EncryptFileSymmetric(const QString& in_path, bool ascii,
@@ -447,7 +480,8 @@ void GpgFileOpera::EncryptFileSymmetric(const QString& in_path, bool ascii,
       [=](const DataObjectPtr& data_object) -> GpgError {
         return EncryptFileImpl(ctx_, {}, in_path, ascii, out_path, data_object);
       },
-      cb, "gpgme_op_encrypt_symmetric", "2.2.0");
+      cb, "gpgme_op_encrypt_symmetric", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 }
 
 auto GpgFileOpera::EncryptFileSymmetricSync(const QString& in_path, bool ascii,
@@ -465,6 +499,7 @@ void GpgFileOpera::EncryptDirectorySymmetric(const QString& in_path, bool ascii,
                                              const QString& out_path,
                                              const GpgOperationCallback& cb) {
   auto ex = CreateStandardGFDataExchanger();
+  auto compression = ArchiveCompression::FromSettings().Applied();
 
   RunGpgOperaAsync(
       GetChannel(),
@@ -473,11 +508,13 @@ void GpgFileOpera::EncryptDirectorySymmetric(const QString& in_path, bool ascii,
         GpgData data_out(out_path, false);
 
         return EncryptFileGpgDataImpl(ctx_, {}, data_in, ascii, data_out,
-                                      data_object);
+                                      data_object,
+                                      DirectoryEncryptFlags(compression));
       },
-      cb, "gpgme_op_encrypt_symmetric", "2.2.0");
+      cb, "gpgme_op_encrypt_symmetric", "2.2.0",
+      Thread::Task::kPriority_Bulk);
 
-  CreateArchiveHelper(in_path, ex);
+  CreateArchiveHelper(in_path, ex, compression);
 }
 
 auto GpgFileOpera::EncryptDirectorySymmetricSync(const QString& in_path,
@@ -485,8 +522,9 @@ auto GpgFileOpera::EncryptDirectorySymmetricSync(const QString& in_path,
                                                  const QString& out_path)
     -> std::tuple<GpgError, DataObjectPtr> {
   auto ex = CreateStandardGFDataExchanger();
+  auto compression = ArchiveCompression::FromSettings().Applied();
 
-  CreateArchiveHelper(in_path, ex);
+  CreateArchiveHelper(in_path, ex, compression);
 
   return RunGpgOperaSync(
       GetChannel(),
@@ -495,7 +533,8 @@ auto GpgFileOpera::EncryptDirectorySymmetricSync(const QString& in_path,
         GpgData data_out(out_path, false);
 
         return EncryptFileGpgDataImpl(ctx_, {}, data_in, ascii, data_out,
-                                      data_object);
+                                      data_object,
+                                      DirectoryEncryptFlags(compression));
       },
       "gpgme_op_encrypt_symmetric", "2.2.0");
 }
@@ -30,6 +30,8 @@
 
 #include <gpg-error.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include "core/function/gpg/GpgContext.h"
@@ -40,7 +42,22 @@ namespace GpgFrontend {
 class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
  public:
   explicit Impl(int channel)
-      : SingletonFunctionObject<GpgKeyGetter::Impl>(channel) {}
+      : SingletonFunctionObject<GpgKeyGetter::Impl>(channel) {
+    auto& live = live_instances();
+    std::lock_guard lock(live.lock);
+    live.ids.insert(instance_id_);
+  }
+
+  ~Impl() override {
+    {
+      auto& live = live_instances();
+      std::lock_guard lock(live.lock);
+      live.ids.remove(instance_id_);
+    }
+
+    // the slots other threads hold go at their next reload, see snapshot()
+    reader_slots().remove(this);
+  }
 
   auto GetKeyPtr(const QString& key_id, bool cache) -> GpgKeyPtr {
     // find in cache first
@@ -96,42 +113,28 @@ class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
   }
 
   auto FetchKey() -> GpgKeyPtrList {
-    if (keys_cache_.empty() || keys_search_cache_.empty()) {
-      FlushKeyCache();
-    }
+    if (snapshot().keys.empty()) FlushKeyCache();
 
     auto keys_list = GpgKeyPtrList{};
-    {
-      // get the lock
-      std::lock_guard<std::mutex> lock(keys_cache_mutex_);
-      for (const auto& key : keys_cache_) {
-        keys_list.push_back(key);
-      }
+    for (const auto& key : snapshot().keys) {
+      keys_list.push_back(key);
     }
     return keys_list;
   }
 
   auto FetchGpgKeyList() -> GpgAbstractKeyPtrList {
-    if (keys_search_cache_.empty()) {
-      FlushKeyCache();
-    }
+    if (snapshot().search.empty()) FlushKeyCache();
 
     auto keys_list = GpgAbstractKeyPtrList{};
-    {
-      // get the lock
-      std::lock_guard<std::mutex> lock(keys_cache_mutex_);
-      for (const auto& key : keys_cache_) {
-        keys_list.push_back(key);
-      }
+    for (const auto& key : snapshot().keys) {
+      keys_list.push_back(key);
     }
-
     return keys_list;
   }
 
   auto FlushKeyCache() -> bool {
-    // clear the keys cache
-    keys_cache_.clear();
-    keys_search_cache_.clear();
+    // only one writer builds a new index at a time
+    std::lock_guard<std::mutex> lock(keys_cache_mutex_);
 
     // init
     GpgError err = gpgme_op_keylist_start(ctx_.DefaultContext(), nullptr, 0);
@@ -142,39 +145,22 @@ class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
     // return when error
     if (CheckGpgError(err) != GPG_ERR_NO_ERROR) return false;
 
-    {
-      // get the lock
-      std::lock_guard<std::mutex> lock(keys_cache_mutex_);
-      gpgme_key_t key;
-      while ((err = gpgme_op_keylist_next(ctx_.DefaultContext(), &key)) ==
-             GPG_ERR_NO_ERROR) {
-        auto g_key = SecureCreateSharedObject<GpgKey>(key);
-
-        // detect if the key is in a smartcard
-        // if so, try to get full information using gpgme_get_key()
-        // this maybe a bug in gpgme
-        if (g_key->IsHasCardKey()) {
-          g_key = GetKeyPtr(g_key->ID(), false);
-        }
-
-        keys_cache_.push_back(g_key);
-        keys_search_cache_.insert(g_key->ID(), g_key);
-        keys_search_cache_.insert(g_key->Fingerprint(), g_key);
-
-        for (const auto& s_key : g_key->SubKeys()) {
-          if (s_key.ID() == g_key->ID()) continue;
-
-          // don't add adsk key or it will cause bugs
-          if (s_key.IsADSK()) continue;
-
-          // subkeys should be weaker than primary key
-          if (keys_search_cache_.contains(s_key.ID())) continue;
-
-          auto p_s_key = SecureCreateSharedObject<GpgSubKey>(s_key);
-          keys_search_cache_.insert(s_key.ID(), p_s_key);
-          keys_search_cache_.insert(s_key.Fingerprint(), p_s_key);
-        }
+    auto next = std::make_shared<KeyIndex>();
+
+    gpgme_key_t key;
+    while ((err = gpgme_op_keylist_next(ctx_.DefaultContext(), &key)) ==
+           GPG_ERR_NO_ERROR) {
+      auto g_key = SecureCreateSharedObject<GpgKey>(key);
+
+      // detect if the key is in a smartcard
+      // if so, try to get full information using gpgme_get_key()
+      // this maybe a bug in gpgme
+      if (g_key->IsHasCardKey()) {
+        g_key = GetKeyPtr(g_key->ID(), false);
       }
+
+      next->keys.push_back(g_key);
+      index_key(*next, g_key);
     }
 
     // for debug
@@ -183,9 +169,68 @@ class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
     err = gpgme_op_keylist_end(ctx_.DefaultContext());
     assert(CheckGpgError2ErrCode(err, GPG_ERR_EOF) == GPG_ERR_NO_ERROR);
 
+    publish(std::move(next));
     return true;
   }
 
+  auto UpdateKeyCache(const KeyIdArgsList& key_ids) -> GpgKeyPtrList {
+    if (snapshot().keys.empty()) {
+      FlushKeyCache();
+      return {};
+    }
+
+    std::lock_guard<std::mutex> lock(keys_cache_mutex_);
+
+    // copy the current index, readers keep using the old one meanwhile
+    auto next = std::make_shared<KeyIndex>(
+        *std::atomic_load_explicit(&index_, std::memory_order_acquire));
+
+    auto updated_keys = GpgKeyPtrList{};
+    for (const auto& key_id : key_ids) {
+      gpgme_key_t p_key = nullptr;
+      gpgme_get_key(ctx_.DefaultContext(), key_id.toUtf8(), &p_key, 0);
+
+      auto g_key = p_key != nullptr ? SecureCreateSharedObject<GpgKey>(p_key)
+                                    : GpgKeyPtr{};
+
+      // the same workaround for smartcard keys as the full listing
+      if (g_key != nullptr && g_key->IsHasCardKey()) {
+        g_key = GetKeyPtr(g_key->ID(), false);
+      }
+
+      auto& keys = next->keys;
+      auto it =
+          std::find_if(keys.begin(), keys.end(), [&](const GpgKeyPtr& key) {
+            if (g_key != nullptr) {
+              return key->Fingerprint() == g_key->Fingerprint();
+            }
+            return key->ID() == key_id || key->Fingerprint() == key_id;
+          });
+
+      if (it != keys.end()) unindex_key(*next, *it);
+
+      // the key was deleted from the key database
+      if (g_key == nullptr) {
+        if (it != keys.end()) keys.erase(it);
+        LOG_D() << "drop key from cache:" << key_id
+                << "channel:" << GetChannel();
+        continue;
+      }
+
+      if (it != keys.end()) {
+        *it = g_key;
+      } else {
+        keys.push_back(g_key);
+      }
+
+      index_key(*next, g_key);
+      updated_keys.push_back(g_key);
+    }
+
+    publish(std::move(next));
+    return updated_keys;
+  }
+
   auto GetKeys(const KeyIdArgsList& ids) -> GpgKeyList {
     auto keys = GpgKeyList{};
     for (const auto& key_id : ids) keys.push_back(GetKey(key_id, true));
@@ -225,6 +270,37 @@ class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
   }
 
  private:
+  /**
+   * @brief an immutable view of the key database, it is never modified
+   * after being published so readers can use it without any lock
+   *
+   */
+  struct KeyIndex {
+    QHash<QString, GpgAbstractKeyPtr> search;  ///< keys by id and fingerprint
+    QContainer<GpgKeyPtr> keys;                ///< keys in keylist order
+  };
+
+  /**
+   * @brief the index cached by a reader thread, with the instance and the
+   * generation it belongs to
+   *
+   */
+  struct ReaderSlot {
+    quint64 instance = 0;
+    quint64 generation = 0;
+    std::shared_ptr<const KeyIndex> index;
+  };
+
+  /**
+   * @brief the ids of the instances alive, used to drop the slots of
+   * destroyed ones
+   *
+   */
+  struct LiveInstances {
+    std::mutex lock;
+    QSet<quint64> ids;
+  };
+
   /**
    * @brief Get the gpgme context object
    *
@@ -233,29 +309,163 @@ class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
       GpgContext::GetInstance(SingletonFunctionObject::GetChannel());
 
   /**
-   * @brief shared mutex for the keys cache
+   * @brief the index currently published, only accessed through
+   * std::atomic_load/std::atomic_store
    *
    */
-  mutable std::mutex ctx_mutex_;
+  std::shared_ptr<const KeyIndex> index_ = std::make_shared<KeyIndex>();
 
   /**
-   * @brief cache the keys with key id
+   * @brief generation of index_, unique across all instances so that a
+   * reader never mistakes a recycled address for a known index
    *
    */
-  QMap<QString, GpgAbstractKeyPtr> keys_search_cache_;
+  std::atomic<quint64> generation_{next_generation()};
 
   /**
-   * @brief
+   * @brief unique across all instances, a slot left by a destroyed instance
+   * at the same address doesn't match
    *
    */
-  QContainer<GpgKeyPtr> keys_cache_;
+  const quint64 instance_id_ = next_generation();
 
   /**
-   * @brief shared mutex for the keys cache
+   * @brief serializes the writers (flush and update)
    *
    */
   mutable std::mutex keys_cache_mutex_;
 
+  static auto live_instances() -> LiveInstances& {
+    static LiveInstances live;
+    return live;
+  }
+
+  static auto reader_slots() -> QHash<const Impl*, ReaderSlot>& {
+    thread_local QHash<const Impl*, ReaderSlot> slots;
+    return slots;
+  }
+
+  /**
+   * @brief drop the slots of the calling thread whose instance is gone
+   *
+   * @param slots
+   */
+  static void prune_reader_slots(QHash<const Impl*, ReaderSlot>& slots) {
+    auto& live = live_instances();
+    std::lock_guard lock(live.lock);
+    for (auto it = slots.begin(); it != slots.end();) {
+      if (live.ids.contains(it->instance)) {
+        ++it;
+      } else {
+        it = slots.erase(it);
+      }
+    }
+  }
+
+  static auto next_generation() -> quint64 {
+    static std::atomic<quint64> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  /**
+   * @brief replace the published index, the caller should hold
+   * keys_cache_mutex_
+   *
+   * @param next
+   */
+  void publish(std::shared_ptr<const KeyIndex> next) {
+    std::atomic_store_explicit(&index_, std::move(next),
+                               std::memory_order_release);
+    generation_.store(next_generation(), std::memory_order_release);
+  }
+
+  /**
+   * @brief the index seen by the calling thread
+   *
+   * Each thread keeps its own reference to the last index it used, so on
+   * the hot path a lookup is a generation check plus a hash lookup and
+   * touches no shared lock or reference count. The reference is reloaded
+   * only after a writer has published a new index.
+   *
+   * The returned reference stays valid until the same thread calls
+   * snapshot() on this instance again.
+   *
+   * A thread holds at most one index per instance. An index replaced by a
+   * writer is released by each thread at its next lookup on the instance,
+   * so until then an idle reader keeps one stale index alive. The slots of
+   * destroyed instances are dropped at the next reload of the thread, the
+   * destroying thread drops its own at once.
+   *
+   * @return const KeyIndex&
+   */
+  auto snapshot() const -> const KeyIndex& {
+    auto& slots = reader_slots();
+    const auto generation = generation_.load(std::memory_order_acquire);
+
+    auto it = slots.find(this);
+    if (it != slots.end() && it->instance == instance_id_ &&
+        it->generation == generation) {
+      return *it->index;
+    }
+
+    // cold path, after a writer published or on the first lookup
+    prune_reader_slots(slots);
+    auto& slot = slots[this];
+    slot.instance = instance_id_;
+    slot.generation = generation;
+    slot.index = std::atomic_load_explicit(&index_, std::memory_order_acquire);
+    return *slot.index;
+  }
+
+  /**
+   * @brief add a key and its subkeys to an unpublished index
+   *
+   * @param index
+   * @param key
+   */
+  static void index_key(KeyIndex& index, const GpgKeyPtr& key) {
+    auto& search = index.search;
+    search.insert(key->ID(), key);
+    search.insert(key->Fingerprint(), key);
+
+    for (const auto& s_key : key->SubKeys()) {
+      if (s_key.ID() == key->ID()) continue;
+
+      // don't add adsk key or it will cause bugs
+      if (s_key.IsADSK()) continue;
+
+      // subkeys should be weaker than primary key
+      if (search.contains(s_key.ID())) continue;
+
+      auto p_s_key = SecureCreateSharedObject<GpgSubKey>(s_key);
+      search.insert(s_key.ID(), p_s_key);
+      search.insert(s_key.Fingerprint(), p_s_key);
+    }
+  }
+
+  /**
+   * @brief remove a key and its subkeys from an unpublished index
+   *
+   * @param index
+   * @param key
+   */
+  static void unindex_key(KeyIndex& index, const GpgKeyPtr& key) {
+    auto& search = index.search;
+    search.remove(key->ID());
+    search.remove(key->Fingerprint());
+
+    for (const auto& s_key : key->SubKeys()) {
+      for (const auto& id : {s_key.ID(), s_key.Fingerprint()}) {
+        auto it = search.find(id);
+        if (it == search.end()) continue;
+
+        // keep entries of primary keys
+        if ((*it)->KeyType() != GpgAbstractKeyType::kGPG_SUBKEY) continue;
+        search.erase(it);
+      }
+    }
+  }
+
   /**
    * @brief Get the Key object
    *
@@ -263,16 +473,8 @@ class GpgKeyGetter::Impl : public SingletonFunctionObject<GpgKeyGetter::Impl> {
    * @return GpgKey
    */
   auto get_key_in_cache(const QString& key_id) -> GpgAbstractKeyPtr {
-    std::lock_guard<std::mutex> lock(keys_cache_mutex_);
-
-    if (keys_search_cache_.find(key_id) != keys_search_cache_.end()) {
-      std::lock_guard<std::mutex> lock(ctx_mutex_);
-      // return a copy of the key in cache
-      return keys_search_cache_[key_id];
-    }
-
-    // return a bad key
-    return {};
+    // return a copy of the key in cache or a bad key
+    return snapshot().search.value(key_id);
   }
 };
 
@@ -302,6 +504,11 @@ auto GpgKeyGetter::GetPubkeyPtr(const QString& key_id, bool use_cache)
 
 auto GpgKeyGetter::FlushKeyCache() -> bool { return p_->FlushKeyCache(); }
 
+auto GpgKeyGetter::UpdateKeyCache(const KeyIdArgsList& key_ids)
+    -> GpgKeyPtrList {
+  return p_->UpdateKeyCache(key_ids);
+}
+
 auto GpgKeyGetter::GetKeys(const KeyIdArgsList& ids) -> GpgKeyList {
   return p_->GetKeys(ids);
 }
@@ -111,6 +111,15 @@ class GF_CORE_EXPORT GpgKeyGetter
    */
   auto FlushKeyCache() -> bool;
 
+  /**
+   * @brief re-fetch only the given keys and patch them into the cache,
+   * keys that no longer exist are dropped from the cache
+   *
+   * @param key_ids fingerprints or ids of the keys touched by an operation
+   * @return GpgKeyPtrList the refreshed keys which still exist
+   */
+  auto UpdateKeyCache(const KeyIdArgsList& key_ids) -> GpgKeyPtrList;
+
   /**
    * @brief Get the Keys object
    *
@@ -25,93 +25,87 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  *
  */
-
 #include "GFBuffer.h"
 
 #include <openssl/crypto.h>
 #include <openssl/evp.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
+#include <utility>
 
 namespace GpgFrontend {
 
 // 16MB
 constexpr size_t kStrlenMaxLength = static_cast<const size_t>(16 * 1024 * 1024);
 
+// the smallest capacity an appending buffer grows to
+constexpr size_t kMinGrowCapacity = 64;
+
+namespace {
+thread_local GFBuffer::Statistics statistics{};
+}  // namespace
+
 struct GFBuffer::Impl {
   void* sec_ptr_ = nullptr;
-  size_t sec_size_ = 0;
-
-  explicit Impl() = default;
+  size_t sec_cap_ = 0;
 
-  explicit Impl(size_t size) {
-    if (size != 0) {
-      sec_ptr_ = SMASecMalloc(size);
-      sec_size_ = size;
+  explicit Impl(size_t capacity) {
+    if (capacity != 0) {
+      sec_ptr_ = SMASecMalloc(capacity);
+      sec_cap_ = capacity;
+      statistics.allocations++;
     }
   }
 
   ~Impl() {
-    if (sec_ptr_ != nullptr) {
-      SMASecFree(sec_ptr_);
-      sec_ptr_ = nullptr;
-    }
-    sec_size_ = 0;
+    if (sec_ptr_ != nullptr) SMASecFree(sec_ptr_);
   }
 
   Impl(const Impl&) = delete;
 
   auto operator=(const Impl&) -> Impl& = delete;
 
-  Impl(Impl&& other) noexcept
-      : sec_ptr_(other.sec_ptr_), sec_size_(other.sec_size_) {
-    other.sec_ptr_ = nullptr;
-    other.sec_size_ = 0;
+  /**
+   * @brief create storage of capacity bytes
+   *
+   */
+  static auto Create(size_t capacity) -> std::shared_ptr<Impl> {
+    return {SecureCreateObject<Impl>(capacity), SecureObjectDeleter<Impl>()};
   }
 
-  auto operator=(Impl&& other) noexcept -> Impl& {
-    if (this != &other) {
-      if (sec_ptr_ != nullptr) SMASecFree(sec_ptr_);
-      sec_ptr_ = other.sec_ptr_;
-      sec_size_ = other.sec_size_;
-      other.sec_ptr_ = nullptr;
-      other.sec_size_ = 0;
-    }
-    return *this;
+  /**
+   * @brief move the data into storage of exactly capacity bytes
+   *
+   */
+  void Reallocate(size_t capacity) {
+    sec_ptr_ = SMASecRealloc(sec_ptr_, capacity);
+    sec_cap_ = capacity;
+    statistics.allocations++;
   }
 };
 
-GFBuffer::GFBuffer() : impl_(SecureCreateSharedObject<Impl>()) {}
+GFBuffer::GFBuffer() = default;
 
-GFBuffer::GFBuffer(size_t size) : impl_(SecureCreateSharedObject<Impl>(size)) {}
+GFBuffer::GFBuffer(size_t size) : impl_(Impl::Create(size)), size_(size) {}
 
 GFBuffer::~GFBuffer() = default;
 
 GFBuffer::GFBuffer(const QByteArray& buffer)
-    : impl_(SecureCreateSharedObject<Impl>(buffer.size())) {
-  std::memcpy(impl_->sec_ptr_, buffer.constData(), impl_->sec_size_);
-}
+    : GFBuffer(buffer.constData(), static_cast<size_t>(buffer.size())) {}
 
-GFBuffer::GFBuffer(const QString& str) {
-  auto b = str.toUtf8();
-  impl_ = SecureCreateSharedObject<Impl>(b.size());
-  std::memcpy(impl_->sec_ptr_, b.constData(), impl_->sec_size_);
-}
+GFBuffer::GFBuffer(const QString& str) : GFBuffer(str.toUtf8()) {}
 
 GFBuffer::GFBuffer(const char* str)
-    : impl_(SecureCreateSharedObject<Impl>(
-          (str != nullptr) ? strnlen(str, kStrlenMaxLength) : 0)) {
-  if ((str != nullptr) && impl_->sec_size_ > 0) {
-    std::memcpy(impl_->sec_ptr_, str, impl_->sec_size_);
-  }
-}
+    : GFBuffer(str, (str != nullptr) ? strnlen(str, kStrlenMaxLength) : 0) {}
 
-GFBuffer::GFBuffer(const char* buf, size_t size)
-    : impl_(SecureCreateSharedObject<Impl>((buf != nullptr) ? size : 0)) {
-  if ((buf != nullptr) && impl_->sec_size_ > 0) {
-    std::memcpy(impl_->sec_ptr_, buf, impl_->sec_size_);
-  }
+GFBuffer::GFBuffer(const char* buf, size_t size) {
+  if (buf == nullptr || size == 0) return;
+
+  impl_ = Impl::Create(size);
+  size_ = size;
+  std::memcpy(impl_->sec_ptr_, buf, size);
 }
 
 auto GFBuffer::operator==(const GFBuffer& o) const -> bool {
@@ -119,32 +113,75 @@ auto GFBuffer::operator==(const GFBuffer& o) const -> bool {
          (Size() == 0 || std::memcmp(Data(), o.Data(), Size()) == 0);
 }
 
-auto GFBuffer::Data() -> char* { return static_cast<char*>(impl_->sec_ptr_); }
+auto GFBuffer::Data() -> char* {
+  make_writable(size_);
+  if (!impl_ || impl_->sec_ptr_ == nullptr) return nullptr;
+  return static_cast<char*>(impl_->sec_ptr_) + offset_;
+}
 
 auto GFBuffer::Data() const -> const char* {
-  return static_cast<const char*>(impl_->sec_ptr_);
+  if (!impl_ || impl_->sec_ptr_ == nullptr) return nullptr;
+  return static_cast<const char*>(impl_->sec_ptr_) + offset_;
 }
 
 void GFBuffer::Resize(ssize_t size) {
-  if (size == 0) {
-    SMASecFree(impl_->sec_ptr_);
+  if (size <= 0) {
+    impl_.reset();
+    offset_ = 0;
+    size_ = 0;
+    return;
+  }
 
-    impl_->sec_ptr_ = nullptr;
-    impl_->sec_size_ = 0;
+  const auto new_size = static_cast<size_t>(size);
+  if (new_size == size_) return;
+
+  // shrinking a shared buffer or a slice only narrows the window
+  if (new_size < size_ && !is_exclusive()) {
+    size_ = new_size;
+    return;
+  }
+
+  make_writable(new_size);
+
+  auto* data = static_cast<char*>(impl_->sec_ptr_);
+  if (new_size < size_) {
+    OPENSSL_cleanse(data + new_size, size_ - new_size);
+  } else {
+    memset(data + size_, 0, new_size - size_);
+  }
+  size_ = new_size;
+}
+
+void GFBuffer::Reserve(size_t capacity) {
+  if (capacity > Capacity() || !is_exclusive()) make_writable(capacity);
+}
+
+void GFBuffer::ShrinkToFit() {
+  if (size_ == 0) {
+    impl_.reset();
+    offset_ = 0;
     return;
   }
 
-  impl_->sec_ptr_ = SMASecRealloc(impl_->sec_ptr_, size);
-  impl_->sec_size_ = size;
+  // the storage is still used by others, there is nothing to release
+  if (impl_.use_count() > 1) return;
+
+  if (offset_ != 0) {
+    make_writable(size_);
+  } else if (impl_->sec_cap_ > size_) {
+    impl_->Reallocate(size_);
+  }
 }
 
-auto GFBuffer::Size() const -> size_t { return impl_ ? impl_->sec_size_ : 0; }
+auto GFBuffer::Size() const -> size_t { return size_; }
+
+auto GFBuffer::Capacity() const -> size_t {
+  return impl_ ? impl_->sec_cap_ - offset_ : 0;
+}
 
 auto GFBuffer::ConvertToQByteArray() const -> QByteArray {
-  Q_ASSERT(impl_);
-  Q_ASSERT(impl_->sec_ptr_ != nullptr);
-  return QByteArray{static_cast<const char*>(impl_->sec_ptr_),
-                    static_cast<qsizetype>(impl_->sec_size_)};
+  if (Empty()) return {};
+  return QByteArray{Data(), static_cast<qsizetype>(size_)};
 }
 
 auto GFBuffer::Empty() const -> bool { return Size() == 0; }
@@ -152,69 +189,48 @@ auto GFBuffer::Empty() const -> bool { return Size() == 0; }
 void GFBuffer::Append(const GFBuffer& o) {
   if (o.Empty()) return;
 
-  if (&o == this) {
-    GFBuffer copy(*this);
-    Append(copy);
-    return;
-  }
-
-  const auto old_size = impl_->sec_size_;
-  Resize(static_cast<ssize_t>(impl_->sec_size_ + o.impl_->sec_size_));
-  memcpy(static_cast<char*>(impl_->sec_ptr_) + old_size, o.impl_->sec_ptr_,
-         o.impl_->sec_size_);
+  // keep the source alive, it may be this buffer or share its storage
+  const GFBuffer src = o;
+  append(src.Data(), src.Size());
 }
 
 void GFBuffer::Append(const char* buffer, ssize_t size) {
-  if (size == 0) return;
-
-  const auto old_size = impl_->sec_size_;
-  Resize(static_cast<ssize_t>(impl_->sec_size_ + size));
-  memcpy(static_cast<char*>(impl_->sec_ptr_) + old_size, buffer, size);
+  if (buffer == nullptr || size <= 0) return;
+  append(buffer, static_cast<size_t>(size));
 }
 
 auto GFBuffer::Left(ssize_t len) const -> GFBuffer {
-  if (len <= 0) return {};
-
-  len = std::min(len, static_cast<ssize_t>(impl_->sec_size_));
-  auto ret = GFBuffer(len);
-  memcpy(ret.impl_->sec_ptr_, impl_->sec_ptr_, len);
-  return ret;
+  return Mid(0, len);
 }
 
 auto GFBuffer::Mid(ssize_t pos, ssize_t len) const -> GFBuffer {
-  if (pos < 0 || len <= 0 || pos >= impl_->sec_size_) return {};
+  if (pos < 0 || len <= 0 || static_cast<size_t>(pos) >= size_) return {};
 
-  len = std::min(len, static_cast<ssize_t>(impl_->sec_size_ - pos));
-  auto ret = GFBuffer(len);
-  memcpy(ret.impl_->sec_ptr_,
-         reinterpret_cast<void*>(static_cast<char*>(impl_->sec_ptr_) + pos),
-         len);
+  // a view on the same storage, it is copied only when written to
+  GFBuffer ret;
+  ret.impl_ = impl_;
+  ret.offset_ = offset_ + static_cast<size_t>(pos);
+  ret.size_ = std::min(static_cast<size_t>(len), size_ - pos);
   return ret;
 }
 
 auto GFBuffer::Right(ssize_t len) const -> GFBuffer {
   if (len <= 0) return {};
 
-  len = std::min(len, static_cast<ssize_t>(impl_->sec_size_));
-  auto ret = GFBuffer(len);
-  memcpy(ret.impl_->sec_ptr_,
-         reinterpret_cast<void*>(static_cast<char*>(impl_->sec_ptr_) +
-                                 impl_->sec_size_ - len),
-         len);
-  return ret;
+  const auto n = std::min(static_cast<size_t>(len), size_);
+  return Mid(static_cast<ssize_t>(size_ - n), static_cast<ssize_t>(n));
 }
 
 void GFBuffer::Zeroize() {
-  if (impl_ && (impl_->sec_ptr_ != nullptr) && impl_->sec_size_ > 0) {
-    OPENSSL_cleanse(impl_->sec_ptr_, impl_->sec_size_);
+  // wipe the bytes where they are, even if other buffers share them
+  if (impl_ && impl_->sec_ptr_ != nullptr && size_ > 0) {
+    OPENSSL_cleanse(static_cast<char*>(impl_->sec_ptr_) + offset_, size_);
   }
 }
 
 auto GFBuffer::ConvertToQString() const -> QString {
-  Q_ASSERT(impl_);
-  if (impl_->sec_ptr_ == nullptr) return {};
-  return QString::fromUtf8(static_cast<const char*>(impl_->sec_ptr_),
-                           static_cast<qsizetype>(impl_->sec_size_));
+  if (Empty()) return {};
+  return QString::fromUtf8(Data(), static_cast<qsizetype>(size_));
 }
 
 auto GFBuffer::operator==(const char* str) const -> bool {
@@ -229,7 +245,7 @@ auto GFBuffer::operator!=(const char* str) const -> bool {
 
 auto GFBuffer::operator<(const GFBuffer& other) const -> bool {
   const auto min_len = std::min(Size(), other.Size());
-  int cmp = std::memcmp(Data(), other.Data(), min_len);
+  int cmp = min_len == 0 ? 0 : std::memcmp(Data(), other.Data(), min_len);
   if (cmp != 0) return cmp < 0;
   return Size() < other.Size();
 }
@@ -238,11 +254,16 @@ auto GFBuffer::operator!=(const GFBuffer& o) const -> bool {
   return !(*this == o);
 }
 
-GFBuffer::GFBuffer(GFBuffer&& other) noexcept : impl_(std::move(other.impl_)) {}
+GFBuffer::GFBuffer(GFBuffer&& other) noexcept
+    : impl_(std::move(other.impl_)),
+      offset_(std::exchange(other.offset_, 0)),
+      size_(std::exchange(other.size_, 0)) {}
 
 auto GFBuffer::operator=(GFBuffer&& other) noexcept -> GFBuffer& {
   if (this != &other) {
     impl_ = std::move(other.impl_);
+    offset_ = std::exchange(other.offset_, 0);
+    size_ = std::exchange(other.size_, 0);
   }
   return *this;
 }
@@ -253,21 +274,60 @@ auto GFBuffer::operator=(const GFBuffer& other) -> GFBuffer& = default;
 
 void GFBuffer::Combine(const std::initializer_list<GFBuffer>& buffers) {
   size_t total_new_data = 0;
-  for (const auto& b : buffers) {
-    if (!b.Empty()) total_new_data += b.impl_->sec_size_;
-  }
+  for (const auto& b : buffers) total_new_data += b.Size();
   if (total_new_data == 0) return;
 
-  const auto old_size = impl_->sec_size_;
-  Resize(static_cast<ssize_t>(old_size + total_new_data));
+  // the list holds its own references, so the sources stay valid even if
+  // they share the storage of this buffer
+  make_writable(size_ + total_new_data);
 
-  auto offset = old_size;
+  auto* data = static_cast<char*>(impl_->sec_ptr_);
   for (const auto& b : buffers) {
-    if (!b.Empty()) {
-      memcpy(static_cast<char*>(impl_->sec_ptr_) + offset, b.impl_->sec_ptr_,
-             b.impl_->sec_size_);
-      offset += b.impl_->sec_size_;
-    }
+    if (b.Empty()) continue;
+    memcpy(data + size_, b.Data(), b.Size());
+    size_ += b.Size();
+  }
+}
+
+auto GFBuffer::GetStatistics() -> Statistics { return statistics; }
+
+auto GFBuffer::is_exclusive() const -> bool {
+  return impl_ != nullptr && impl_.use_count() == 1 && offset_ == 0;
+}
+
+void GFBuffer::make_writable(size_t capacity) {
+  capacity = std::max(capacity, size_);
+
+  if (is_exclusive()) {
+    if (capacity > impl_->sec_cap_) impl_->Reallocate(capacity);
+    return;
+  }
+
+  if (capacity == 0) return;
+
+  // copy the visible bytes into storage owned by this buffer only
+  auto impl = Impl::Create(capacity);
+  if (size_ > 0) {
+    std::memcpy(impl->sec_ptr_, std::as_const(*this).Data(), size_);
+    statistics.copied_bytes += size_;
   }
+  impl_ = std::move(impl);
+  offset_ = 0;
 }
-}  // namespace GpgFrontend
\ No newline at end of file
+
+void GFBuffer::append(const char* buffer, size_t size) {
+  const auto required = size_ + size;
+
+  // grow geometrically so that a sequence of appends copies every byte
+  // only a constant number of times
+  auto capacity = is_exclusive() ? impl_->sec_cap_ : 0;
+  if (required > capacity) {
+    capacity = std::max({required, capacity + capacity / 2, kMinGrowCapacity});
+  }
+  make_writable(capacity);
+
+  memcpy(static_cast<char*>(impl_->sec_ptr_) + size_, buffer, size);
+  size_ = required;
+}
+
+}  // namespace GpgFrontend
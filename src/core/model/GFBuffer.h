@@ -28,14 +28,34 @@
 
 #pragma once
 
+#include <memory>
 #include <optional>
 
 #include "core/utils/MemoryUtils.h"
 
 namespace GpgFrontend {
 
+/**
+ * @brief a buffer in secure memory
+ *
+ * Copies and the views returned by Mid(), Left() and Right() share the
+ * storage with the buffer they come from. The bytes are copied only when
+ * one of them is written to, so slicing a large buffer costs no allocation.
+ * Zeroize() is the exception: it wipes the bytes in place, including the
+ * ones seen by the other buffers sharing them.
+ *
+ */
 class GF_CORE_EXPORT GFBuffer {
  public:
+  /**
+   * @brief allocation and copy counters of the calling thread
+   *
+   */
+  struct Statistics {
+    quint64 allocations = 0;
+    quint64 copied_bytes = 0;
+  };
+
   GFBuffer();
 
   explicit GFBuffer(size_t size);
@@ -68,14 +88,34 @@ class GF_CORE_EXPORT GFBuffer {
 
   auto operator<(const GFBuffer& other) const -> bool;
 
+  /**
+   * @brief writable data, detaching the storage from other buffers first
+   *
+   * @return char*
+   */
   [[nodiscard]] auto Data() -> char*;
 
   [[nodiscard]] auto Data() const -> const char*;
 
   void Resize(ssize_t size);
 
+  /**
+   * @brief make sure at least capacity bytes can be held without another
+   * allocation
+   *
+   */
+  void Reserve(size_t capacity);
+
+  /**
+   * @brief release the spare capacity
+   *
+   */
+  void ShrinkToFit();
+
   [[nodiscard]] auto Size() const -> size_t;
 
+  [[nodiscard]] auto Capacity() const -> size_t;
+
   [[nodiscard]] auto Empty() const -> bool;
 
   void Append(const GFBuffer&);
@@ -96,9 +136,34 @@ class GF_CORE_EXPORT GFBuffer {
 
   void Zeroize();
 
+  /**
+   * @brief get the counters of the calling thread
+   *
+   * @return Statistics
+   */
+  static auto GetStatistics() -> Statistics;
+
  private:
   struct Impl;
-  QSharedPointer<Impl> impl_;
+  std::shared_ptr<Impl> impl_;
+  size_t offset_ = 0;
+  size_t size_ = 0;
+
+  /**
+   * @brief whether this buffer is the only user of its storage and starts at
+   * its beginning
+   *
+   */
+  [[nodiscard]] auto is_exclusive() const -> bool;
+
+  /**
+   * @brief make the storage owned by this buffer only and able to hold
+   * capacity bytes
+   *
+   */
+  void make_writable(size_t capacity);
+
+  void append(const char* buffer, size_t size);
 };
 
 using GFBufferOrNone = std::optional<GFBuffer>;
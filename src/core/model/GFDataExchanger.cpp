@@ -28,57 +28,67 @@
 
 #include "GFDataExchanger.h"
 
+#include <cstring>
+
+#include "core/GpgConstants.h"
+
 namespace GpgFrontend {
 
+GFDataExchanger::GFDataExchanger(ssize_t size)
+    : capacity_(size > 0 ? static_cast<size_t>(size) : kSecBufferSize),
+      ring_(static_cast<std::byte*>(SMASecMalloc(capacity_))) {
+  if (ring_ == nullptr) throw std::bad_alloc();
+}
+
+GFDataExchanger::~GFDataExchanger() { SMASecFree(ring_); }
+
 auto GFDataExchanger::Write(const std::byte* buffer, size_t size) -> ssize_t {
   if (close_) return -1;
   if (size == 0) return 0;
 
-  std::atomic<ssize_t> write_bytes = 0;
-  std::unique_lock<std::mutex> lock(mutex_);
-  try {
-    for (size_t i = 0; i < size; i++) {
-      if (queue_.size() == static_cast<unsigned long>(queue_max_size_)) {
-        not_empty_.notify_all();
-      }
-
-      not_full_.wait(lock, [=] {
-        return queue_.size() < static_cast<unsigned long>(queue_max_size_) ||
-               close_;
-      });
-      if (close_) return -1;
-
-      queue_.push(buffer[i]);
-      write_bytes++;
-    }
-  } catch (...) {
-    FLOG_W(
-        "gf data exchanger caught exception when it writes to queue, abort...");
+  size_t written = 0;
+  while (written < size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return used_ < capacity_ || close_; });
+    if (close_) return -1;
+
+    // copy as much as fits, in at most two pieces around the wrap point
+    const auto tail = (head_ + used_) % capacity_;
+    const auto len = std::min(size - written, capacity_ - used_);
+    const auto first = std::min(len, capacity_ - tail);
+    std::memcpy(ring_ + tail, buffer + written, first);
+    std::memcpy(ring_, buffer + written + first, len - first);
+
+    used_ += len;
+    written += len;
+
+    lock.unlock();
+    not_empty_.notify_all();
   }
 
-  if (!queue_.empty()) not_empty_.notify_all();
-  return write_bytes;
+  return static_cast<ssize_t>(written);
 }
 
 auto GFDataExchanger::Read(std::byte* buffer, size_t size) -> ssize_t {
+  if (size == 0) return 0;
+
   std::unique_lock<std::mutex> lock(mutex_);
-  if (size == 0 || (close_ && queue_.empty())) return 0;
+  not_empty_.wait(lock, [this] { return used_ > 0 || close_; });
 
-  std::atomic<ssize_t> read_bytes = 0;
-  for (size_t i = 0; i < size; ++i) {
-    if (queue_.empty()) not_full_.notify_all();
-    not_empty_.wait(lock, [=] { return !queue_.empty() || close_; });
+  // closed and drained
+  if (used_ == 0) return 0;
 
-    if (close_ && queue_.empty()) return 0;
-    buffer[i] = queue_.front();
-    queue_.pop();
-    read_bytes++;
-  }
+  const auto len = std::min(size, used_);
+  const auto first = std::min(len, capacity_ - head_);
+  std::memcpy(buffer, ring_ + head_, first);
+  std::memcpy(buffer + first, ring_, len - first);
 
-  if (queue_.size() < static_cast<unsigned long>(queue_max_size_)) {
-    not_full_.notify_all();
-  }
-  return read_bytes;
+  head_ = (head_ + len) % capacity_;
+  used_ -= len;
+
+  lock.unlock();
+  not_full_.notify_all();
+  return static_cast<ssize_t>(len);
 }
 
 void GFDataExchanger::CloseWrite() {
@@ -89,8 +99,6 @@ void GFDataExchanger::CloseWrite() {
   not_empty_.notify_all();
 }
 
-GFDataExchanger::GFDataExchanger(ssize_t size) : queue_max_size_(size) {}
-
 auto CreateStandardGFDataExchanger() -> QSharedPointer<GFDataExchanger> {
   return SecureCreateSharedObject<GFDataExchanger>(kSecBufferSizeForFile);
 }
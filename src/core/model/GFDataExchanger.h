@@ -29,30 +29,60 @@
 #pragma once
 
 #include <cstddef>
-#include <queue>
 
 #include "core/utils/MemoryUtils.h"
 
 namespace GpgFrontend {
 
-class GFDataExchanger {
+/**
+ * @brief bounded single-producer single-consumer byte pipe between a
+ * writer (e.g. libarchive, gpgme output) and a reader running on another
+ * thread. Data is kept in a ring buffer allocated from secure memory and
+ * copied in and out in bulk.
+ *
+ */
+class GF_CORE_EXPORT GFDataExchanger {
  public:
-  using SecureByteDeque = std::deque<std::byte, SMASecAllocator<std::byte>>;
-  using SecureByteQueue = std::queue<std::byte, SecureByteDeque>;
-
+  /**
+   * @brief Construct a new GFDataExchanger object
+   *
+   * @param size capacity of the ring buffer in bytes
+   */
   explicit GFDataExchanger(ssize_t size);
 
+  /**
+   * @brief Destroy the GFDataExchanger object, the ring buffer is wiped
+   *
+   */
+  ~GFDataExchanger();
+
+  GFDataExchanger(const GFDataExchanger&) = delete;
+
+  auto operator=(const GFDataExchanger&) -> GFDataExchanger& = delete;
+
+  /**
+   * @brief write the whole buffer, blocking while the ring buffer is full
+   *
+   * @return ssize_t bytes written, -1 if the exchanger has been closed
+   */
   auto Write(const std::byte* buffer, size_t size) -> ssize_t;
 
+  /**
+   * @brief read at most size bytes, blocking until some data is available
+   *
+   * @return ssize_t bytes read, 0 when closed and drained
+   */
   auto Read(std::byte* buffer, size_t size) -> ssize_t;
 
   void CloseWrite();
 
  private:
   std::condition_variable not_full_, not_empty_;
-  SecureByteQueue queue_;
   std::mutex mutex_;
-  const ssize_t queue_max_size_;
+  const size_t capacity_;
+  std::byte* ring_;
+  size_t head_ = 0;  ///< read position in ring_
+  size_t used_ = 0;  ///< bytes ready to be read
   std::atomic_bool close_ = false;
 };
 
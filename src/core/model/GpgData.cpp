@@ -30,18 +30,40 @@
 
 #include <unistd.h>
 
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
+#include <QStorageInfo>
+#include <cerrno>
 #include <cstddef>
+#include <utility>
 
 #include "core/model/GFDataExchanger.h"
+#include "core/thread/CancellationToken.h"
 #include "core/typedef/GpgErrorTypedef.h"
 
 namespace {
+/**
+ * @brief let gpgme fail the operation once the running task is canceled
+ *
+ */
+auto IsTaskCanceled() -> bool {
+  if (!GpgFrontend::Thread::CancellationToken::Current().IsCanceled()) {
+    return false;
+  }
+  errno = ECANCELED;
+  return true;
+}
+
 auto GFReadExCb(void* handle, void* buffer, size_t size) -> ssize_t {
+  if (IsTaskCanceled()) return -1;
   auto* ex = static_cast<GpgFrontend::GFDataExchanger*>(handle);
   return ex->Read(static_cast<std::byte*>(buffer), size);
 }
 
 auto GFWriteExCb(void* handle, const void* buffer, size_t size) -> ssize_t {
+  if (IsTaskCanceled()) return -1;
   auto* ex = static_cast<GpgFrontend::GFDataExchanger*>(handle);
   return ex->Write(static_cast<const std::byte*>(buffer), size);
 }
@@ -50,10 +72,26 @@ void GFReleaseExCb(void* handle) {
   auto* ex = static_cast<GpgFrontend::GFDataExchanger*>(handle);
   ex->CloseWrite();
 }
+
+/**
+ * @brief file systems whose files may change or fail to read behind the
+ * client's back, e.g. network and fuse mounts
+ *
+ */
+auto IsRemoteFileSystem(const QString& path) -> bool {
+  const auto type = QString::fromUtf8(QStorageInfo(path).fileSystemType());
+  static const QStringList kRemoteTypes = {
+      "nfs", "nfs4", "cifs", "smb", "smbfs", "smb3", "9p",
+      "afs", "ceph", "glusterfs", "davfs", "ncpfs", "sshfs"};
+  return kRemoteTypes.contains(type) || type.startsWith("fuse");
+}
 }  // namespace
 
 namespace GpgFrontend {
 
+// leave the address space of 32-bit builds to everything else
+constexpr qint64 kMaxMappedFileSize32 = static_cast<qint64>(512) * 1024 * 1024;
+
 GpgData::GpgData() {
   gpgme_data_t data;
 
@@ -67,7 +105,7 @@ GpgData::GpgData(const GFBuffer& buffer) : cached_buffer_(buffer) {
   gpgme_data_t data;
 
   auto err = gpgme_data_new_from_mem(
-      &data, reinterpret_cast<const char*>(cached_buffer_.Data()),
+      &data, std::as_const(cached_buffer_).Data(),
       cached_buffer_.Size(), 0);
   assert(gpgme_err_code(err) == GPG_ERR_NO_ERROR);
 
@@ -93,9 +131,20 @@ GpgData::GpgData(int fd) : fd_(fd), data_cbs_() {
   data_ref_ = std::unique_ptr<struct gpgme_data, DataRefDeleter>(data);
 }
 
-GpgData::GpgData(const QString& path, bool read) {
+GpgData::GpgData(const QString& path, bool read, bool map) {
   gpgme_data_t data;
 
+  // gpgme reads a mapped file like a buffer, without stdio in between
+  if (read && map && map_file(path)) {
+    auto err = gpgme_data_new_from_mem(&data,
+                                       reinterpret_cast<const char*>(mapped_),
+                                       mapped_file_.size(), 0);
+    assert(gpgme_err_code(err) == GPG_ERR_NO_ERROR);
+
+    data_ref_ = std::unique_ptr<struct gpgme_data, DataRefDeleter>(data);
+    return;
+  }
+
   // support unicode path
   QFile file(path);
   file.open(read ? QIODevice::ReadOnly : QIODevice::WriteOnly);
@@ -123,6 +172,13 @@ GpgData::GpgData(QSharedPointer<GFDataExchanger> ex)
 }
 
 GpgData::~GpgData() {
+  if (mapped_ != nullptr) {
+    // gpgme must let go of the region before it's unmapped
+    data_ref_.reset();
+    mapped_file_.unmap(mapped_);
+    mapped_file_.close();
+  }
+
   if (fp_ != nullptr) {
     fclose(fp_);
   }
@@ -133,9 +189,14 @@ GpgData::~GpgData() {
 }
 
 auto GpgData::Read2GFBuffer() -> GFBuffer {
-  gpgme_off_t ret = gpgme_data_seek(*this, 0, SEEK_SET);
   GFBuffer buffer;
 
+  // pre-size the buffer when the length of the data is known
+  const gpgme_off_t end = gpgme_data_seek(*this, 0, SEEK_END);
+  if (end > 0) buffer.Reserve(static_cast<size_t>(end));
+
+  gpgme_off_t ret = gpgme_data_seek(*this, 0, SEEK_SET);
+
   if (ret != 0) {
     const GpgError err = gpgme_err_code_from_errno(errno);
     assert(gpgme_err_code(err) == GPG_ERR_NO_ERROR);
@@ -156,4 +217,42 @@ auto GpgData::Read2GFBuffer() -> GFBuffer {
 }
 
 GpgData::operator gpgme_data_t() { return data_ref_.get(); }
+
+auto GpgData::IsMapped() const -> bool { return mapped_ != nullptr; }
+
+auto GpgData::map_file(const QString& path) -> bool {
+  const QFileInfo info(path);
+
+  // reading a page of a mapping whose file was truncated, or failed to be
+  // read, raises SIGBUS instead of an error. only files that are unlikely
+  // to change while gpgme reads them are mapped, the others are read in
+  // buffered blocks: pipes, devices and sockets, and files on network or
+  // fuse mounts. a local file truncated by another process while mapped
+  // still faults, callers expecting that pass map = false.
+  if (!info.isFile() || info.size() <= 0) return false;
+  if (sizeof(void*) < 8 && info.size() > kMaxMappedFileSize32) return false;
+  if (IsRemoteFileSystem(path)) return false;
+
+  mapped_file_.setFileName(path);
+  if (!mapped_file_.open(QIODevice::ReadOnly)) return false;
+
+  // changed between the checks and opening it
+  if (!mapped_file_.isSequential() && mapped_file_.size() == info.size()) {
+    mapped_ = mapped_file_.map(0, mapped_file_.size());
+  }
+
+  if (mapped_ == nullptr) {
+    LOG_D() << "cannot map file, fallback to stream: " << path;
+    mapped_file_.close();
+    return false;
+  }
+
+#ifdef Q_OS_UNIX
+  // the data is consumed front to back only once
+  posix_madvise(mapped_, static_cast<size_t>(mapped_file_.size()),
+                POSIX_MADV_SEQUENTIAL);
+#endif
+
+  return true;
+}
 }  // namespace GpgFrontend
\ No newline at end of file
@@ -75,9 +75,18 @@ class GF_CORE_EXPORT GpgData {
   /**
    * @brief Construct a new Gpg Data object
    *
+   * Files are read through a stream by default. With map, a regular file
+   * opened for reading is mapped into memory and handed to gpgme without a
+   * copy. A mapped file changed by someone else faults the reader, so map
+   * only files the application wrote itself and nobody else writes to.
+   * Pipes, special files, files on network or fuse mounts and files that
+   * can't be mapped are streamed anyway.
+   *
    * @param path
+   * @param read
+   * @param map
    */
-  explicit GpgData(const QString& path, bool read);
+  explicit GpgData(const QString& path, bool read, bool map = false);
 
   /**
    * @brief Construct a new Gpg Data object
@@ -105,6 +114,14 @@ class GF_CORE_EXPORT GpgData {
    */
   auto Read2GFBuffer() -> GFBuffer;
 
+  /**
+   * @brief whether the data is served from a mapped file
+   *
+   * @return true
+   * @return false
+   */
+  [[nodiscard]] auto IsMapped() const -> bool;
+
  private:
   /**
    * @brief
@@ -118,6 +135,17 @@ class GF_CORE_EXPORT GpgData {
 
   GFBuffer cached_buffer_;
 
+  QFile mapped_file_;
+  uchar* mapped_ = nullptr;
+
+  /**
+   * @brief try to map the whole file at path for reading
+   *
+   * @return true
+   * @return false
+   */
+  auto map_file(const QString& path) -> bool;
+
   std::unique_ptr<struct gpgme_data, DataRefDeleter> data_ref_ = nullptr;  ///<
   FILE* fp_ = nullptr;
   int fd_ = -1;
@@ -63,6 +63,13 @@ class GF_CORE_EXPORT GpgImportInformation {
    */
   explicit GpgImportInformation(gpgme_import_result_t result);
 
+  /**
+   * @brief fingerprints of all the keys touched by the import
+   *
+   * @return QStringList
+   */
+  [[nodiscard]] auto ImportedKeyFingerprints() const -> QStringList;
+
   int considered = 0;        ///<
   int no_user_id = 0;        ///<
   int imported = 0;          ///<
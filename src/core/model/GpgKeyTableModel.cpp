@@ -326,6 +326,45 @@ auto GpgKeyTableModel::GetGpgContextChannel() const -> int {
   return gpg_context_channel_;
 }
 
+void GpgKeyTableModel::UpdateKeys(const GpgAbstractKeyPtrList &keys,
+                                  const QStringList &removed_key_ids) {
+  auto find_row = [this](const QString &key_id) -> int {
+    for (int row = 0; row < cached_items_.size(); row++) {
+      const auto *key = cached_items_[row].Key();
+      if (key->ID() == key_id || key->Fingerprint() == key_id) return row;
+    }
+    return -1;
+  };
+
+  for (const auto &key_id : removed_key_ids) {
+    const auto row = find_row(key_id);
+    if (row < 0) continue;
+
+    beginRemoveRows({}, row, row);
+    cached_items_.removeAt(row);
+    endRemoveRows();
+  }
+
+  for (const auto &key : keys) {
+    const auto row = find_row(key->ID());
+
+    if (row < 0) {
+      const auto new_row = static_cast<int>(cached_items_.size());
+      beginInsertRows({}, new_row, new_row);
+      cached_items_.push_back(GpgKeyTableItem(key));
+      endInsertRows();
+      continue;
+    }
+
+    // keep the check state of the row
+    auto item = GpgKeyTableItem(key);
+    item.SetChecked(cached_items_[row].Checked());
+    cached_items_[row] = item;
+
+    emit dataChanged(index(row, 0, {}), index(row, columnCount({}) - 1, {}));
+  }
+}
+
 GpgKeyTableItem::GpgKeyTableItem(GpgAbstractKeyPtr key)
     : key_(std::move(key)) {}
 
@@ -250,6 +250,16 @@ class GF_CORE_EXPORT GpgKeyTableModel : public QAbstractTableModel {
    */
   [[nodiscard]] auto GetGpgContextChannel() const -> int;
 
+  /**
+   * @brief patch the rows of the given keys in place, new keys are
+   * appended and rows of keys in removed_key_ids are removed
+   *
+   * @param keys refreshed keys
+   * @param removed_key_ids
+   */
+  void UpdateKeys(const GpgAbstractKeyPtrList &keys,
+                  const QStringList &removed_key_ids);
+
  private:
   QStringList column_headers_;
   int gpg_context_channel_;
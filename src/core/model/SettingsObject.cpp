@@ -28,34 +28,20 @@
 
 #include "SettingsObject.h"
 
-#include "core/function/DataObjectOperator.h"
+#include "core/function/SettingsObjectStore.h"
 
 namespace GpgFrontend {
 
 SettingsObject::SettingsObject(QString settings_name)
-    : settings_name_(std::move(settings_name)) {
-  try {
-    auto json_optional =
-        DataObjectOperator::GetInstance().GetDataObject(settings_name_);
-
-    if (json_optional.has_value() && json_optional->isObject()) {
-      QJsonObject::operator=(json_optional.value().object());
-    } else {
-      QJsonObject::operator=({});
-    }
-
-  } catch (std::exception& e) {
-    LOG_W() << "load setting object error: {}" << e.what();
-  }
-}
+    : QJsonObject(SettingsObjectStore::GetInstance().Load(settings_name)),
+      settings_name_(std::move(settings_name)) {}
 
 SettingsObject::SettingsObject(QJsonObject sub_json)
     : QJsonObject(std::move(sub_json)) {}
 
 SettingsObject::~SettingsObject() {
   if (!settings_name_.isEmpty()) {
-    DataObjectOperator::GetInstance().StoreDataObj(settings_name_,
-                                                   QJsonDocument(*this));
+    SettingsObjectStore::GetInstance().Save(settings_name_, *this);
   }
 }
 
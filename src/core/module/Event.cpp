@@ -28,6 +28,8 @@
 
 #include "Event.h"
 
+#include <mutex>
+
 #include "core/utils/CommonUtils.h"
 #include "sdk/GFSDKModuleModel.h"
 
@@ -71,7 +73,9 @@ class Event::Impl {
   }
 
   void AddParameter(const QString& key, const GFBuffer& value) {
+    std::lock_guard lock(param_block_lock_);
     data_[key] = value;
+    param_block_ = nullptr;
   }
 
   void AddParameter(const ParameterInitializer& param) {
@@ -93,17 +97,33 @@ class Event::Impl {
     }
   }
 
-  auto ToModuleEvent() -> GFModuleEvent* {
+  auto GetParamBlock() -> EventParamBlockPtr {
+    std::lock_guard lock(param_block_lock_);
+    if (param_block_ == nullptr) {
+      auto block = SecureCreateSharedObject<EventParamBlock>();
+      for (auto it = data_.constKeyValueBegin(); it != data_.constKeyValueEnd();
+           ++it) {
+        block->params.push_back({it->first.toUtf8(), it->second});
+      }
+      param_block_ = block;
+    }
+    return param_block_;
+  }
+
+  auto ToModuleEvent(bool copy_params) -> GFModuleEvent* {
     auto* event = static_cast<GFModuleEvent*>(SMAMalloc(sizeof(GFModuleEvent)));
 
     event->id = GFStrDup(event_identifier_);
     event->trigger_id = GFStrDup(trigger_uuid_);
     event->params = nullptr;
+    if (!copy_params) return event;
 
     GFModuleEventParam* l_param = nullptr;
     GFModuleEventParam* p_param;
 
-    for (auto it = data_.keyValueBegin(); it != data_.keyValueEnd(); ++it) {
+    // read only, the listeners of an event may convert it at the same time
+    for (auto it = data_.constKeyValueBegin(); it != data_.constKeyValueEnd();
+         ++it) {
       p_param = static_cast<GFModuleEventParam*>(
           SMAMalloc(sizeof(GFModuleEventParam)));
       if (event->params == nullptr) event->params = p_param;
@@ -125,8 +145,18 @@ class Event::Impl {
   QMap<QString, GFBuffer> data_;
   EventCallback callback_;
   QThread* callback_thread_ = nullptr;  ///<
+
+  std::mutex param_block_lock_;
+  EventParamBlockPtr param_block_;
 };
 
+auto EventParamBlock::Find(const QByteArray& name) const -> const GFBuffer* {
+  for (const auto& param : params) {
+    if (param.first == name) return &param.second;
+  }
+  return nullptr;
+}
+
 Event::Event(const QString& event_id, const Params& params,
              EventCallback callback)
     : p_(SecureCreateUniqueObject<Impl>(event_id, params,
@@ -164,6 +194,12 @@ void Event::ExecuteCallback(ListenerIdentifier l_id, const Params& param) {
   p_->ExecuteCallback(l_id, param);
 }
 
-auto Event::ToModuleEvent() -> GFModuleEvent* { return p_->ToModuleEvent(); }
+auto Event::GetParamBlock() -> EventParamBlockPtr {
+  return p_->GetParamBlock();
+}
+
+auto Event::ToModuleEvent(bool copy_params) -> GFModuleEvent* {
+  return p_->ToModuleEvent(copy_params);
+}
 
 }  // namespace GpgFrontend::Module
\ No newline at end of file
@@ -41,7 +41,26 @@ namespace GpgFrontend::Module {
 
 class Event;
 
+/**
+ * @brief the parameters of an event frozen into a read-only block, which
+ * all listeners of the event share. the values share the storage of the
+ * event's buffers, nothing is copied.
+ *
+ */
+struct GF_CORE_EXPORT EventParamBlock {
+  QContainer<QPair<QByteArray, GFBuffer>> params;  ///< utf-8 name, value
+
+  /**
+   * @brief find a parameter by its utf-8 name
+   *
+   * @param name
+   * @return const GFBuffer* nullptr if there's none
+   */
+  [[nodiscard]] auto Find(const QByteArray& name) const -> const GFBuffer*;
+};
+
 using EventReference = QSharedPointer<Event>;
+using EventParamBlockPtr = QSharedPointer<const EventParamBlock>;
 using EventIdentifier = QString;
 using EventTriggerIdentifier = QString;
 using Events = QContainer<Event>;
@@ -84,7 +103,23 @@ class GF_CORE_EXPORT Event {
 
   void ExecuteCallback(ListenerIdentifier, const Params&);
 
-  auto ToModuleEvent() -> GFModuleEvent*;
+  /**
+   * @brief Get the parameters as a block shared by all listeners, built the
+   * first time it's asked for
+   *
+   * @return EventParamBlockPtr
+   */
+  auto GetParamBlock() -> EventParamBlockPtr;
+
+  /**
+   * @brief convert to the event handed to a module. copy_params false
+   * leaves the parameter list empty, for the modules reading them from
+   * the shared block (GFModuleAcquireEventParams).
+   *
+   * @param copy_params
+   * @return GFModuleEvent*
+   */
+  auto ToModuleEvent(bool copy_params = true) -> GFModuleEvent*;
 
  private:
   class Impl;
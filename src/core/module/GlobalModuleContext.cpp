@@ -28,10 +28,18 @@
 
 #include "GlobalModuleContext.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "core/function/GlobalSettingStation.h"
 #include "core/module/Event.h"
 #include "core/module/Module.h"
 #include "core/thread/Task.h"
@@ -43,10 +51,46 @@ namespace GpgFrontend::Module {
 
 class GlobalModuleContext::Impl {
  public:
-  explicit Impl() {
+  explicit Impl()
+      : idle_timeout_(std::chrono::seconds(std::max(
+            GetSettings().value("module/idle_deactivate_seconds", 600).toInt(),
+            0))),
+        parallel_dispatch_(
+            GetSettings().value("module/parallel_dispatch", true).toBool()) {
     // Initialize acquired channels with default values.
     acquired_channel_.insert(kGpgFrontendDefaultChannel);
     acquired_channel_.insert(kGpgFrontendNonAsciiChannel);
+
+    if (idle_timeout_.count() > 0) {
+      // the sweeps go through the guard, one may still be posted or running
+      // on the module runner when this is destroyed
+      run_guard_->impl = this;
+
+      Thread::TaskScheduler::Options options;
+      options.delay = options.period = std::clamp<std::chrono::milliseconds>(
+          idle_timeout_ / 2, std::chrono::seconds(1), std::chrono::minutes(1));
+      options.coalesce_key =
+          QString("global_module_context/%1/idle_sweep")
+              .arg(reinterpret_cast<quintptr>(this));
+      idle_sweep_timer_ = module_runner()->PostScheduleTask(
+          "module_idle_sweep",
+          [guard = run_guard_](const DataObjectPtr&) -> int {
+            std::shared_lock lock(guard->lock);
+            if (guard->impl != nullptr) guard->impl->deactivate_idle_modules();
+            return 0;
+          },
+          options);
+    }
+  }
+
+  ~Impl() {
+    if (idle_sweep_timer_ != Thread::TaskScheduler::kInvalidTimerID) {
+      module_runner()->CancelScheduleTask(idle_sweep_timer_);
+    }
+
+    // waits for a sweep in progress, the sweeps posted later find no Impl
+    std::unique_lock lock(run_guard_->lock);
+    run_guard_->impl = nullptr;
   }
 
   auto SearchModule(const ModuleIdentifier& module_id) -> ModulePtr {
@@ -86,10 +130,11 @@ class GlobalModuleContext::Impl {
         Thread::TaskRunnerGetter::kTaskRunnerType_Module);
   }
 
-  static auto GetTaskRunner(const ModuleIdentifier& /*module_id*/)
+  auto GetTaskRunner(const ModuleIdentifier& module_id)
       -> std::optional<TaskRunnerPtr> {
-    return Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
-        Thread::TaskRunnerGetter::kTaskRunnerType_Module);
+    auto module_info_opt = search_module_register_table(module_id);
+    if (!module_info_opt.has_value()) return module_runner();
+    return dispatch_runner(module_info_opt.value());
   }
 
   auto GetGlobalTaskRunner() -> std::optional<TaskRunnerPtr> {
@@ -97,34 +142,48 @@ class GlobalModuleContext::Impl {
   }
 
   auto RegisterModule(const ModulePtr& module, bool integrated_module) -> bool {
-    // Check if the module is null or already registered.
-    if (module == nullptr ||
-        module_register_table_.find(module->GetModuleIdentifier()) !=
-            module_register_table_.end()) {
+    if (module == nullptr) {
       FLOG_W("module is null or have already registered this module");
       registered_modules_++;
       return false;
     }
 
-    LOG_D() << "(+) module: " << module->GetModuleIdentifier()
-            << "registering...";
-
     auto register_info =
         GpgFrontend::SecureCreateSharedObject<ModuleRegisterInfo>();
     register_info->module = module;
-    register_info->channel = acquire_new_unique_channel();
     register_info->integrated = integrated_module;
+    register_info->parallel =
+        parallel_dispatch_ && module->GetModuleMetaData().value("Dispatch") ==
+                                  QLatin1String("parallel");
+
+    {
+      std::unique_lock lock(lock_);
+
+      // Check if the module is already registered.
+      if (module_register_table_.find(module->GetModuleIdentifier()) !=
+          module_register_table_.end()) {
+        FLOG_W("module is null or have already registered this module");
+        registered_modules_++;
+        return false;
+      }
 
-    // move module to its task runner' thread
-    register_info->module->setParent(nullptr);
-    register_info->module->moveToThread(
-        Thread::TaskRunnerGetter::GetInstance()
-            .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_Module)
-            ->GetThread());
+      register_info->channel = acquire_new_unique_channel();
+
+      // register the module with its identifier.
+      module_register_table_[module->GetModuleIdentifier()] = register_info;
+    }
 
-    // register the module with its identifier.
-    module_register_table_[module->GetModuleIdentifier()] = register_info;
+    LOG_D() << "(+) module: " << module->GetModuleIdentifier()
+            << "registering...";
+
+    // the module object lives on the module runner's thread. its Active(),
+    // Exec() and Deactivate() run there too, unless the module declares
+    // "Dispatch" = "parallel". see the threading contract in
+    // GFSDKModuleModel.h.
+    register_info->module->setParent(nullptr);
+    register_info->module->moveToThread(module_runner()->GetThread());
 
+    // the module may listen to events from here, so no lock is held
     if (module->Register() != 0) {
       LOG_W() << "module: " << module->GetModuleIdentifier()
               << " register failed.";
@@ -168,9 +227,12 @@ class GlobalModuleContext::Impl {
     }
 
     // Activate the module if it is not already active.
+    std::lock_guard exec_lock(module_info->exec_lock);
     if (!module_info->activate) {
       module->Active();
       module_info->activate = true;
+      module_info->started = true;
+      module_info->on_demand = false;
 
       LOG_D() << "(*) module: " << module_id << "activated.";
     }
@@ -178,10 +240,47 @@ class GlobalModuleContext::Impl {
     return module_info->activate;
   }
 
+  auto ActivateModuleOnDemand(const ModuleIdentifier& module_id) -> bool {
+    if (!GetSettings().value("module/lazy_activation", true).toBool()) {
+      return false;
+    }
+
+    auto module_info_opt = search_module_register_table(module_id);
+    if (!module_info_opt.has_value()) return false;
+
+    const auto& module_info = module_info_opt.value();
+    if (!module_info->registered || module_info->module == nullptr) {
+      return false;
+    }
+    if (module_info->activate) return true;
+
+    // only a module telling which events it listens to can wait for them
+    QStringList events;
+    const auto value =
+        module_info->module->GetModuleMetaData().value("ListenEvents");
+    for (const auto& event : value.split(',')) {
+      if (!event.trimmed().isEmpty()) events.append(event.trimmed());
+    }
+    if (events.isEmpty()) return false;
+
+    for (const auto& event : events) ListenEvent(module_id, event);
+
+    std::lock_guard exec_lock(module_info->exec_lock);
+    module_info->activate = true;
+    module_info->on_demand = true;
+    module_info->started = false;
+
+    LOG_D() << "(*) module: " << module_id
+            << "will be activated on its first event:" << events;
+    return true;
+  }
+
   auto ListenEvent(const ModuleIdentifier& module_id,
                    const EventIdentifier& event) -> bool {
+    std::unique_lock lock(lock_);
+
     // module -> event
-    auto module_info_opt = search_module_register_table(module_id);
+    auto module_info_opt = search_module_register_table_locked(module_id);
     if (!module_info_opt.has_value()) {
       LOG_W() << "cannot find module id" << module_id << "at register table";
       return false;
@@ -194,7 +293,10 @@ class GlobalModuleContext::Impl {
       met_it = module_events_table_.find(event);
     }
 
-    module_info_opt.value()->listening_event_ids.push_back(event);
+    auto& listening_event_ids = module_info_opt.value()->listening_event_ids;
+    if (!listening_event_ids.contains(event)) {
+      listening_event_ids.push_back(event);
+    }
 
     auto& listeners_set = met_it->second;
     // Add the listener (module) to the event.
@@ -214,8 +316,14 @@ class GlobalModuleContext::Impl {
     }
 
     auto module_info = module_info_opt.value();
-    // activate the module if it is not already Deactivate.
-    if (module_info->activate && (module_info->module->Deactivate() == 0)) {
+
+    // waits for an event the module is handling, so this runs on the
+    // module's own runner (see GetTaskRunner()). a module waiting for its
+    // first event was never started, nothing to stop.
+    std::lock_guard exec_lock(module_info->exec_lock);
+    if (module_info->activate &&
+        (!module_info->started || module_info->module->Deactivate() == 0)) {
+      std::unique_lock lock(lock_);
       for (const auto& event_ids : module_info->listening_event_ids) {
         auto& modules = module_events_table_[event_ids];
         if (auto it = modules.find(module_id); it != modules.end()) {
@@ -225,6 +333,8 @@ class GlobalModuleContext::Impl {
 
       module_info->listening_event_ids.clear();
       module_info->activate = false;
+      module_info->started = false;
+      module_info->on_demand = false;
     }
 
     return !module_info->activate;
@@ -233,69 +343,57 @@ class GlobalModuleContext::Impl {
   auto TriggerEvent(const EventReference& event) -> bool {
     auto event_id = event->GetIdentifier();
 
-    // Find the set of listeners associated with the given event in the table
-    auto met_it = module_events_table_.find(event_id);
-    if (met_it == module_events_table_.end()) {
-      // Log a warning if the event is not registered and nobody is listening
-      LOG_I() << "event: " << event_id
-              << " is not listening by anyone and not registered as well.";
-      return false;
-    }
+    QContainer<ModuleRegisterInfoPtr> listeners;
+    {
+      std::shared_lock lock(lock_);
+
+      // Find the set of listeners associated with the given event
+      auto met_it = module_events_table_.find(event_id);
+      if (met_it == module_events_table_.end()) {
+        // Log a warning if the event is not registered and nobody is
+        // listening
+        LOG_I() << "event: " << event_id
+                << " is not listening by anyone and not registered as well.";
+        return false;
+      }
 
-    // Retrieve the set of listeners for this event
-    auto& listeners_set = met_it->second;
+      // Check if the set of listeners is empty
+      if (met_it->second.empty()) {
+        // Log a warning if nobody is listening to this event
+        LOG_I() << "event: " << event_id << " is not listening by anyone";
+        return false;
+      }
 
-    // Check if the set of listeners is empty
-    if (listeners_set.empty()) {
-      // Log a warning if nobody is listening to this event
-      LOG_I() << "event: " << event_id << " is not listening by anyone";
-      return false;
-    }
+      for (const auto& listener_module_id : met_it->second) {
+        // Search for the module's information in the registration table
+        auto module_info_opt =
+            search_module_register_table_locked(listener_module_id);
 
-    // register trigger id index table
-    module_on_triggering_events_table_[event->GetTriggerIdentifier()] = event;
+        // Log an error if the module is not found in the registration table
+        if (!module_info_opt.has_value()) {
+          LOG_W() << "cannot find module id: " << listener_module_id
+                  << " at register table";
+          continue;
+        }
 
-    // Iterate through each listener and execute the corresponding module
-    for (const auto& listener_module_id : listeners_set) {
-      // Search for the module's information in the registration table
-      auto module_info_opt = search_module_register_table(listener_module_id);
+        // Check if the module is activated
+        if (!module_info_opt.value()->activate) continue;
 
-      // Log an error if the module is not found in the registration table
-      if (!module_info_opt.has_value()) {
-        LOG_W() << "cannot find module id: " << listener_module_id
-                << " at register table";
-        continue;
+        listeners.push_back(module_info_opt.value());
       }
+    }
 
-      // Retrieve the module's information
-      const auto& module_info = module_info_opt.value();
-      auto module = module_info->module;
-
-      // Check if the module is activated
-      if (!module_info->activate) continue;
-
-      Thread::Task::TaskRunnable const exec_runnerable =
-          [module, event](const DataObjectPtr&) -> int {
-        return module->Exec(event);
-      };
-
-      Thread::Task::TaskCallback const exec_callback =
-          [listener_module_id, event_id](int code, const DataObjectPtr&) {
-            if (code < 0) {
-              // Log an error if the module execution fails
-              LOG_W() << "module " << listener_module_id
-                      << "execution failed of event " << event_id
-                      << ": exec return code: " << code;
-            }
-          };
-
-      Thread::TaskRunnerGetter::GetInstance()
-          .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_Module)
-          ->PostTask(new Thread::Task(exec_runnerable,
-                                      QString("event/%1/module/exec/%2")
-                                          .arg(event_id)
-                                          .arg(listener_module_id),
-                                      nullptr, exec_callback));
+    // register trigger id index table
+    {
+      std::lock_guard lock(triggering_events_lock_);
+      module_on_triggering_events_table_[event->GetTriggerIdentifier()] =
+          event;
+    }
+
+    // each module gets the event in its own queue, the parallel ones run
+    // side by side on the default runner
+    for (const auto& module_info : listeners) {
+      enqueue(dispatch_runner(module_info), module_info, event);
     }
 
     // Return true to indicate successful execution of all modules
@@ -304,10 +402,9 @@ class GlobalModuleContext::Impl {
 
   auto SearchEvent(const EventTriggerIdentifier& trigger_id)
       -> std::optional<EventReference> {
-    if (module_on_triggering_events_table_.find(trigger_id) !=
-        module_on_triggering_events_table_.end()) {
-      return module_on_triggering_events_table_[trigger_id];
-    }
+    std::lock_guard lock(triggering_events_lock_);
+    auto it = module_on_triggering_events_table_.find(trigger_id);
+    if (it != module_on_triggering_events_table_.end()) return it->second;
     return {};
   }
 
@@ -330,15 +427,19 @@ class GlobalModuleContext::Impl {
 
   auto ListAllRegisteredModuleID() -> QStringList {
     QStringList module_ids;
-    for (const auto& module : module_register_table_) {
-      module_ids.append(module.first);
+    {
+      std::shared_lock lock(lock_);
+      for (const auto& module : module_register_table_) {
+        module_ids.append(module.first);
+      }
     }
     module_ids.sort();
     return module_ids;
   }
 
   auto GetModuleListening(const ModuleIdentifier& module_id) -> QStringList {
-    auto module_info = search_module_register_table(module_id);
+    std::shared_lock lock(lock_);
+    auto module_info = search_module_register_table_locked(module_id);
     if (!module_info.has_value()) return {};
     return module_info->get()->listening_event_ids;
   }
@@ -349,26 +450,193 @@ class GlobalModuleContext::Impl {
 
  private:
   struct ModuleRegisterInfo {
-    int channel;
+    int channel = 0;
     ModulePtr module;
-    bool registered;
-    bool activate;
-    bool integrated;
-    QStringList listening_event_ids;
+    std::atomic_bool registered{false};
+    std::atomic_bool activate{false};
+    bool integrated = false;
+    bool parallel = false;  ///< declared "Dispatch" = "parallel"
+    QStringList listening_event_ids;    ///< guarded by lock_
+    std::atomic_bool on_demand{false};  ///< started by events, stopped idle
+
+    /// held while the module is started, runs an event or is stopped
+    std::mutex exec_lock;
+    bool started = false;  ///< Active() was called and not undone
+    std::chrono::steady_clock::time_point last_used;
+
+    /// the events waiting for the module, handled one at a time
+    std::mutex queue_lock;
+    std::deque<EventReference> queue;
+    bool draining = false;
   };
 
   using ModuleRegisterInfoPtr = QSharedPointer<ModuleRegisterInfo>;
 
+  /// how many queued events a module handles before it yields its worker
+  static constexpr int kDrainBatch = 32;
+
+  /// guards the register and events tables, events only take it shared
+  mutable std::shared_mutex lock_;
   std::unordered_map<ModuleIdentifier, ModuleRegisterInfoPtr>
       module_register_table_;
   std::map<EventIdentifier, std::unordered_set<ModuleIdentifier>>
       module_events_table_;
+  std::set<int> acquired_channel_;
+
+  std::mutex triggering_events_lock_;
   std::map<EventTriggerIdentifier, EventReference>
       module_on_triggering_events_table_;
 
-  std::set<int> acquired_channel_;
   TaskRunnerPtr default_task_runner_;
-  int registered_modules_ = 0;
+  std::atomic_int registered_modules_{0};
+  std::chrono::milliseconds idle_timeout_;
+  bool parallel_dispatch_;  ///< modules may opt into parallel dispatch
+  Thread::TaskScheduler::TimerID idle_sweep_timer_ =
+      Thread::TaskScheduler::kInvalidTimerID;
+
+  struct RunGuard {
+    std::shared_mutex lock;
+    Impl* impl = nullptr;
+  };
+  std::shared_ptr<RunGuard> run_guard_ = std::make_shared<RunGuard>();
+
+  static auto module_runner() -> TaskRunnerPtr {
+    return Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
+        Thread::TaskRunnerGetter::kTaskRunnerType_Module);
+  }
+
+  /**
+   * @brief the runner a module's calls run on
+   *
+   * @param module_info
+   * @return TaskRunnerPtr
+   */
+  static auto dispatch_runner(const ModuleRegisterInfoPtr& module_info)
+      -> TaskRunnerPtr {
+    if (!module_info->parallel) return module_runner();
+    return Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
+        Thread::TaskRunnerGetter::kTaskRunnerType_Default);
+  }
+
+  /**
+   * @brief queue an event for a module, a drain task is posted unless one
+   * is already running for it
+   *
+   * @param runner
+   * @param module_info
+   * @param event
+   */
+  static void enqueue(const TaskRunnerPtr& runner,
+                      const ModuleRegisterInfoPtr& module_info,
+                      const EventReference& event) {
+    {
+      std::lock_guard lock(module_info->queue_lock);
+      module_info->queue.push_back(event);
+      if (module_info->draining) return;
+      module_info->draining = true;
+    }
+    post_drain(runner, module_info);
+  }
+
+  static void post_drain(const TaskRunnerPtr& runner,
+                         const ModuleRegisterInfoPtr& module_info) {
+    const auto module_id = module_info->module->GetModuleIdentifier();
+    runner->PostTask(new Thread::Task(
+        [runner, module_info](const DataObjectPtr&) -> int {
+          drain(runner, module_info);
+          return 0;
+        },
+        QString("event/module/exec/%1").arg(module_id), nullptr));
+  }
+
+  /**
+   * @brief run the queued events of a module in order. after a batch the
+   * rest is posted again, so that a busy module doesn't hold a worker.
+   *
+   * @param runner
+   * @param module_info
+   */
+  static void drain(const TaskRunnerPtr& runner,
+                    const ModuleRegisterInfoPtr& module_info) {
+    for (int i = 0; i < kDrainBatch; i++) {
+      EventReference event;
+      {
+        std::lock_guard lock(module_info->queue_lock);
+        if (module_info->queue.empty()) {
+          module_info->draining = false;
+          return;
+        }
+        event = module_info->queue.front();
+        module_info->queue.pop_front();
+      }
+      exec(module_info, event);
+    }
+    post_drain(runner, module_info);
+  }
+
+  static void exec(const ModuleRegisterInfoPtr& module_info,
+                   const EventReference& event) {
+    const auto module_id = module_info->module->GetModuleIdentifier();
+
+    std::lock_guard exec_lock(module_info->exec_lock);
+
+    // deactivated after the event was queued
+    if (!module_info->activate) return;
+
+    // a module activated on demand is started by its first event
+    if (!module_info->started) {
+      LOG_D() << "(*) module: " << module_id
+              << "activating on event:" << event->GetIdentifier();
+      module_info->module->Active();
+      module_info->started = true;
+    }
+
+    auto code = module_info->module->Exec(event);
+    module_info->last_used = std::chrono::steady_clock::now();
+
+    if (code < 0) {
+      // Log an error if the module execution fails
+      LOG_W() << "module " << module_id << "execution failed of event "
+              << event->GetIdentifier() << ": exec return code: " << code;
+    }
+  }
+
+  /**
+   * @brief stop the modules activated on demand that had no event for the
+   * configured quiet period, module/idle_deactivate_seconds. they stay
+   * subscribed and are started again by their next event.
+   *
+   */
+  void deactivate_idle_modules() {
+    QContainer<ModuleRegisterInfoPtr> modules;
+    {
+      std::shared_lock lock(lock_);
+      for (const auto& module : module_register_table_) {
+        if (module.second->on_demand) modules.push_back(module.second);
+      }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& module_info : modules) {
+      {
+        std::lock_guard lock(module_info->queue_lock);
+        if (module_info->draining) continue;
+      }
+
+      // busy with an event, it isn't idle
+      std::unique_lock exec_lock(module_info->exec_lock, std::try_to_lock);
+      if (!exec_lock.owns_lock() || !module_info->started) continue;
+      if (now - module_info->last_used < idle_timeout_) continue;
+
+      const auto module_id = module_info->module->GetModuleIdentifier();
+      if (module_info->module->Deactivate() != 0) {
+        LOG_W() << "module: " << module_id << "failed to deactivate when idle";
+        continue;
+      }
+      module_info->started = false;
+      LOG_D() << "(-) module: " << module_id << "deactivated, idle.";
+    }
+  }
 
   auto acquire_new_unique_channel() -> int {
     int random_channel = QRandomGenerator::global()->bounded(65535);
@@ -386,6 +654,14 @@ class GlobalModuleContext::Impl {
   [[nodiscard]] auto search_module_register_table(
       const ModuleIdentifier& identifier) const
       -> std::optional<ModuleRegisterInfoPtr> {
+    std::shared_lock lock(lock_);
+    return search_module_register_table_locked(identifier);
+  }
+
+  // the same, for a caller holding lock_
+  [[nodiscard]] auto search_module_register_table_locked(
+      const ModuleIdentifier& identifier) const
+      -> std::optional<ModuleRegisterInfoPtr> {
     auto mrt_it = module_register_table_.find(identifier);
     if (mrt_it == module_register_table_.end()) {
       return std::nullopt;
@@ -433,6 +709,11 @@ auto GlobalModuleContext::ActiveModule(const ModuleIdentifier& module_id)
   return p_->ActiveModule(module_id);
 }
 
+auto GlobalModuleContext::ActivateModuleOnDemand(
+    const ModuleIdentifier& module_id) -> bool {
+  return p_->ActivateModuleOnDemand(module_id);
+}
+
 auto GlobalModuleContext::ListenEvent(const ModuleIdentifier& module_id,
                                       const EventIdentifier& event) -> bool {
   return p_->ListenEvent(module_id, event);
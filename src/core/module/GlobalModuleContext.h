@@ -73,6 +73,17 @@ class GF_CORE_EXPORT GlobalModuleContext : public QObject {
 
   auto ActiveModule(const ModuleIdentifier&) -> bool;
 
+  /**
+   * @brief mark a module activated but start it only when one of the events
+   * listed in its "ListenEvents" meta data (comma separated) is triggered.
+   * When it gets no event for module/idle_deactivate_seconds it's stopped
+   * again until the next one.
+   *
+   * @return false if lazy activation is turned off (module/lazy_activation)
+   * or the module doesn't declare its events, it should be activated now
+   */
+  auto ActivateModuleOnDemand(const ModuleIdentifier&) -> bool;
+
   auto DeactivateModule(const ModuleIdentifier&) -> bool;
 
   auto ListenEvent(const ModuleIdentifier&, const EventIdentifier&) -> bool;
@@ -145,7 +145,10 @@ class Module::Impl {
 
   auto Exec(const EventReference& event) -> int {
     if (good_ && execute_api_ != nullptr) {
-      return execute_api_(event->ToModuleEvent());
+      // a module reading the shared parameter block doesn't need its copy
+      const auto borrowed =
+          meta_data_.value("EventParams") == QLatin1String("borrowed");
+      return execute_api_(event->ToModuleEvent(!borrowed));
     }
     return -1;
   }
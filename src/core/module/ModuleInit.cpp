@@ -171,12 +171,9 @@ void LoadGpgFrontendModules(ModuleInitArgs) {
             auto& manager = ModuleManager::GetInstance();
             manager.SetNeedRegisterModulesNum(static_cast<int>(modules.size()));
 
-            for (auto it = modules.keyValueBegin(); it != modules.keyValueEnd();
-                 ++it) {
-              manager.LoadModule(it->first, it->second);
-            }
+            auto loaded = manager.LoadModules(modules);
 
-            LOG_D() << "all modules are loaded into memory: " << modules.size();
+            LOG_D() << "all modules are loaded into memory: " << loaded;
             return 0;
           },
           "modules_system_init_task"));
@@ -28,6 +28,11 @@
 
 #include "ModuleManager.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+#include "core/function/GlobalSettingStation.h"
 #include "core/function/basic/GpgFunctionObject.h"
 #include "core/model/SettingsObject.h"
 #include "core/module/GlobalModuleContext.h"
@@ -40,6 +45,41 @@
 
 namespace GpgFrontend::Module {
 
+namespace {
+
+/**
+ * @brief a module library on its way to be registered, with the time each
+ * startup step took
+ *
+ */
+struct StartupModule {
+  QString path;
+  bool integrated = false;
+  ModulePtr module;
+  qint64 load_ms = 0;
+  qint64 validate_ms = 0;
+  qint64 register_ms = 0;
+  qint64 activate_ms = 0;
+};
+
+/**
+ * @brief the module ids listed in the "Dependencies" meta data of a module,
+ * separated by commas
+ *
+ * @param module
+ * @return QStringList
+ */
+auto ModuleDependencies(const ModulePtr& module) -> QStringList {
+  QStringList dependencies;
+  const auto value = module->GetModuleMetaData().value("Dependencies");
+  for (const auto& id : value.split(',')) {
+    if (!id.trimmed().isEmpty()) dependencies.append(id.trimmed());
+  }
+  return dependencies;
+}
+
+}  // namespace
+
 class ModuleManager::Impl {
  public:
   Impl()
@@ -50,29 +90,12 @@ class ModuleManager::Impl {
 
   auto LoadAndRegisterModule(const QString& module_library_path,
                              bool integrated_module) -> bool {
-    QLibrary module_library(module_library_path);
-    if (!module_library.load()) {
-      LOG_W() << "module manager failed to load module: "
-              << module_library.fileName()
-              << ", reason: " << module_library.errorString();
+    auto module = load_module(module_library_path);
+    if (module == nullptr) {
       need_register_modules_--;
       return false;
     }
 
-    auto module = SecureCreateSharedObject<Module>(module_library);
-    if (!module->IsGood()) {
-      LOG_W() << "module manager failed to load module, "
-                 "reason: illegal module: "
-              << module_library.fileName();
-      need_register_modules_--;
-      return false;
-    }
-
-    module->SetGPC(gmc_.get());
-
-    LOG_D() << "a new need register module: "
-            << QFileInfo(module_library_path).fileName();
-
     auto runner = Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
         Thread::TaskRunnerGetter::kTaskRunnerType_Module);
 
@@ -87,38 +110,59 @@ class ModuleManager::Impl {
 
     runner->PostTask(new Thread::Task(
         [=](const GpgFrontend::DataObjectPtr&) -> int {
-          const auto module_id = module->GetModuleIdentifier();
-          const auto module_hash = module->GetModuleHash();
-
-          SettingsObject so(QString("module.%1.so").arg(module_id));
-          ModuleSO module_so(so);
-
-          // reset module settings if necessary
-          if (module_so.module_id != module_id ||
-              module_so.module_hash != module_hash) {
-            module_so.module_id = module_id;
-            module_so.module_hash = module_hash;
-            // auto active integrated module by default
-            module_so.auto_activate = integrated_module;
-            module_so.set_by_user = false;
-
-            so.Store(module_so.ToJson());
-          }
-
-          // if this module need auto active
-          if (module_so.auto_activate) {
-            if (!gmc_->ActiveModule(module_id)) {
-              return -1;
-            }
-          }
-
-          return 0;
+          return activate_if_needed(module, integrated_module) ? 0 : -1;
         },
         __func__, nullptr));
 
     return true;
   }
 
+  auto LoadAndRegisterModules(const QMap<QString, bool>& module_libraries)
+      -> int {
+    QElapsedTimer total;
+    total.start();
+
+    QContainer<StartupModule> modules;
+    for (auto it = module_libraries.cbegin(); it != module_libraries.cend();
+         ++it) {
+      modules.push_back({it.key(), it.value()});
+    }
+
+    // loading and validating (hashing, symbols, versions) don't touch the
+    // module tables, so the libraries are opened side by side
+    const auto parallel =
+        GetSettings().value("module/parallel_loading", true).toBool();
+    if (parallel && modules.size() > 1) {
+      load_modules_concurrently(modules);
+    } else {
+      for (auto& m : modules) load_module(m);
+    }
+
+    QContainer<StartupModule> loaded;
+    for (const auto& m : modules) {
+      if (m.module != nullptr) {
+        loaded.push_back(m);
+      } else {
+        need_register_modules_--;
+      }
+    }
+
+    // registration and activation stay on this thread, in dependency order
+    loaded = sort_by_dependencies(loaded);
+    for (auto& m : loaded) {
+      QElapsedTimer timer;
+      timer.start();
+      if (!gmc_->RegisterModule(m.module, m.integrated)) continue;
+      m.register_ms = timer.restart();
+
+      activate_if_needed(m.module, m.integrated);
+      m.activate_ms = timer.elapsed();
+    }
+
+    publish_startup_timing(loaded, total.elapsed(), parallel);
+    return static_cast<int>(loaded.size());
+  }
+
   void SetNeedRegisterModulesNum(int n) {
     if (need_register_modules_ != -1 || n < 0) return;
     need_register_modules_ = n;
@@ -175,26 +219,35 @@ class ModuleManager::Impl {
     return gmc_->GetModuleListening(module_id);
   }
 
+  /**
+   * @brief the runner the module's calls run on, activation waits for an
+   * event the module is handling there
+   *
+   * @param identifier
+   * @return TaskRunnerPtr
+   */
+  auto module_runner(const ModuleIdentifier& identifier) -> TaskRunnerPtr {
+    return gmc_->GetTaskRunner(identifier).value_or(
+        Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
+            Thread::TaskRunnerGetter::kTaskRunnerType_Module));
+  }
+
   void ActiveModule(const ModuleIdentifier& identifier) {
-    Thread::TaskRunnerGetter::GetInstance()
-        .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_Module)
-        ->PostTask(new Thread::Task(
-            [=](const GpgFrontend::DataObjectPtr&) -> int {
-              gmc_->ActiveModule(identifier);
-              return 0;
-            },
-            __func__, nullptr));
+    module_runner(identifier)->PostTask(new Thread::Task(
+        [=](const GpgFrontend::DataObjectPtr&) -> int {
+          gmc_->ActiveModule(identifier);
+          return 0;
+        },
+        __func__, nullptr));
   }
 
   void DeactivateModule(const ModuleIdentifier& identifier) {
-    Thread::TaskRunnerGetter::GetInstance()
-        .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_Module)
-        ->PostTask(new Thread::Task(
-            [=](const GpgFrontend::DataObjectPtr&) -> int {
-              gmc_->DeactivateModule(identifier);
-              return 0;
-            },
-            __func__, nullptr));
+    module_runner(identifier)->PostTask(new Thread::Task(
+        [=](const GpgFrontend::DataObjectPtr&) -> int {
+          gmc_->DeactivateModule(identifier);
+          return 0;
+        },
+        __func__, nullptr));
   }
 
   auto GetTaskRunner(const ModuleIdentifier& module_id)
@@ -242,6 +295,169 @@ class ModuleManager::Impl {
   SecureUniquePtr<GlobalRegisterTable> grt_;
   QContainer<QLibrary> module_libraries_;
   int need_register_modules_ = -1;
+
+  /**
+   * @brief open a module library and check it's a legal module
+   *
+   * @param module_library_path
+   * @return ModulePtr nullptr if it can't be used
+   */
+  auto load_module(const QString& module_library_path) -> ModulePtr {
+    StartupModule m{module_library_path};
+    load_module(m);
+    return m.module;
+  }
+
+  void load_module(StartupModule& m) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QLibrary module_library(m.path);
+    if (!module_library.load()) {
+      LOG_W() << "module manager failed to load module: "
+              << module_library.fileName()
+              << ", reason: " << module_library.errorString();
+      return;
+    }
+    m.load_ms = timer.restart();
+
+    auto module = SecureCreateSharedObject<Module>(module_library);
+    if (!module->IsGood()) {
+      LOG_W() << "module manager failed to load module, "
+                 "reason: illegal module: "
+              << module_library.fileName();
+      return;
+    }
+    m.validate_ms = timer.elapsed();
+
+    // the module may be created on a worker thread, only that thread can
+    // hand it over to the module runner
+    module->moveToThread(
+        Thread::TaskRunnerGetter::GetInstance()
+            .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_Module)
+            ->GetThread());
+    module->SetGPC(gmc_.get());
+
+    LOG_D() << "a new need register module: " << QFileInfo(m.path).fileName();
+    m.module = module;
+  }
+
+  /**
+   * @brief load the modules on the default runner and wait for all of them
+   *
+   * @param modules
+   */
+  /**
+   * @brief SortModulesByDependencies() for the modules starting up
+   *
+   */
+  static auto sort_by_dependencies(const QContainer<StartupModule>& modules)
+      -> QContainer<StartupModule> {
+    QContainer<ModulePtr> order;
+    QHash<const Module*, StartupModule> startup;
+    for (const auto& m : modules) {
+      order.push_back(m.module);
+      startup.insert(m.module.get(), m);
+    }
+
+    QContainer<StartupModule> sorted;
+    for (const auto& module : SortModulesByDependencies(order)) {
+      sorted.push_back(startup.value(module.get()));
+    }
+    return sorted;
+  }
+
+  void load_modules_concurrently(QContainer<StartupModule>& modules) {
+    std::mutex lock;
+    std::condition_variable done;
+    auto pending = modules.size();
+
+    auto runner = Thread::TaskRunnerGetter::GetInstance().GetTaskRunner(
+        Thread::TaskRunnerGetter::kTaskRunnerType_Default);
+    for (auto& m : modules) {
+      runner->PostTask(new Thread::Task(
+          [&, p_m = &m](const GpgFrontend::DataObjectPtr&) -> int {
+            try {
+              load_module(*p_m);
+            } catch (const std::exception& e) {
+              LOG_W() << "module manager failed to load module: " << p_m->path
+                      << ", reason: " << e.what();
+              p_m->module = nullptr;
+            }
+
+            std::lock_guard guard(lock);
+            if (--pending == 0) done.notify_all();
+            return 0;
+          },
+          "load_module_library", nullptr));
+    }
+
+    std::unique_lock guard(lock);
+    done.wait(guard, [&]() { return pending == 0; });
+  }
+
+  /**
+   * @brief reset the settings of a new or changed module and activate the
+   * module if it should be
+   *
+   * @param module
+   * @param integrated_module
+   * @return false if the activation failed
+   */
+  auto activate_if_needed(const ModulePtr& module, bool integrated_module)
+      -> bool {
+    const auto module_id = module->GetModuleIdentifier();
+    const auto module_hash = module->GetModuleHash();
+
+    SettingsObject so(QString("module.%1.so").arg(module_id));
+    ModuleSO module_so(so);
+
+    // reset module settings if necessary
+    if (module_so.module_id != module_id ||
+        module_so.module_hash != module_hash) {
+      module_so.module_id = module_id;
+      module_so.module_hash = module_hash;
+      // auto active integrated module by default
+      module_so.auto_activate = integrated_module;
+      module_so.set_by_user = false;
+
+      so.Store(module_so.ToJson());
+    }
+
+    // if this module need auto active, as late as possible
+    if (!module_so.auto_activate) return true;
+    if (gmc_->ActivateModuleOnDemand(module_id)) return true;
+    return gmc_->ActiveModule(module_id);
+  }
+
+  /**
+   * @brief publish how long each module took to start up at
+   * core.module.startup.<module id>.<step>_ms, with the dots of the module
+   * id replaced by underscores
+   *
+   * @param modules
+   * @param total_ms
+   * @param parallel
+   */
+  void publish_startup_timing(const QContainer<StartupModule>& modules,
+                              qint64 total_ms, bool parallel) {
+    for (const auto& m : modules) {
+      const auto module_id = RTKeySegment(m.module->GetModuleIdentifier());
+      const auto prefix = QString("module.startup.%1.").arg(module_id);
+      grt_->PublishKV("core", prefix + "load_ms", m.load_ms);
+      grt_->PublishKV("core", prefix + "validate_ms", m.validate_ms);
+      grt_->PublishKV("core", prefix + "register_ms", m.register_ms);
+      grt_->PublishKV("core", prefix + "activate_ms", m.activate_ms);
+    }
+
+    grt_->PublishKV("core", "module.startup.total_ms", total_ms);
+    grt_->PublishKV("core", "module.startup.parallel", parallel);
+    grt_->PublishKV("core", "module.startup.loaded",
+                    static_cast<int>(modules.size()));
+
+    LOG_I() << "modules started up:" << modules.size() << "in" << total_ms
+            << "ms, parallel loading:" << parallel;
+  }
 };
 
 auto IsModuleActivate(ModuleIdentifier id) -> bool {
@@ -259,6 +475,43 @@ auto UpsertRTValue(const QString& namespace_, const QString& key,
                                                     std::any(value));
 }
 
+auto RTKeySegment(QString name) -> QString { return name.replace('.', '_'); }
+
+auto SortModulesByDependencies(const QContainer<ModulePtr>& modules)
+    -> QContainer<ModulePtr> {
+  QSet<QString> pending;
+  for (const auto& m : modules) pending.insert(m->GetModuleIdentifier());
+
+  QContainer<ModulePtr> sorted;
+  QContainer<ModulePtr> rest = modules;
+  while (!rest.isEmpty()) {
+    QContainer<ModulePtr> blocked;
+    for (const auto& m : rest) {
+      const auto dependencies = ModuleDependencies(m);
+      const auto ready = std::none_of(
+          dependencies.cbegin(), dependencies.cend(),
+          [&](const QString& id) { return pending.contains(id); });
+      if (ready) {
+        pending.remove(m->GetModuleIdentifier());
+        sorted.push_back(m);
+      } else {
+        blocked.push_back(m);
+      }
+    }
+
+    if (blocked.size() == rest.size()) {
+      for (const auto& m : blocked) {
+        LOG_W() << "module: " << m->GetModuleIdentifier()
+                << "is part of a dependency cycle, registering it anyway";
+        sorted.push_back(m);
+      }
+      break;
+    }
+    rest = blocked;
+  }
+  return sorted;
+}
+
 auto ListenRTPublishEvent(QObject* o, Namespace n, Key k, LPCallback c)
     -> bool {
   return ModuleManager::GetInstance().ListenRTPublish(
@@ -280,6 +533,10 @@ auto ModuleManager::LoadModule(QString path, bool integrated) -> bool {
   return p_->LoadAndRegisterModule(path, integrated);
 }
 
+auto ModuleManager::LoadModules(const QMap<QString, bool>& modules) -> int {
+  return p_->LoadAndRegisterModules(modules);
+}
+
 auto ModuleManager::SearchModule(ModuleIdentifier id) -> ModulePtr {
   return p_->SearchModule(id);
 }
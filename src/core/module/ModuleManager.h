@@ -65,6 +65,17 @@ class GF_CORE_EXPORT ModuleManager
 
   auto LoadModule(QString, bool) -> bool;
 
+  /**
+   * @brief load module libraries (path -> integrated) side by side, or one
+   * by one with module/parallel_loading off, then register and activate
+   * them in dependency order (see SortModulesByDependencies()) on the
+   * calling thread, which must be the module runner. The time each module
+   * took is published at core.module.startup.
+   *
+   * @return int the number of modules loaded
+   */
+  auto LoadModules(const QMap<QString, bool>&) -> int;
+
   auto SearchModule(ModuleIdentifier) -> ModulePtr;
 
   void SetNeedRegisterModulesNum(int);
@@ -159,6 +170,27 @@ auto GF_CORE_EXPORT IsModuleExists(ModuleIdentifier) -> bool;
 auto GF_CORE_EXPORT UpsertRTValue(const QString& namespace_, const QString& key,
                                   const std::any& value) -> bool;
 
+/**
+ * @brief make a name usable as one segment of a key, the register table
+ * splits keys at dots
+ *
+ * @param name
+ * @return QString
+ */
+auto GF_CORE_EXPORT RTKeySegment(QString name) -> QString;
+
+/**
+ * @brief order the modules so that each comes after the modules of the same
+ * batch listed in its "Dependencies" meta data (comma separated), otherwise
+ * the order is kept. Dependencies outside the batch are ignored, modules in
+ * a dependency cycle are put at the end in their original order.
+ *
+ * @param modules
+ * @return QContainer<ModulePtr>
+ */
+auto GF_CORE_EXPORT SortModulesByDependencies(
+    const QContainer<ModulePtr>& modules) -> QContainer<ModulePtr>;
+
 /**
  * @brief
  *
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "core/thread/CancellationToken.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace GpgFrontend::Thread {
+
+struct CancellationToken::State {
+  std::atomic<bool> canceled{false};
+  std::mutex lock;
+  std::map<quint64, std::function<void()>> callbacks;
+  quint64 next_id = 1;
+};
+
+CancellationToken::CancellationToken() : state_(std::make_shared<State>()) {}
+
+CancellationToken::CancellationToken(std::shared_ptr<State> state)
+    : state_(std::move(state)) {}
+
+void CancellationToken::Cancel() {
+  if (state_ == nullptr) return;
+
+  std::lock_guard<std::mutex> lock(state_->lock);
+  if (state_->canceled.exchange(true, std::memory_order_acq_rel)) return;
+
+  for (auto& [id, fn] : state_->callbacks) fn();
+  state_->callbacks.clear();
+}
+
+auto CancellationToken::IsCanceled() const -> bool {
+  return state_ != nullptr && state_->canceled.load(std::memory_order_acquire);
+}
+
+auto CancellationToken::Current() -> CancellationToken {
+  return CancellationToken(current_state());
+}
+
+auto CancellationToken::current_state() -> std::shared_ptr<State>& {
+  thread_local std::shared_ptr<State> state;
+  return state;
+}
+
+CancellationToken::Scope::Scope(const CancellationToken& token)
+    : previous_(std::exchange(current_state(), token.state_)) {}
+
+CancellationToken::Scope::~Scope() { current_state() = std::move(previous_); }
+
+CancelCallback::CancelCallback(const CancellationToken& token,
+                               std::function<void()> fn)
+    : state_(token.state_) {
+  if (state_ == nullptr || !fn) return;
+
+  std::lock_guard<std::mutex> lock(state_->lock);
+  if (state_->canceled.load(std::memory_order_acquire)) {
+    fn();
+    return;
+  }
+
+  id_ = state_->next_id++;
+  state_->callbacks.emplace(id_, std::move(fn));
+}
+
+CancelCallback::~CancelCallback() {
+  if (state_ == nullptr || id_ == 0) return;
+
+  // blocks while Cancel() is running the callbacks
+  std::lock_guard<std::mutex> lock(state_->lock);
+  state_->callbacks.erase(id_);
+}
+
+}  // namespace GpgFrontend::Thread
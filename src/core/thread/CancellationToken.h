@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#pragma once
+
+#include "core/GpgFrontendCore.h"
+
+namespace GpgFrontend::Thread {
+
+class Task;
+
+/**
+ * @brief a flag shared by a task and whoever may cancel it
+ *
+ * Runnables check it through CancellationToken::Current() and stop early
+ * once it is set, blocking calls can be interrupted by registering a
+ * CancelCallback. Copies share the same flag.
+ *
+ */
+class GF_CORE_EXPORT CancellationToken {
+ public:
+  /**
+   * @brief Construct a new Cancellation Token object, not canceled
+   *
+   */
+  CancellationToken();
+
+  /**
+   * @brief set the flag and run the registered callbacks, only the first
+   * call has an effect
+   *
+   */
+  void Cancel();
+
+  /**
+   * @brief
+   *
+   * @return true
+   * @return false
+   */
+  [[nodiscard]] auto IsCanceled() const -> bool;
+
+  /**
+   * @brief Get the token of the task running on the calling thread. Outside
+   * of a task the returned token can never be canceled.
+   *
+   * @return CancellationToken
+   */
+  static auto Current() -> CancellationToken;
+
+ private:
+  friend class Task;
+  friend class CancelCallback;
+
+  struct State;
+  std::shared_ptr<State> state_;
+
+  explicit CancellationToken(std::shared_ptr<State> state);
+
+  /**
+   * @brief the state of the token current on the calling thread
+   *
+   */
+  static auto current_state() -> std::shared_ptr<State>&;
+
+  /**
+   * @brief make the token current on this thread for the scope's lifetime
+   *
+   */
+  class Scope {
+   public:
+    explicit Scope(const CancellationToken& token);
+
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+
+    auto operator=(const Scope&) -> Scope& = delete;
+
+   private:
+    std::shared_ptr<State> previous_;
+  };
+};
+
+/**
+ * @brief runs a function when the token gets canceled while the object is
+ * alive, or at once if it is canceled already. The destructor waits for a
+ * running call, so the function may use resources that only live as long as
+ * this object. It's called under a lock and must return quickly.
+ *
+ */
+class GF_CORE_EXPORT CancelCallback {
+ public:
+  CancelCallback(const CancellationToken& token, std::function<void()> fn);
+
+  ~CancelCallback();
+
+  CancelCallback(const CancelCallback&) = delete;
+
+  auto operator=(const CancelCallback&) -> CancelCallback& = delete;
+
+ private:
+  std::shared_ptr<CancellationToken::State> state_;
+  quint64 id_ = 0;
+};
+
+}  // namespace GpgFrontend::Thread
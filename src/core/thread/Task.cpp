@@ -30,6 +30,9 @@
 
 #include <qscopedpointer.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "utils/MemoryUtils.h"
 
 namespace GpgFrontend::Thread {
@@ -114,7 +117,147 @@ class Task::Impl {
    */
   [[nodiscard]] auto GetRTN() const { return this->rtn_; }
 
+  /**
+   * @brief move a pending task to dispatched, fails if it was canceled or
+   * is dispatched already
+   *
+   * @return true
+   * @return false
+   */
+  auto Dispatch() -> bool {
+    auto expected = kState_Pending;
+    return state_.compare_exchange_strong(expected, kState_Dispatched);
+  }
+
+  /**
+   * @brief move a dispatched task to running, fails if it was canceled
+   *
+   * @return true
+   * @return false
+   */
+  auto Claim() -> bool {
+    auto expected = kState_Dispatched;
+    return state_.compare_exchange_strong(expected, kState_Running);
+  }
+
+  /**
+   * @brief a task holding on its life cycle may be started again
+   *
+   */
+  void Reset() {
+    state_.store(parent_->autoDelete() ? kState_Done : kState_Pending);
+  }
+
+  /**
+   * @brief cancel the token, and drop the task if it's not started yet
+   *
+   * @return true if the task was dropped and no job will see it, the
+   * caller ends the task then
+   */
+  auto Cancel() -> bool {
+    token_.Cancel();
+    auto expected = kState_Pending;
+    if (state_.compare_exchange_strong(expected, kState_Done)) {
+      MarkCanceled();
+      return true;
+    }
+
+    // a job already dispatched finds the task canceled and ends it, the
+    // task may be gone once the state is stored
+    expected = kState_Dispatched;
+    state_.compare_exchange_strong(expected, kState_Done);
+    return false;
+  }
+
+  void Retain() {
+    std::lock_guard lock(hold_lock_);
+    holds_++;
+  }
+
+  /**
+   * @brief drop a hold
+   *
+   * @return true if the task was ended meanwhile and should go now
+   */
+  auto Release() -> bool {
+    std::lock_guard lock(hold_lock_);
+    return --holds_ == 0 && end_requested_;
+  }
+
+  /**
+   * @brief the task ended
+   *
+   * @return true if it can be deleted now, otherwise the last hold does
+   */
+  auto RequestEnd() -> bool {
+    std::lock_guard lock(hold_lock_);
+    end_requested_ = true;
+    return holds_ == 0;
+  }
+
+  [[nodiscard]] auto GetToken() const -> const CancellationToken& {
+    return token_;
+  }
+
+  void AttachMetrics(TaskMetrics::RunnerStats *runner_stats) {
+    runner_stats_ = runner_stats;
+    stats_ = runner_stats_->Task(name_);
+  }
+
+  void MarkQueued() {
+    if (runner_stats_ == nullptr) return;
+    // whoever takes the timestamp back takes the task off the queued count
+    queued_at_.store(TaskMetrics::Now());
+    runner_stats_->queued++;
+  }
+
+  void MarkStarted() {
+    if (runner_stats_ == nullptr) return;
+    started_at_ = TaskMetrics::Now();
+    const auto queued_at = queued_at_.exchange(0);
+    if (queued_at != 0) {
+      runner_stats_->queued--;
+      stats_->wait.Record(started_at_ - queued_at);
+    }
+    runner_stats_->running++;
+  }
+
+  void MarkReturned(bool failed) {
+    if (runner_stats_ == nullptr) return;
+    const auto now = TaskMetrics::Now();
+    runner_stats_->running--;
+    (failed ? runner_stats_->failed : runner_stats_->completed)++;
+    stats_->run.Record(now - started_at_);
+    TaskMetrics::GetInstance().Trace(name_, runner_stats_->name, started_at_,
+                                     now);
+    returned_at_.store(now);
+  }
+
+  void MarkUnqueued() {
+    if (runner_stats_ == nullptr) return;
+    if (queued_at_.exchange(0) != 0) runner_stats_->queued--;
+  }
+
+  void MarkCanceled() {
+    if (runner_stats_ == nullptr) return;
+    MarkUnqueued();
+    runner_stats_->canceled++;
+  }
+
+  void SetPriority(Priority priority) { priority_.store(priority); }
+
+  [[nodiscard]] auto GetPriority() const -> Priority {
+    return priority_.load();
+  }
+
  private:
+  enum State {
+    kState_Pending,
+    kState_Dispatched,
+    kState_Running,
+    kState_Done,
+  };
+
   Task *const parent_;
   const QString uuid_;
   const QString name_;
@@ -123,6 +266,33 @@ class Task::Impl {
   int rtn_ = Task::kInitialRTN;          ///<
   QThread *callback_thread_ = nullptr;   ///<
   DataObjectPtr data_object_ = nullptr;  ///<
+  CancellationToken token_;              ///<
+  std::atomic<State> state_{kState_Pending};
+  std::atomic<Priority> priority_{kPriority_Normal};
+  TaskMetrics::RunnerStats *runner_stats_ = nullptr;
+  TaskMetrics::TaskStats *stats_ = nullptr;
+  std::atomic<qint64> queued_at_{0};
+  qint64 started_at_ = 0;
+  std::atomic<qint64> returned_at_{0};
+  std::mutex hold_lock_;
+  int holds_ = 0;
+  bool end_requested_ = false;
+
+  /**
+   * @brief runs in the callback thread once the callback returned
+   *
+   * @param begin_us when the callback was called
+   */
+  void mark_callback_done(qint64 begin_us) {
+    if (runner_stats_ == nullptr) return;
+    const auto now = TaskMetrics::Now();
+    stats_->callback.Record(now - returned_at_.load());
+
+    auto &metrics = TaskMetrics::GetInstance();
+    if (metrics.IsTracing()) {
+      metrics.Trace(name_ + "/callback", runner_stats_->name, begin_us, now);
+    }
+  }
 
   void init() {
     //
@@ -139,6 +309,7 @@ class Task::Impl {
             [this](int rtn) {
               // set task returning code
               SetRTN(rtn);
+              const auto callback_begin = TaskMetrics::Now();
 
 #ifdef NDEBUG
               try {
@@ -155,13 +326,17 @@ class Task::Impl {
               }
 #endif
 
+              mark_callback_done(callback_begin);
+
               LOG_D() << "task" << this->name_
                       << "sending task end signal, rtn:" << rtn;
               emit parent_->SignalTaskEnd();
             });
 
     //
-    connect(parent_, &Task::SignalTaskEnd, parent_, &Task::deleteLater);
+    connect(parent_, &Task::SignalTaskEnd, parent_, [this]() {
+      if (RequestEnd()) parent_->deleteLater();
+    });
   }
 
   /**
@@ -200,7 +375,17 @@ void Task::HoldOnLifeCycle(bool hold_on) { p_->HoldOnLifeCycle(hold_on); }
 
 void Task::setRTN(int rtn) { p_->SetRTN(rtn); }
 
-void Task::SafelyRun() { emit SignalRun(); }
+void Task::SafelyRun() {
+  p_->MarkQueued();
+
+  // canceled before, the canceler ended it, or dispatched already
+  if (!p_->Dispatch()) {
+    p_->MarkUnqueued();
+    return;
+  }
+
+  emit SignalRun();
+}
 
 int Task::Run() { return p_->Run(); }
 
@@ -213,7 +398,8 @@ void Task::TaskHandler::Start() {
 }
 
 void Task::TaskHandler::Cancel() {
-  if (task_ != nullptr) emit task_->SignalTaskEnd();
+  // only a task no job will ever see is ended here
+  if (task_ != nullptr && task_->p_->Cancel()) emit task_->SignalTaskEnd();
 }
 
 auto Task::TaskHandler::GetTask() -> Task * {
@@ -222,18 +408,64 @@ auto Task::TaskHandler::GetTask() -> Task * {
 }
 
 void Task::slot_exception_safe_run() noexcept {
+  // canceled after it was dispatched, the canceler left the end of the
+  // task to this job
+  if (!p_->Claim()) {
+    p_->MarkCanceled();
+    if (this->autoDelete()) emit this->SignalTaskEnd();
+    return;
+  }
+
+  p_->MarkStarted();
+
   auto rtn = p_->GetRTN();
+  bool failed = false;
   try {
+    const CancellationToken::Scope scope(p_->GetToken());
+
     // Run() will set rtn by itself
     rtn = this->Run();
 
   } catch (...) {
     LOG_W() << "exception was caught at task: {}" << GetFullID();
+    failed = true;
   }
+  p_->MarkReturned(failed || rtn != 0);
+  p_->Reset();
 
   // raise signal to anounce after runnable returned
   if (this->autoDelete()) emit this->SignalTaskShouldEnd(rtn);
 }
 
 auto Task::GetRTN() -> int { return p_->GetRTN(); }
+
+void Task::SetPriority(Priority priority) { p_->SetPriority(priority); }
+
+auto Task::GetPriority() const -> Priority { return p_->GetPriority(); }
+
+auto Task::GetCancellationToken() const -> CancellationToken {
+  return p_->GetToken();
+}
+
+void Task::attach_metrics(TaskMetrics::RunnerStats *stats) {
+  if (stats != nullptr) p_->AttachMetrics(stats);
+}
+
+void Task::dispatch_by(std::function<void(QPointer<Task>)> dispatcher) {
+  disconnect(this, &Task::SignalRun, this, &Task::slot_exception_safe_run);
+  connect(
+      this, &Task::SignalRun, this,
+      [this, dispatcher = std::move(dispatcher)]() {
+        dispatcher(QPointer<Task>(this));
+      },
+      Qt::DirectConnection);
+}
+
+auto Task::hold() -> std::shared_ptr<Task> {
+  p_->Retain();
+  return {this, [](Task *task) {
+            // deleteLater() may be called from any thread
+            if (task->p_->Release()) task->deleteLater();
+          }};
+}
 }  // namespace GpgFrontend::Thread
\ No newline at end of file
@@ -31,6 +31,8 @@
 #include "core/GpgFrontendCore.h"
 #include "core/function/SecureMemoryAllocator.h"
 #include "core/model/DataObject.h"
+#include "core/thread/CancellationToken.h"
+#include "core/thread/TaskMetrics.h"
 
 namespace GpgFrontend::Thread {
 
@@ -45,12 +47,29 @@ class GF_CORE_EXPORT Task : public QObject, public QRunnable {
   using TaskCallback = std::function<void(int, DataObjectPtr)>;  ///<
   static const int kInitialRTN = -99;
 
+  /**
+   * @brief the queues of a runner are served in this order, interactive
+   * work jumps ahead of bulk jobs waiting on the same runner
+   *
+   */
+  enum Priority {
+    kPriority_Interactive = 0,
+    kPriority_Normal,
+    kPriority_Bulk,
+  };
+  static const int kPriorityCount = 3;
+
   class TaskHandler {
    public:
     explicit TaskHandler(Task*);
 
     void Start();
 
+    /**
+     * @brief a task not started yet is dropped, a running one has its
+     * cancellation token set and is expected to return early
+     *
+     */
     void Cancel();
 
     auto GetTask() -> Task*;
@@ -122,6 +141,28 @@ class GF_CORE_EXPORT Task : public QObject, public QRunnable {
    */
   [[nodiscard]] auto GetRTN() -> int;
 
+  /**
+   * @brief Set the Priority object, takes effect when the task is started
+   *
+   * @param priority
+   */
+  void SetPriority(Priority priority);
+
+  /**
+   * @brief Get the Priority object
+   *
+   * @return Priority
+   */
+  [[nodiscard]] auto GetPriority() const -> Priority;
+
+  /**
+   * @brief the token seen as CancellationToken::Current() while the task
+   * runs
+   *
+   * @return CancellationToken
+   */
+  [[nodiscard]] auto GetCancellationToken() const -> CancellationToken;
+
  public slots:
 
   /**
@@ -171,5 +212,30 @@ class GF_CORE_EXPORT Task : public QObject, public QRunnable {
   SecureUniquePtr<Impl> p_;
 
   void run() override;
+
+  /**
+   * @brief hand the task to the dispatcher when it is started, instead of
+   * running it in the thread it lives in. The dispatcher decides where and
+   * when slot_exception_safe_run() is called.
+   *
+   * @param dispatcher
+   */
+  void dispatch_by(std::function<void(QPointer<Task>)> dispatcher);
+
+  /**
+   * @brief keep the task alive for a job running it on another thread.
+   * while a hold exists, the end of the task only marks it for deletion,
+   * the last hold dropped deletes it.
+   *
+   * @return std::shared_ptr<Task>
+   */
+  auto hold() -> std::shared_ptr<Task>;
+
+  /**
+   * @brief record the life of the task into the stats of a runner
+   *
+   * @param stats
+   */
+  void attach_metrics(TaskMetrics::RunnerStats* stats);
 };
 }  // namespace GpgFrontend::Thread
@@ -0,0 +1,340 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "core/thread/TaskMetrics.h"
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+
+#include "core/function/GlobalSettingStation.h"
+#include "core/module/ModuleManager.h"
+#include "core/thread/TaskRunnerGetter.h"
+#include "core/utils/IOUtils.h"
+
+namespace GpgFrontend::Thread {
+
+namespace {
+
+// tasks named after user input must not grow the maps without limit
+constexpr size_t kMaxTaskNames = 256;
+constexpr size_t kMaxTraceEvents = 100000;
+
+}  // namespace
+
+void LatencyHistogram::Record(qint64 us) {
+  buckets_[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto LatencyHistogram::Percentile(double p) const -> qint64 {
+  quint64 total = 0;
+  std::array<quint64, kBuckets> counts;
+  for (int i = 0; i < kBuckets; i++) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) return 0;
+
+  const auto rank = std::max<quint64>(
+      static_cast<quint64>(std::ceil(std::clamp(p, 0.0, 1.0) * total)), 1);
+
+  quint64 seen = 0;
+  for (int i = 0; i < kBuckets; i++) {
+    seen += counts[i];
+    if (seen >= rank) return upper_bound_of(i);
+  }
+  return upper_bound_of(kBuckets - 1);
+}
+
+auto LatencyHistogram::Count() const -> quint64 {
+  return count_.load(std::memory_order_relaxed);
+}
+
+auto LatencyHistogram::bucket_of(qint64 us) -> int {
+  if (us < kExactBuckets) return static_cast<int>(std::max<qint64>(us, 0));
+
+  const int octave =
+      63 - static_cast<int>(qCountLeadingZeroBits(static_cast<quint64>(us)));
+  if (octave > kMaxOctave) return kBuckets - 1;
+
+  // the three bits below the leading one pick the sub bucket
+  const auto sub = static_cast<int>((us >> (octave - 3)) & (kSubBuckets - 1));
+  return kExactBuckets + (octave - 4) * kSubBuckets + sub;
+}
+
+auto LatencyHistogram::upper_bound_of(int bucket) -> qint64 {
+  if (bucket < kExactBuckets) return bucket;
+
+  const auto octave = 4 + (bucket - kExactBuckets) / kSubBuckets;
+  const auto sub = (bucket - kExactBuckets) % kSubBuckets;
+  return ((static_cast<qint64>(kSubBuckets + sub + 1)) << (octave - 3)) - 1;
+}
+
+TaskMetrics::RunnerStats::RunnerStats(QString name) : name(std::move(name)) {}
+
+auto TaskMetrics::RunnerStats::Task(const QString& task_name) -> TaskStats* {
+  std::lock_guard<std::mutex> lock(lock_);
+
+  auto it = tasks_.find(task_name);
+  if (it != tasks_.end()) return it->second.get();
+
+  const auto key =
+      tasks_.size() < kMaxTaskNames ? task_name : QString("<others>");
+  auto& stats = tasks_[key];
+  if (stats == nullptr) stats = std::make_unique<TaskStats>();
+  return stats.get();
+}
+
+auto TaskMetrics::RunnerStats::Snapshot() const -> QJsonObject {
+  QJsonObject tasks;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    for (const auto& [task_name, stats] : tasks_) {
+      QJsonObject task;
+      task["count"] = static_cast<qint64>(stats->run.Count());
+      task["wait_p50_us"] = stats->wait.Percentile(0.5);
+      task["wait_p99_us"] = stats->wait.Percentile(0.99);
+      task["run_p50_us"] = stats->run.Percentile(0.5);
+      task["run_p99_us"] = stats->run.Percentile(0.99);
+      task["callback_p50_us"] = stats->callback.Percentile(0.5);
+      task["callback_p99_us"] = stats->callback.Percentile(0.99);
+      tasks[task_name] = task;
+    }
+  }
+
+  QJsonObject snapshot;
+  snapshot["queued"] = queued.load();
+  snapshot["running"] = running.load();
+  snapshot["completed"] = static_cast<qint64>(completed.load());
+  snapshot["failed"] = static_cast<qint64>(failed.load());
+  snapshot["canceled"] = static_cast<qint64>(canceled.load());
+  snapshot["tasks"] = tasks;
+  return snapshot;
+}
+
+class TaskMetrics::Impl {
+ public:
+  auto Runner(const QString& name) -> RunnerStats* {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto& stats = runners_[name];
+    if (stats == nullptr) stats = std::make_unique<RunnerStats>(name);
+    return stats.get();
+  }
+
+  [[nodiscard]] auto Snapshot() const -> QJsonObject {
+    QJsonObject snapshot;
+    std::lock_guard<std::mutex> lock(lock_);
+    for (const auto& [name, stats] : runners_) {
+      snapshot[name] = stats->Snapshot();
+    }
+    return snapshot;
+  }
+
+  void SetTracing(bool enabled) {
+    tracing_.store(enabled, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto IsTracing() const -> bool {
+    return tracing_.load(std::memory_order_relaxed);
+  }
+
+  void Trace(const QString& name, const QString& category, qint64 begin_us,
+             qint64 end_us) {
+    if (!IsTracing()) return;
+
+    const auto tid = thread_index();
+    std::lock_guard<std::mutex> lock(trace_lock_);
+    if (!thread_names_.contains(tid)) {
+      auto thread_name = QThread::currentThread()->objectName();
+      if (thread_name.isEmpty()) thread_name = QString("thread-%1").arg(tid);
+      thread_names_.insert(tid, thread_name);
+    }
+
+    if (events_.size() >= kMaxTraceEvents) events_.pop_front();
+    events_.push_back({name, category, tid, begin_us, end_us - begin_us});
+  }
+
+  [[nodiscard]] auto ExportChromeTrace() const -> QByteArray {
+    const auto pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    std::lock_guard<std::mutex> lock(trace_lock_);
+    for (auto it = thread_names_.cbegin(); it != thread_names_.cend(); ++it) {
+      events.append(QJsonObject{{"name", "thread_name"},
+                                {"ph", "M"},
+                                {"pid", pid},
+                                {"tid", it.key()},
+                                {"args", QJsonObject{{"name", it.value()}}}});
+    }
+
+    for (const auto& event : events_) {
+      events.append(QJsonObject{{"name", event.name},
+                                {"cat", event.category},
+                                {"ph", "X"},
+                                {"ts", event.ts},
+                                {"dur", event.dur},
+                                {"pid", pid},
+                                {"tid", event.tid}});
+    }
+
+    return QJsonDocument(QJsonObject{{"traceEvents", events},
+                                     {"displayTimeUnit", "ms"}})
+        .toJson(QJsonDocument::Compact);
+  }
+
+  void Publish() const {
+    const auto snapshot = Snapshot();
+    for (auto it = snapshot.constBegin(); it != snapshot.constEnd(); ++it) {
+      const auto runner = Module::RTKeySegment(it.key());
+      Module::UpsertRTValue(
+          "core", QString("thread.metrics.%1").arg(runner),
+          QString::fromUtf8(QJsonDocument(it.value().toObject())
+                                .toJson(QJsonDocument::Compact)));
+    }
+  }
+
+ private:
+  struct TraceEvent {
+    QString name;
+    QString category;
+    int tid;
+    qint64 ts;
+    qint64 dur;
+  };
+
+  mutable std::mutex lock_;
+  std::map<QString, std::unique_ptr<RunnerStats>> runners_;
+  std::atomic<bool> tracing_{false};
+  mutable std::mutex trace_lock_;
+  std::deque<TraceEvent> events_;
+  QHash<int, QString> thread_names_;
+  std::atomic<int> next_thread_index_{1};
+
+  auto thread_index() -> int {
+    thread_local int index = 0;
+    if (index == 0) index = next_thread_index_.fetch_add(1);
+    return index;
+  }
+};
+
+TaskMetrics::TaskMetrics() : p_(SecureCreateUniqueObject<Impl>()) {}
+
+TaskMetrics::~TaskMetrics() = default;
+
+auto TaskMetrics::GetInstance() -> TaskMetrics& {
+  static TaskMetrics instance;
+  return instance;
+}
+
+auto TaskMetrics::Runner(const QString& name) -> RunnerStats* {
+  return p_->Runner(name);
+}
+
+auto TaskMetrics::Snapshot() const -> QJsonObject { return p_->Snapshot(); }
+
+auto TaskMetrics::Now() -> qint64 {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void TaskMetrics::SetTracing(bool enabled) { p_->SetTracing(enabled); }
+
+auto TaskMetrics::IsTracing() const -> bool { return p_->IsTracing(); }
+
+void TaskMetrics::Trace(const QString& name, const QString& category,
+                        qint64 begin_us, qint64 end_us) {
+  p_->Trace(name, category, begin_us, end_us);
+}
+
+auto TaskMetrics::ExportChromeTrace() const -> QByteArray {
+  return p_->ExportChromeTrace();
+}
+
+void TaskMetrics::Publish() { p_->Publish(); }
+
+void TaskMetrics::StartPublishing() {
+  static std::once_flag once;
+  std::call_once(once, [this]() {
+    auto settings = GetSettings();
+    SetTracing(settings.value("thread/trace", false).toBool());
+    const auto interval = settings.value("thread/metrics_interval", 5).toInt();
+
+    auto runner = TaskRunnerGetter::GetInstance().GetTaskRunner(
+        TaskRunnerGetter::kTaskRunnerType_IO);
+
+    Module::ListenRTPublishEvent(
+        QCoreApplication::instance(), "core", "thread.trace.export",
+        [this, runner](const Module::Namespace&, const Module::Key&, int,
+                       const std::any& value) {
+          if (value.type() != typeid(QString)) return;
+
+          // anyone may publish to the table, so the value only names a
+          // file in the trace directory
+          const auto name = std::any_cast<QString>(value);
+          if (name.isEmpty() || name == "." || name == ".." ||
+              name.contains('/') || name.contains('\\') ||
+              name.contains(':')) {
+            LOG_W() << "rejected task trace file name:" << name;
+            return;
+          }
+
+          runner->PostTask(new Task(
+              [this, name](const DataObjectPtr&) -> int {
+                const auto dir =
+                    GlobalSettingStation::GetInstance().GetAppDataPath() +
+                    "/traces";
+                const auto path = dir + "/" + name;
+                if (!QDir().mkpath(dir) ||
+                    !WriteFile(path, ExportChromeTrace())) {
+                  LOG_W() << "cannot write task trace to:" << path;
+                  return -1;
+                }
+                LOG_I() << "task trace written to:" << path;
+                return 0;
+              },
+              "task_trace_export"));
+        });
+
+    if (interval <= 0) return;
+
+    TaskScheduler::Options options;
+    options.period = std::chrono::seconds(interval);
+    options.coalesce_key = "thread/metrics";
+    runner->PostScheduleTask(
+        "task_metrics_publish",
+        [this](const DataObjectPtr&) -> int {
+          Publish();
+          return 0;
+        },
+        options);
+  });
+}
+
+}  // namespace GpgFrontend::Thread
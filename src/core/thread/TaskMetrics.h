@@ -0,0 +1,226 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "core/GpgFrontendCore.h"
+#include "core/function/SecureMemoryAllocator.h"
+
+namespace GpgFrontend::Thread {
+
+/**
+ * @brief a lock-free histogram of durations in microseconds
+ *
+ * Values below 16 us are counted exactly, larger ones in 8 buckets per power
+ * of two, so a percentile is off by at most 12.5%.
+ *
+ */
+class GF_CORE_EXPORT LatencyHistogram {
+ public:
+  /**
+   * @brief
+   *
+   * @param us
+   */
+  void Record(qint64 us);
+
+  /**
+   * @brief Get the upper bound of the bucket the percentile falls in
+   *
+   * @param p in [0, 1]
+   * @return qint64 microseconds, 0 if nothing was recorded
+   */
+  [[nodiscard]] auto Percentile(double p) const -> qint64;
+
+  /**
+   * @brief Get the number of recorded values
+   *
+   * @return quint64
+   */
+  [[nodiscard]] auto Count() const -> quint64;
+
+ private:
+  static constexpr int kExactBuckets = 16;
+  static constexpr int kSubBuckets = 8;
+  static constexpr int kMaxOctave = 40;
+  static constexpr int kBuckets =
+      kExactBuckets + (kMaxOctave - 3) * kSubBuckets;
+
+  std::array<std::atomic<quint64>, kBuckets> buckets_{};
+  std::atomic<quint64> count_{0};
+
+  static auto bucket_of(qint64 us) -> int;
+
+  static auto upper_bound_of(int bucket) -> qint64;
+};
+
+/**
+ * @brief counters, latency histograms and an optional trace of the tasks
+ * run by the task runners
+ *
+ * A snapshot of every runner is published to the global register table as
+ * a json string at "core" / "thread.metrics.<runner>". Publishing a file
+ * name at "core" / "thread.trace.export" writes the trace collected so far
+ * to that file in the "traces" directory of the app data path, in the
+ * Chrome trace event format that Perfetto reads as well. Other locations
+ * take ExportChromeTrace().
+ *
+ */
+class GF_CORE_EXPORT TaskMetrics {
+ public:
+  struct TaskStats {
+    LatencyHistogram wait;      ///< from posted to started
+    LatencyHistogram run;       ///< the runnable itself
+    LatencyHistogram callback;  ///< from returned to callback finished
+  };
+
+  struct RunnerStats {
+    const QString name;
+    std::atomic<qint64> queued{0};  ///< posted, not started yet
+    std::atomic<qint64> running{0};
+    std::atomic<quint64> completed{0};
+    std::atomic<quint64> failed{0};  ///< threw, or returned non-zero
+    std::atomic<quint64> canceled{0};
+
+    explicit RunnerStats(QString name);
+
+    /**
+     * @brief Get the stats of the tasks with this name, tasks past the limit
+     * of names share one entry
+     *
+     * @param task_name
+     * @return TaskStats* never freed before exit
+     */
+    auto Task(const QString& task_name) -> TaskStats*;
+
+    /**
+     * @brief
+     *
+     * @return QJsonObject
+     */
+    [[nodiscard]] auto Snapshot() const -> QJsonObject;
+
+   private:
+    mutable std::mutex lock_;
+    std::map<QString, std::unique_ptr<TaskStats>> tasks_;
+  };
+
+  /**
+   * @brief Get the process wide instance
+   *
+   * @return TaskMetrics&
+   */
+  static auto GetInstance() -> TaskMetrics&;
+
+  /**
+   * @brief Get the stats of a runner, created on first use
+   *
+   * @param name
+   * @return RunnerStats* never freed before exit
+   */
+  auto Runner(const QString& name) -> RunnerStats*;
+
+  /**
+   * @brief Get a snapshot of all runners, keyed by runner name
+   *
+   * @return QJsonObject
+   */
+  [[nodiscard]] auto Snapshot() const -> QJsonObject;
+
+  /**
+   * @brief microseconds on a monotonic clock, the time base of the metrics
+   * and the trace
+   *
+   * @return qint64
+   */
+  static auto Now() -> qint64;
+
+  /**
+   * @brief start or stop collecting trace events, the latest events are
+   * kept up to a fixed limit
+   *
+   * @param enabled
+   */
+  void SetTracing(bool enabled);
+
+  /**
+   * @brief
+   *
+   * @return true
+   * @return false
+   */
+  [[nodiscard]] auto IsTracing() const -> bool;
+
+  /**
+   * @brief add a complete event on the calling thread, if tracing
+   *
+   * @param name
+   * @param category
+   * @param begin_us
+   * @param end_us
+   */
+  void Trace(const QString& name, const QString& category, qint64 begin_us,
+             qint64 end_us);
+
+  /**
+   * @brief Get the collected events as Chrome trace event json
+   *
+   * @return QByteArray
+   */
+  [[nodiscard]] auto ExportChromeTrace() const -> QByteArray;
+
+  /**
+   * @brief publish the snapshots to the global register table every
+   * "thread/metrics_interval" seconds, and serve trace export requests.
+   * Tracing starts right away if "thread/trace" is set.
+   *
+   */
+  void StartPublishing();
+
+  /**
+   * @brief publish the snapshots to the global register table now
+   *
+   */
+  void Publish();
+
+ private:
+  class Impl;
+  SecureUniquePtr<Impl> p_;
+
+  TaskMetrics();
+
+  ~TaskMetrics();
+};
+
+}  // namespace GpgFrontend::Thread
@@ -28,13 +28,30 @@
 
 #include "core/thread/TaskRunner.h"
 
+#include <array>
+#include <deque>
+#include <mutex>
+#include <set>
+
 #include "core/thread/Task.h"
+#include "core/thread/TaskRunnerGetter.h"
+#include "core/thread/WorkStealingExecutor.h"
 
 namespace GpgFrontend::Thread {
 
 class TaskRunner::Impl : public QThread {
  public:
-  Impl() : QThread(nullptr) {}
+  Impl(int workers, const QString& name)
+      : QThread(nullptr),
+        queue_context_(SecureCreateUniqueObject<QObject>()),
+        stats_(TaskMetrics::GetInstance().Runner(name)) {
+    setObjectName(name);
+    queue_context_->moveToThread(this);
+
+    if (workers > 0) {
+      executor_ = SecureCreateUniqueObject<WorkStealingExecutor>(name, workers);
+    }
+  }
 
   void PostTask(Task* task) {
     if (task == nullptr) {
@@ -42,9 +59,7 @@ class TaskRunner::Impl : public QThread {
       return;
     }
 
-    task->setParent(nullptr);
-    task->moveToThread(this);
-
+    bind(task);
     task->SafelyRun();
   }
 
@@ -52,8 +67,7 @@ class TaskRunner::Impl : public QThread {
                     const Task::TaskCallback& cb, DataObjectPtr params)
       -> Task::TaskHandler {
     auto* raw_task = new Task(runnable, name, std::move(params), cb);
-    raw_task->setParent(nullptr);
-    raw_task->moveToThread(this);
+    bind(raw_task);
 
     const auto full_id = raw_task->GetFullID();
 
@@ -80,10 +94,17 @@ class TaskRunner::Impl : public QThread {
       return;
     }
 
+    // the workers are already concurrent, no need for a thread of its own
+    if (executor_ != nullptr && task->autoDelete()) {
+      PostTask(task);
+      return;
+    }
+
     auto* concurrent_thread = new QThread(this);
 
     task->setParent(nullptr);
     task->moveToThread(concurrent_thread);
+    task->attach_metrics(stats_);
 
     connect(task, &Task::SignalTaskEnd, concurrent_thread, &QThread::quit);
     connect(concurrent_thread, &QThread::finished, concurrent_thread,
@@ -95,15 +116,181 @@ class TaskRunner::Impl : public QThread {
   }
 
   void PostScheduleTask(Task* task, size_t seconds) {
-    if (task == nullptr) return;
-    // TODO
+    if (task == nullptr) {
+      FLOG_W("task posted is null");
+      return;
+    }
+
+    // bind here, a task can only be moved by the thread it lives in
+    bind(task);
+
+    // the scheduler thread can't tell whether a QPointer is still valid,
+    // the job holds the task instead
+    TaskScheduler::Options options;
+    options.delay = std::chrono::seconds(seconds);
+    schedule([task = task->hold()]() { task->SafelyRun(); }, options);
+  }
+
+  auto PostScheduleTask(const QString& name, const Task::TaskRunnable& runnable,
+                        const TaskScheduler::Options& options)
+      -> TaskScheduler::TimerID {
+    auto running = std::make_shared<std::atomic<bool>>(false);
+
+    return schedule(
+        [=]() {
+          if (running->exchange(true)) {
+            LOG_D() << "scheduled task" << name
+                    << "is still running, skip this run";
+            return;
+          }
+
+          PostTask(new Task(
+              [=](const DataObjectPtr& data_object) -> int {
+                const RunningGuard guard{running};
+                return runnable(data_object);
+              },
+              name));
+        },
+        options);
+  }
+
+  auto CancelScheduleTask(TaskScheduler::TimerID id) -> bool {
+    {
+      // the timers are all cancelled already once the runner stopped
+      std::lock_guard<std::mutex> lock(timers_lock_);
+      if (timers_.erase(id) == 0) return false;
+    }
+    return scheduler().Cancel(id);
+  }
+
+  auto IsScheduled(TaskScheduler::TimerID id) -> bool {
+    std::lock_guard<std::mutex> lock(timers_lock_);
+    return timers_.find(id) != timers_.end();
   }
 
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(timers_lock_);
+      for (auto id : timers_) scheduler().Cancel(id);
+      timers_.clear();
+    }
+
+    if (executor_ != nullptr) executor_->Shutdown();
+    quit();
+    wait();
+  }
+
+  auto GetExecutor() -> WorkStealingExecutor* { return executor_.get(); }
+
  private:
   QMap<QString, Task*> pending_tasks_;
+  SecureUniquePtr<WorkStealingExecutor> executor_;
+  std::set<TaskScheduler::TimerID> timers_;
+  std::mutex timers_lock_;
+  SecureUniquePtr<QObject> queue_context_;
+  std::array<std::deque<QPointer<Task>>, Task::kPriorityCount> queue_;
+  std::mutex queue_lock_;
+  TaskMetrics::RunnerStats* stats_;
+
+  struct RunningGuard {
+    std::shared_ptr<std::atomic<bool>> running;
+
+    ~RunningGuard() { running->store(false); }
+  };
+
+  static auto scheduler() -> TaskScheduler& {
+    return TaskRunnerGetter::GetInstance().GetScheduler();
+  }
+
+  /**
+   * @brief schedule a job and keep its id until it's cancelled, a job
+   * running once drops its id when it fires
+   *
+   * @param job
+   * @param options
+   * @return TaskScheduler::TimerID
+   */
+  auto schedule(TaskScheduler::Job job, const TaskScheduler::Options& options)
+      -> TaskScheduler::TimerID {
+    auto self = std::make_shared<TaskScheduler::TimerID>(
+        TaskScheduler::kInvalidTimerID);
+    if (options.period.count() <= 0) {
+      auto once = [this, self, job = std::move(job)]() {
+        {
+          std::lock_guard<std::mutex> lock(timers_lock_);
+          timers_.erase(*self);
+        }
+        job();
+      };
+      job = std::move(once);
+    }
+
+    // held while scheduling, a job due at once waits here for its id. a job
+    // merged into a pending one is dropped, the pending one drops the id.
+    std::lock_guard<std::mutex> lock(timers_lock_);
+    const auto id = scheduler().Schedule(std::move(job), options);
+    if (id == TaskScheduler::kInvalidTimerID) return id;
+    *self = id;
+    timers_.insert(id);
+    return id;
+  }
+
+  /**
+   * @brief let the runner thread own the task, the task itself runs on the
+   * executor if there is one, otherwise it waits in the queue of its
+   * priority
+   *
+   */
+  void bind(Task* task) {
+    task->setParent(nullptr);
+    task->moveToThread(this);
+    task->attach_metrics(stats_);
+
+    // a task holding on its life cycle needs the event loop of its thread
+    if (executor_ != nullptr && task->autoDelete()) {
+      // the task lives in the runner thread and may end there at any time,
+      // the job holds it until the worker is done with it
+      task->dispatch_by([executor = executor_.get()](QPointer<Task> started) {
+        const auto priority = started->GetPriority();
+        executor->Submit(
+            [task = started->hold()]() { task->slot_exception_safe_run(); },
+            priority);
+      });
+      return;
+    }
+
+    task->dispatch_by([this](QPointer<Task> started) { enqueue(started); });
+  }
+
+  void enqueue(const QPointer<Task>& task) {
+    {
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      queue_[task->GetPriority()].push_back(task);
+    }
+
+    // one run for each queued task, in the order of the priorities
+    QMetaObject::invokeMethod(
+        queue_context_.get(), [this]() { run_next(); }, Qt::QueuedConnection);
+  }
+
+  void run_next() {
+    QPointer<Task> task;
+    {
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      for (auto& tasks : queue_) {
+        if (tasks.empty()) continue;
+        task = tasks.front();
+        tasks.pop_front();
+        break;
+      }
+    }
+
+    if (task != nullptr) task->slot_exception_safe_run();
+  }
 };
 
-TaskRunner::TaskRunner() : p_(SecureCreateUniqueObject<Impl>()) {}
+TaskRunner::TaskRunner(int workers, const QString& name)
+    : p_(SecureCreateUniqueObject<Impl>(workers, name)) {}
 
 TaskRunner::~TaskRunner() {
   if (p_->isRunning()) {
@@ -126,15 +313,31 @@ void TaskRunner::PostScheduleTask(Task* task, size_t seconds) {
   p_->PostScheduleTask(task, seconds);
 }
 
-void TaskRunner::Start() { p_->start(); }
+auto TaskRunner::PostScheduleTask(const QString& name,
+                                  const Task::TaskRunnable& runnable,
+                                  const TaskScheduler::Options& options)
+    -> TaskScheduler::TimerID {
+  return p_->PostScheduleTask(name, runnable, options);
+}
 
-void TaskRunner::Stop() {
-  p_->quit();
-  p_->wait();
+auto TaskRunner::CancelScheduleTask(TaskScheduler::TimerID id) -> bool {
+  return p_->CancelScheduleTask(id);
 }
 
+auto TaskRunner::IsScheduled(TaskScheduler::TimerID id) -> bool {
+  return p_->IsScheduled(id);
+}
+
+void TaskRunner::Start() { p_->start(); }
+
+void TaskRunner::Stop() { p_->Stop(); }
+
 auto TaskRunner::GetThread() -> QThread* { return p_.get(); }
 
+auto TaskRunner::GetExecutor() -> WorkStealingExecutor* {
+  return p_->GetExecutor();
+}
+
 auto TaskRunner::IsRunning() -> bool { return p_->isRunning(); }
 
 auto TaskRunner::RegisterTask(const QString& name,
@@ -31,17 +31,28 @@
 #include "core/GpgFrontendCore.h"
 #include "core/function/SecureMemoryAllocator.h"
 #include "core/thread/Task.h"
+#include "core/thread/TaskScheduler.h"
 
 namespace GpgFrontend::Thread {
 
+class WorkStealingExecutor;
+
 class GF_CORE_EXPORT TaskRunner : public QObject {
   Q_OBJECT
  public:
   /**
    * @brief Construct a new Task Runner object
    *
+   * With workers > 0 the tasks run on a work-stealing executor of that many
+   * threads, except those holding on their life cycle, which need the event
+   * loop of the runner thread. Otherwise every task runs on the runner
+   * thread, one after another.
+   *
+   * @param workers
+   * @param name names the worker threads, runners of the same name share
+   * their metrics
    */
-  TaskRunner();
+  explicit TaskRunner(int workers = 0, const QString& name = "task_runner");
 
   /**
    * @brief Destroy the Task Runner object
@@ -68,6 +79,14 @@ class GF_CORE_EXPORT TaskRunner : public QObject {
    */
   auto GetThread() -> QThread*;
 
+  /**
+   * @brief Get the executor of the runner, nullptr if the tasks run on the
+   * runner thread
+   *
+   * @return WorkStealingExecutor*
+   */
+  auto GetExecutor() -> WorkStealingExecutor*;
+
   /**
    * @brief
    *
@@ -109,13 +128,45 @@ class GF_CORE_EXPORT TaskRunner : public QObject {
   void PostConcurrentTask(Task* task);
 
   /**
-   * @brief
+   * @brief run the task on this runner once, after a delay
    *
    * @param task
    * @param seconds
    */
   void PostScheduleTask(Task* task, size_t seconds);
 
+  /**
+   * @brief post a task built from the runnable to this runner on a
+   * schedule, see TaskScheduler::Schedule()
+   *
+   * A periodic run is skipped while the previous one is still running.
+   *
+   * @param name
+   * @param runnable
+   * @param options
+   * @return TaskScheduler::TimerID
+   */
+  auto PostScheduleTask(const QString& name, const Task::TaskRunnable& runnable,
+                        const TaskScheduler::Options& options)
+      -> TaskScheduler::TimerID;
+
+  /**
+   * @brief cancel a task scheduled on this runner
+   *
+   * @param id
+   * @return true if the task was still scheduled
+   */
+  auto CancelScheduleTask(TaskScheduler::TimerID id) -> bool;
+
+  /**
+   * @brief whether a task scheduled on this runner will still run
+   *
+   * @param id
+   * @return true
+   * @return false
+   */
+  auto IsScheduled(TaskScheduler::TimerID id) -> bool;
+
  private:
   class Impl;
   SecureUniquePtr<Impl> p_;
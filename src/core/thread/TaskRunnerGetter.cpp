@@ -31,29 +31,94 @@
 #include <mutex>
 
 #include "core/GpgConstants.h"
+#include "core/function/GlobalSettingStation.h"
 #include "core/thread/TaskRunner.h"
 
 namespace GpgFrontend::Thread {
 
+namespace {
+
+auto RunnerTypeKey(TaskRunnerGetter::TaskRunnerType runner_type) -> QString {
+  switch (runner_type) {
+    case TaskRunnerGetter::kTaskRunnerType_Default:
+      return "default";
+    case TaskRunnerGetter::kTaskRunnerType_GPG:
+      return "gpg";
+    case TaskRunnerGetter::kTaskRunnerType_IO:
+      return "io";
+    case TaskRunnerGetter::kTaskRunnerType_Network:
+      return "network";
+    case TaskRunnerGetter::kTaskRunnerType_Module:
+      return "module";
+    case TaskRunnerGetter::kTaskRunnerType_External_Process:
+      return "external_process";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
 TaskRunnerGetter::TaskRunnerGetter(int)
     : SingletonFunctionObject<TaskRunnerGetter>(kGpgFrontendDefaultChannel) {}
 
 auto TaskRunnerGetter::GetTaskRunner(TaskRunnerType runner_type)
     -> TaskRunnerPtr {
+  return GetTaskRunner(runner_type, 0);
+}
+
+auto TaskRunnerGetter::GetTaskRunner(TaskRunnerType runner_type, int index)
+    -> TaskRunnerPtr {
   std::lock_guard<std::mutex> lock_guard(task_runners_map_lock_);
   while (true) {
-    auto it = task_runners_.find(runner_type);
+    auto it = task_runners_.find({runner_type, index});
     if (it != task_runners_.end()) {
       return it->second;
     }
 
-    auto runner = GpgFrontend::SecureCreateSharedObject<TaskRunner>();
-    task_runners_[runner_type] = runner;
+    // the parallel gpg runners serve one gpgme context each
+    auto name = RunnerTypeKey(runner_type);
+    if (index > 0) name += QString("_%1").arg(index);
+    auto runner = GpgFrontend::SecureCreateSharedObject<TaskRunner>(
+        index == 0 ? GetWorkerCount(runner_type) : 0, name);
+    task_runners_[{runner_type, index}] = runner;
     runner->Start();
   }
 }
 
+auto TaskRunnerGetter::GetWorkerCount(TaskRunnerType runner_type) -> int {
+  const auto cores = std::max(QThread::idealThreadCount(), 1);
+
+  int workers = 0;
+  switch (runner_type) {
+    case kTaskRunnerType_Default:
+      workers = cores;
+      break;
+    case kTaskRunnerType_IO:
+    case kTaskRunnerType_Network:
+    case kTaskRunnerType_External_Process:
+      workers = std::min(cores, 4);
+      break;
+    // gpgme contexts and the module tables expect one task at a time
+    case kTaskRunnerType_GPG:
+    case kTaskRunnerType_Module:
+      break;
+  }
+
+  const auto key = QString("thread/workers/%1").arg(RunnerTypeKey(runner_type));
+  return std::clamp(GetSettings().value(key, workers).toInt(), 0,
+                    kTaskRunnerMaxWorkers);
+}
+
+auto TaskRunnerGetter::GetScheduler() -> TaskScheduler& {
+  std::call_once(scheduler_once_, [this]() {
+    scheduler_ = SecureCreateUniqueObject<TaskScheduler>();
+  });
+  return *scheduler_;
+}
+
 void TaskRunnerGetter::StopAllTeakRunner() {
+  if (scheduler_ != nullptr) scheduler_->Stop();
+
   for (const auto& [key, value] : task_runners_) {
     if (value->IsRunning()) {
       value->Stop();
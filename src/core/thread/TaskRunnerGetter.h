@@ -53,14 +53,53 @@ class GF_CORE_EXPORT TaskRunnerGetter
   explicit TaskRunnerGetter(
       int channel = SingletonFunctionObject::GetDefaultChannel());
 
+  /**
+   * @brief Get the runner of a runner type
+   *
+   * Default, IO, Network and External Process runners run their tasks on a
+   * work-stealing executor; GPG and Module runners keep a single thread.
+   * The number of workers can be set in "thread/workers/<type>", 0 means a
+   * single thread.
+   *
+   * @param runner_type
+   * @return TaskRunnerPtr
+   */
   auto GetTaskRunner(TaskRunnerType runner_type = kTaskRunnerType_Default)
       -> TaskRunnerPtr;
 
+  /**
+   * @brief Get one of the parallel runners of a runner type, index 0 is
+   * the runner returned by GetTaskRunner(runner_type). Its metrics are
+   * named after the type, with the index appended from 1 on, e.g. "gpg_1".
+   *
+   * @param runner_type
+   * @param index
+   * @return TaskRunnerPtr
+   */
+  auto GetTaskRunner(TaskRunnerType runner_type, int index) -> TaskRunnerPtr;
+
   void StopAllTeakRunner();
 
+  /**
+   * @brief Get the scheduler used for delayed and periodic tasks
+   *
+   * @return TaskScheduler&
+   */
+  auto GetScheduler() -> TaskScheduler&;
+
+  /**
+   * @brief Get the number of executor workers of a runner type
+   *
+   * @param runner_type
+   * @return int
+   */
+  static auto GetWorkerCount(TaskRunnerType runner_type) -> int;
+
  private:
-  std::map<TaskRunnerType, TaskRunnerPtr> task_runners_;
+  std::map<std::pair<TaskRunnerType, int>, TaskRunnerPtr> task_runners_;
   std::mutex task_runners_map_lock_;
+  SecureUniquePtr<TaskScheduler> scheduler_;
+  std::once_flag scheduler_once_;
 };
 
 }  // namespace GpgFrontend::Thread
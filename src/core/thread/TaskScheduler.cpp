@@ -0,0 +1,244 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "core/thread/TaskScheduler.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace GpgFrontend::Thread {
+
+class TaskScheduler::Impl : public QThread {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  Impl() : QThread(nullptr) {
+    setObjectName("task_scheduler");
+    start();
+    ready_.acquire();
+  }
+
+  ~Impl() override { Stop(); }
+
+  auto Schedule(Job job, const Options& options) -> TimerID {
+    if (!job) return kInvalidTimerID;
+
+    std::lock_guard<std::mutex> lock(lock_);
+    if (stopped_) return kInvalidTimerID;
+
+    const auto due =
+        Clock::now() + std::max(options.delay, std::chrono::milliseconds(0));
+
+    if (!options.coalesce_key.isEmpty()) {
+      auto it = keys_.find(options.coalesce_key);
+      if (it != keys_.end()) {
+        // merge into the pending job, moving it forward if needed
+        auto& entry = entries_.at(it->second);
+        if (due < entry.due) {
+          entry.due = due;
+          push(due, it->second);
+        }
+        return it->second;
+      }
+    }
+
+    const auto id = next_id_++;
+    entries_.emplace(
+        id, Entry{std::move(job), due,
+                  std::max(options.period, std::chrono::milliseconds(0)),
+                  options.coalesce_key});
+    if (!options.coalesce_key.isEmpty()) keys_[options.coalesce_key] = id;
+    push(due, id);
+    return id;
+  }
+
+  auto Cancel(TimerID id) -> bool {
+    std::lock_guard<std::mutex> lock(lock_);
+    return erase(id);
+  }
+
+  [[nodiscard]] auto IsScheduled(TimerID id) const -> bool {
+    std::lock_guard<std::mutex> lock(lock_);
+    return entries_.find(id) != entries_.end();
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      if (stopped_) return;
+      stopped_ = true;
+      entries_.clear();
+      keys_.clear();
+      heap_.clear();
+    }
+
+    quit();
+    if (QThread::currentThread() != this) wait();
+  }
+
+ protected:
+  void run() override {
+    QTimer timer;
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&timer, &QTimer::timeout, [this]() { fire(); });
+
+    timer_ = &timer;
+    ready_.release();
+    exec();
+  }
+
+ private:
+  struct Entry {
+    Job job;
+    Clock::time_point due;
+    std::chrono::milliseconds period;
+    QString coalesce_key;
+  };
+
+  struct HeapItem {
+    Clock::time_point due;
+    TimerID id;
+
+    auto operator>(const HeapItem& o) const -> bool { return due > o.due; }
+  };
+
+  mutable std::mutex lock_;
+  std::unordered_map<TimerID, Entry> entries_;
+  QHash<QString, TimerID> keys_;
+  std::vector<HeapItem> heap_;  ///< may hold stale items, see fire()
+  TimerID next_id_ = kInvalidTimerID + 1;
+  bool stopped_ = false;
+  QSemaphore ready_;
+  QTimer* timer_ = nullptr;
+
+  /**
+   * @brief add an item to the heap, re-arming the timer if it became the
+   * earliest one
+   *
+   */
+  void push(Clock::time_point due, TimerID id) {
+    heap_.push_back({due, id});
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+
+    if (heap_.front().id == id) {
+      QMetaObject::invokeMethod(timer_, [this]() { rearm(); },
+                                Qt::QueuedConnection);
+    }
+  }
+
+  auto erase(TimerID id) -> bool {
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return false;
+
+    const auto& key = it->second.coalesce_key;
+    if (!key.isEmpty()) keys_.remove(key);
+    entries_.erase(it);
+    return true;
+  }
+
+  void rearm() {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (heap_.empty()) {
+      timer_->stop();
+      return;
+    }
+
+    // far away jobs are waited for in steps the timer can hold
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+        heap_.front().due - Clock::now());
+    timer_->start(std::clamp<std::chrono::milliseconds>(
+        wait, std::chrono::milliseconds(0), std::chrono::hours(1)));
+  }
+
+  void fire() {
+    std::vector<Job> jobs;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      const auto now = Clock::now();
+
+      while (!heap_.empty() && heap_.front().due <= now) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<>());
+        const auto item = heap_.back();
+        heap_.pop_back();
+
+        // cancelled or moved forward since the item was pushed
+        auto it = entries_.find(item.id);
+        if (it == entries_.end() || it->second.due != item.due) continue;
+
+        auto& entry = it->second;
+        if (entry.period.count() == 0) {
+          jobs.push_back(std::move(entry.job));
+          erase(item.id);
+          continue;
+        }
+
+        // runs missed while falling behind are merged into this one
+        jobs.push_back(entry.job);
+        entry.due += entry.period;
+        if (entry.due <= now) entry.due = now + entry.period;
+        heap_.push_back({entry.due, item.id});
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+      }
+    }
+
+    for (const auto& job : jobs) {
+#ifdef NDEBUG
+      try {
+        job();
+      } catch (...) {
+        FLOG_W("exception was caught at scheduled job");
+      }
+#else
+      job();
+#endif
+    }
+
+    rearm();
+  }
+};
+
+TaskScheduler::TaskScheduler() : p_(SecureCreateUniqueObject<Impl>()) {}
+
+TaskScheduler::~TaskScheduler() = default;
+
+auto TaskScheduler::Schedule(Job job, const Options& options) -> TimerID {
+  return p_->Schedule(std::move(job), options);
+}
+
+auto TaskScheduler::Cancel(TimerID id) -> bool { return p_->Cancel(id); }
+
+auto TaskScheduler::IsScheduled(TimerID id) const -> bool {
+  return p_->IsScheduled(id);
+}
+
+void TaskScheduler::Stop() { p_->Stop(); }
+
+}  // namespace GpgFrontend::Thread
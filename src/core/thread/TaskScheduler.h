@@ -0,0 +1,114 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include "core/GpgFrontendCore.h"
+#include "core/function/SecureMemoryAllocator.h"
+
+namespace GpgFrontend::Thread {
+
+/**
+ * @brief runs jobs after a delay or periodically, on a thread of its own
+ *
+ * The pending jobs are kept in a min-heap ordered by due time, and a single
+ * timer is armed for the earliest of them. Jobs run on the scheduler
+ * thread, so they should be short; most of them just post a task to a
+ * runner.
+ *
+ */
+class GF_CORE_EXPORT TaskScheduler {
+ public:
+  using Job = std::function<void()>;
+  using TimerID = quint64;
+
+  static constexpr TimerID kInvalidTimerID = 0;
+
+  struct Options {
+    std::chrono::milliseconds delay{0};   ///< until the first run
+    std::chrono::milliseconds period{0};  ///< between runs, 0 runs once
+    /// jobs scheduled with the same non-empty key while one is pending are
+    /// merged into the pending one, which keeps the earlier due time
+    QString coalesce_key;
+  };
+
+  /**
+   * @brief Construct a new Task Scheduler object
+   *
+   */
+  TaskScheduler();
+
+  /**
+   * @brief Destroy the Task Scheduler object
+   *
+   */
+  ~TaskScheduler();
+
+  /**
+   * @brief schedule a job
+   *
+   * A periodic job that falls behind doesn't catch up, the runs it missed
+   * are merged into one.
+   *
+   * @param job
+   * @param options
+   * @return TimerID the job scheduled, or the pending one it was merged into
+   */
+  auto Schedule(Job job, const Options& options) -> TimerID;
+
+  /**
+   * @brief cancel a job, a run already started isn't interrupted
+   *
+   * @param id
+   * @return true if the job was still scheduled
+   */
+  auto Cancel(TimerID id) -> bool;
+
+  /**
+   * @brief whether a job will still run
+   *
+   * @param id
+   * @return true
+   * @return false
+   */
+  [[nodiscard]] auto IsScheduled(TimerID id) const -> bool;
+
+  /**
+   * @brief drop all pending jobs and stop the thread
+   *
+   */
+  void Stop();
+
+ private:
+  class Impl;
+  SecureUniquePtr<Impl> p_;
+};
+
+}  // namespace GpgFrontend::Thread
@@ -0,0 +1,252 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "core/thread/WorkStealingExecutor.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace GpgFrontend::Thread {
+
+class WorkStealingExecutor::Impl {
+ public:
+  Impl(const QString& name, int workers) {
+    const auto n = std::max(workers, 1);
+    for (int i = 0; i < n; i++) {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+
+    for (int i = 0; i < n; i++) {
+      auto* thread = QThread::create([this, i]() { work(i); });
+      thread->setObjectName(QString("%1-worker-%2").arg(name).arg(i));
+      workers_[i]->thread = thread;
+      thread->start();
+    }
+  }
+
+  ~Impl() { Shutdown(); }
+
+  void Submit(Job job, int priority) {
+    // a worker keeps what it spawns, others are spread round-robin
+    auto index = (current_executor == this)
+                     ? current_worker
+                     : next_.fetch_add(1, std::memory_order_relaxed) %
+                           workers_.size();
+    const auto level = std::clamp(priority, 0, kPriorityClasses - 1);
+    bool accepted;
+    {
+      // checked and queued under the idle lock, so a job is either counted
+      // before the workers may exit or refused. a worker still draining
+      // during shutdown may queue the jobs its job spawns.
+      std::lock_guard<std::mutex> idle_lock(idle_lock_);
+      accepted = !stopping_.load(std::memory_order_acquire) ||
+                 IsWorkerThread();
+      if (accepted) {
+        auto& worker = *workers_[index];
+        std::lock_guard<std::mutex> lock(worker.lock);
+        worker.jobs[level].push_back(std::move(job));
+        pending_.fetch_add(1, std::memory_order_release);
+      }
+    }
+
+    // the refused job is released on return, not under the lock
+    if (!accepted) {
+      FLOG_W("job submitted to a stopped executor, dropped");
+      return;
+    }
+
+    idle_cv_.notify_one();
+  }
+
+  void Shutdown() {
+    if (IsWorkerThread()) {
+      FLOG_W("executor can't be shut down from its own worker");
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(idle_lock_);
+      if (stopping_.exchange(true)) return;
+    }
+    idle_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+      worker->thread->wait();
+      delete worker->thread;
+      worker->thread = nullptr;
+    }
+  }
+
+  [[nodiscard]] auto WorkerCount() const -> int {
+    return static_cast<int>(workers_.size());
+  }
+
+  [[nodiscard]] auto StolenJobs() const -> quint64 {
+    return stolen_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] auto IsWorkerThread() const -> bool {
+    return current_executor == this;
+  }
+
+ private:
+  struct Worker {
+    std::mutex lock;
+    std::array<std::deque<Job>, kPriorityClasses> jobs;
+    QThread* thread = nullptr;
+  };
+
+  static thread_local const Impl* current_executor;
+  static thread_local size_t current_worker;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_{0};
+  std::atomic<qint64> pending_{0};
+  std::atomic<quint64> stolen_{0};
+  std::atomic<bool> stopping_{false};
+  std::mutex idle_lock_;
+  std::condition_variable idle_cv_;
+
+  auto pop_local(size_t index, int level, Job& job) -> bool {
+    auto& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.lock);
+    auto& jobs = worker.jobs[level];
+    if (jobs.empty()) return false;
+    job = std::move(jobs.back());
+    jobs.pop_back();
+    return true;
+  }
+
+  auto steal(size_t index, int level, Job& job) -> bool {
+    const auto n = workers_.size();
+    for (size_t i = 1; i < n; i++) {
+      auto& victim = *workers_[(index + i) % n];
+      std::lock_guard<std::mutex> lock(victim.lock);
+      auto& jobs = victim.jobs[level];
+      if (jobs.empty()) continue;
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      stolen_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief the most urgent job this worker can get, its own or stolen
+   *
+   */
+  auto take(size_t index, Job& job) -> bool {
+    for (int level = 0; level < kPriorityClasses; level++) {
+      if (pop_local(index, level, job) || steal(index, level, job)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(size_t index) {
+    current_executor = this;
+    current_worker = index;
+
+    for (;;) {
+      Job job;
+      if (take(index, job)) {
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+        run(job);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(idle_lock_);
+      idle_cv_.wait(lock, [this]() {
+        return stopping_.load(std::memory_order_acquire) ||
+               pending_.load(std::memory_order_acquire) > 0;
+      });
+
+      // queued jobs are still run during shutdown
+      if (stopping_.load(std::memory_order_acquire) &&
+          pending_.load(std::memory_order_acquire) == 0) {
+        break;
+      }
+    }
+
+    current_executor = nullptr;
+  }
+
+  static void run(const Job& job) {
+#ifdef NDEBUG
+    try {
+      job();
+    } catch (...) {
+      FLOG_W("exception was caught at executor job");
+    }
+#else
+    job();
+#endif
+
+    // workers have no event loop, deliver what the job posted to objects
+    // living here, deferred deletes included
+    QCoreApplication::sendPostedEvents();
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+  }
+};
+
+thread_local const WorkStealingExecutor::Impl*
+    WorkStealingExecutor::Impl::current_executor = nullptr;
+
+thread_local size_t WorkStealingExecutor::Impl::current_worker = 0;
+
+WorkStealingExecutor::WorkStealingExecutor(const QString& name, int workers)
+    : p_(SecureCreateUniqueObject<Impl>(name, workers)) {}
+
+WorkStealingExecutor::~WorkStealingExecutor() = default;
+
+void WorkStealingExecutor::Submit(Job job, int priority) {
+  p_->Submit(std::move(job), priority);
+}
+
+void WorkStealingExecutor::Shutdown() { p_->Shutdown(); }
+
+auto WorkStealingExecutor::WorkerCount() const -> int {
+  return p_->WorkerCount();
+}
+
+auto WorkStealingExecutor::StolenJobs() const -> quint64 {
+  return p_->StolenJobs();
+}
+
+auto WorkStealingExecutor::IsWorkerThread() const -> bool {
+  return p_->IsWorkerThread();
+}
+
+}  // namespace GpgFrontend::Thread
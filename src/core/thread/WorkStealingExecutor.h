@@ -0,0 +1,109 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#pragma once
+
+#include "core/GpgFrontendCore.h"
+#include "core/function/SecureMemoryAllocator.h"
+
+namespace GpgFrontend::Thread {
+
+/**
+ * @brief a fixed pool of worker threads, each with its own deque of jobs
+ *
+ * A worker runs the newest job of its own deque first and, once that is
+ * empty, steals the oldest job of another worker. Jobs submitted from a
+ * worker go to its own deque, jobs submitted from any other thread are
+ * spread over the workers round-robin. Each deque is split into priority
+ * classes, a job of a more urgent class is always taken first, whether it's
+ * popped or stolen.
+ *
+ */
+class GF_CORE_EXPORT WorkStealingExecutor {
+ public:
+  using Job = std::function<void()>;
+  static const int kPriorityClasses = 3;
+
+  /**
+   * @brief Construct a new Work Stealing Executor object
+   *
+   * @param name used to name the worker threads
+   * @param workers number of worker threads, at least one
+   */
+  WorkStealingExecutor(const QString& name, int workers);
+
+  /**
+   * @brief Destroy the Work Stealing Executor object, see Shutdown()
+   *
+   */
+  ~WorkStealingExecutor();
+
+  /**
+   * @brief queue a job, it is dropped if the executor is shut down
+   *
+   * @param job
+   * @param priority 0 is the most urgent class, clamped to the classes there
+   * are
+   */
+  void Submit(Job job, int priority = 0);
+
+  /**
+   * @brief run the jobs still queued and join the workers
+   *
+   */
+  void Shutdown();
+
+  /**
+   * @brief Get the number of worker threads
+   *
+   * @return int
+   */
+  [[nodiscard]] auto WorkerCount() const -> int;
+
+  /**
+   * @brief Get the number of jobs run by a worker other than the one they
+   * were queued to
+   *
+   * @return quint64
+   */
+  [[nodiscard]] auto StolenJobs() const -> quint64;
+
+  /**
+   * @brief whether the calling thread is one of the workers
+   *
+   * @return true
+   * @return false
+   */
+  [[nodiscard]] auto IsWorkerThread() const -> bool;
+
+ private:
+  class Impl;
+  SecureUniquePtr<Impl> p_;
+};
+
+}  // namespace GpgFrontend::Thread
@@ -45,6 +45,19 @@ using BypeArrayConstRef = const ByteArray&;  ///<
 using StringArgsPtr = QStringList;           ///<
 using StringArgsRef = QStringList&;          ///<
 
+/**
+ * @brief pull at most size bytes from a source, returns the bytes read,
+ * 0 at the end of the stream or -1 on error
+ *
+ */
+using GFStreamReader = std::function<ssize_t(std::byte*, size_t)>;
+
+/**
+ * @brief push size bytes to a sink, returns the bytes written or -1 on error
+ *
+ */
+using GFStreamWriter = std::function<ssize_t(const std::byte*, size_t)>;
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
 #define QCS2QSL(vec) (QStringList(vec.begin(), vec.end()))
 #else
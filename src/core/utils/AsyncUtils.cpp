@@ -28,17 +28,49 @@
 
 #include "AsyncUtils.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+#include "core/GpgConstants.h"
+#include "core/function/gpg/GpgContext.h"
 #include "core/model/DataObject.h"
 #include "core/module/ModuleManager.h"
 #include "core/thread/Task.h"
 #include "core/thread/TaskRunnerGetter.h"
 #include "core/utils/GpgUtils.h"
 
+namespace {
+
+// gpg operations posted to each parallel gpg runner and not destroyed yet
+std::array<std::atomic_int, GpgFrontend::kGpgContextPoolMaxSize>
+    gpg_runner_loads;
+
+/**
+ * @brief pick the least loaded gpg runner, there is one runner for each
+ * pooled context of the channel.
+ *
+ */
+auto PickGpgTaskRunnerIndex(int channel) -> int {
+  const auto size = std::clamp(
+      GpgFrontend::GpgContext::GetInstance(channel).ContextPoolSize(), 1,
+      GpgFrontend::kGpgContextPoolMaxSize);
+
+  int index = 0;
+  for (int i = 1; i < size; i++) {
+    if (gpg_runner_loads[i] < gpg_runner_loads[index]) index = i;
+  }
+  return index;
+}
+
+}  // namespace
+
 namespace GpgFrontend {
 
 auto RunGpgOperaAsync(int channel, const GpgOperaRunnable& runnable,
                       const GpgOperationCallback& callback,
-                      const QString& operation, const QString& minimal_version)
+                      const QString& operation, const QString& minimal_version,
+                      Thread::Task::Priority priority)
     -> Thread::Task::TaskHandler {
   if (!CheckGpgVersion(channel, minimal_version)) {
     LOG_W() << "operation: " << operation << "is not supported.";
@@ -46,14 +78,35 @@ auto RunGpgOperaAsync(int channel, const GpgOperaRunnable& runnable,
     return Thread::Task::TaskHandler(nullptr);
   }
 
+  const auto runner_index = PickGpgTaskRunnerIndex(channel);
+
   auto handler =
       Thread::TaskRunnerGetter::GetInstance()
-          .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_GPG)
+          .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_GPG,
+                         runner_index)
           ->RegisterTask(
               operation,
               [=](const DataObjectPtr& data_object) -> int {
+                // run on a context pair of its own, so that operations on
+                // other gpg runners don't share gpgme state with it
+                GpgContext::ContextLease const lease(
+                    &GpgContext::GetInstance(channel));
+
+                // canceling the task aborts the gpgme operation in progress
+                // on the leased pair
+                auto& ctx = GpgContext::GetInstance(channel);
+                auto* binary_ctx = ctx.BinaryContext();
+                auto* default_ctx = ctx.DefaultContext();
+                auto token = Thread::CancellationToken::Current();
+                Thread::CancelCallback const cancel(token, [=]() {
+                  gpgme_cancel_async(binary_ctx);
+                  gpgme_cancel_async(default_ctx);
+                });
+
                 auto custom_data_object = TransferParams();
-                auto err = runnable(custom_data_object);
+                auto err = token.IsCanceled()
+                               ? GpgError(GPG_ERR_CANCELED)
+                               : runnable(custom_data_object);
                 data_object->Swap({err, custom_data_object});
                 return 0;
               },
@@ -67,6 +120,13 @@ auto RunGpgOperaAsync(int channel, const GpgOperaRunnable& runnable,
                 }
               },
               TransferParams());
+
+  handler.GetTask()->SetPriority(priority);
+
+  gpg_runner_loads[runner_index]++;
+  QObject::connect(handler.GetTask(), &QObject::destroyed,
+                   [runner_index]() { gpg_runner_loads[runner_index]--; });
+
   handler.Start();
   return handler;
 }
@@ -42,12 +42,13 @@ namespace GpgFrontend {
  * @param callback
  * @param operation
  * @param minimal_version
+ * @param priority bulk file operations shouldn't hold up interactive ones
  */
-auto GF_CORE_EXPORT RunGpgOperaAsync(int channel,
-                                     const GpgOperaRunnable& runnable,
-                                     const GpgOperationCallback& callback,
-                                     const QString& operation,
-                                     const QString& minimal_version)
+auto GF_CORE_EXPORT RunGpgOperaAsync(
+    int channel, const GpgOperaRunnable& runnable,
+    const GpgOperationCallback& callback, const QString& operation,
+    const QString& minimal_version,
+    Thread::Task::Priority priority = Thread::Task::kPriority_Normal)
     -> Thread::Task::TaskHandler;
 
 /**
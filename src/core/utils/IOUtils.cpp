@@ -31,45 +31,207 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 
+#ifdef Q_OS_WINDOWS
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "core/model/GFDataExchanger.h"
+#include "core/thread/Task.h"
+#include "core/thread/TaskRunnerGetter.h"
+#include "core/thread/WorkStealingExecutor.h"
 #include "core/utils/FilesystemUtils.h"
 
 namespace {
-auto GetFileHashOpenSSL(const QString& file_path, const EVP_MD* md_type)
-    -> QByteArray {
-  QFile file(file_path);
-  if (!file.open(QIODevice::ReadOnly)) return {};
 
-  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-  if (ctx == nullptr) return {};
+// files below this size are hashed on the calling thread only
+constexpr qint64 kParallelDigestMinSize = static_cast<qint64>(8) * 1024 * 1024;
 
-  if (EVP_DigestInit_ex(ctx, md_type, nullptr) != 1) {
-    EVP_MD_CTX_free(ctx);
-    return {};
+// larger files are streamed, a 32-bit address space has no room to map them
+constexpr qint64 kMaxMappedDigestSize =
+    sizeof(void*) < 8 ? static_cast<qint64>(256) * 1024 * 1024
+                      : std::numeric_limits<qint64>::max();
+
+/**
+ * @brief the items of a ParallelFor(), shared with the jobs that may start
+ * after it returned
+ *
+ */
+struct ParallelForState {
+  std::function<void(qsizetype)> fn;
+  qsizetype count;
+  std::atomic<qsizetype> next{0};
+
+  std::mutex lock;
+  std::condition_variable finished;
+  qsizetype done = 0;
+
+  ParallelForState(std::function<void(qsizetype)> fn, qsizetype count)
+      : fn(std::move(fn)), count(count) {}
+
+  void Run() {
+    for (auto i = next++; i < count; i = next++) {
+      fn(i);
+
+      std::lock_guard<std::mutex> guard(lock);
+      if (++done == count) finished.notify_all();
+    }
+  }
+};
+
+/**
+ * @brief run fn for each index below count on the default runner's
+ * workers. the calling thread takes items as well and only waits for the
+ * ones already running, so a caller on a worker, or a nested call, can't
+ * wait for a job that never starts.
+ *
+ */
+void ParallelFor(qsizetype count, const std::function<void(qsizetype)>& fn) {
+  if (count <= 0) return;
+
+  auto state = std::make_shared<ParallelForState>(fn, count);
+  auto* executor = GpgFrontend::Thread::TaskRunnerGetter::GetInstance()
+                       .GetTaskRunner(GpgFrontend::Thread::TaskRunnerGetter::
+                                          kTaskRunnerType_Default)
+                       ->GetExecutor();
+  if (executor != nullptr) {
+    const auto helpers =
+        std::min<qsizetype>(executor->WorkerCount(), count - 1);
+    for (qsizetype i = 0; i < helpers; i++) {
+      executor->Submit([state]() { state->Run(); },
+                       GpgFrontend::Thread::Task::kPriority_Bulk);
+    }
+  }
+
+  state->Run();
+
+  std::unique_lock<std::mutex> lock(state->lock);
+  state->finished.wait(lock, [&]() { return state->done == state->count; });
+}
+
+struct DigestContext {
+  std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx;
+  bool ok = false;
+
+  explicit DigestContext(const EVP_MD* md)
+      : ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free) {
+    ok = ctx != nullptr && EVP_DigestInit_ex(ctx.get(), md, nullptr) == 1;
   }
 
-  GpgFrontend::GFBuffer buffer(GpgFrontend::kSecBufferSize);
-  const auto buffer_size = static_cast<qsizetype>(buffer.Size());
-  while (!file.atEnd()) {
-    auto n = file.read(buffer.Data(), buffer_size);
-    Q_ASSERT(n <= buffer_size);
-    if (n <= 0 || n > buffer_size) break;
+  void Update(const void* data, size_t size) {
+    if (ok) ok = EVP_DigestUpdate(ctx.get(), data, size) == 1;
+  }
 
-    if (EVP_DigestUpdate(ctx, buffer.Data(), n) != 1) {
-      EVP_MD_CTX_free(ctx);
+  auto Final() -> QByteArray {
+    std::array<unsigned char, EVP_MAX_MD_SIZE> md_value;
+    unsigned int md_len = 0;
+    if (!ok || EVP_DigestFinal_ex(ctx.get(), md_value.data(), &md_len) != 1) {
       return {};
     }
+    return {reinterpret_cast<const char*>(md_value.data()),
+            static_cast<qsizetype>(md_len)};
   }
+};
 
-  std::array<unsigned char, EVP_MAX_MD_SIZE> md_value;
-  unsigned int md_len = 0;
-  if (EVP_DigestFinal_ex(ctx, md_value.data(), &md_len) != 1) {
-    EVP_MD_CTX_free(ctx);
-    return {};
+/**
+ * @brief feed a mapped file to every context, side by side on the workers
+ * when the file is large enough to pay for it
+ *
+ */
+void DigestMapped(const uchar* data, qint64 size,
+                  std::vector<DigestContext>& contexts) {
+  const auto update = [=](DigestContext& c) {
+    constexpr qint64 kBlockSize = GpgFrontend::kSecBufferSizeForFile;
+    for (qint64 pos = 0; pos < size; pos += kBlockSize) {
+      c.Update(data + pos,
+               static_cast<size_t>(std::min(kBlockSize, size - pos)));
+    }
+  };
+
+  if (contexts.size() < 2 || size < kParallelDigestMinSize) {
+    for (auto& c : contexts) update(c);
+    return;
+  }
+
+  ParallelFor(static_cast<qsizetype>(contexts.size()),
+              [&](qsizetype i) { update(contexts[i]); });
+}
+
+/**
+ * @brief read the file once, block by block, and feed every context
+ *
+ */
+auto DigestStream(QFile& file, std::vector<DigestContext>& contexts) -> bool {
+  std::vector<char> buffer(GpgFrontend::kSecBufferSizeForFile);
+  const auto buffer_size = static_cast<qint64>(buffer.size());
+
+  qint64 n;
+  while ((n = file.read(buffer.data(), buffer_size)) > 0) {
+    for (auto& c : contexts) c.Update(buffer.data(), static_cast<size_t>(n));
+  }
+  return n == 0;
+}
+
+auto HashFileInfo(const QString& file_path) -> QString {
+  QFileInfo const info(file_path);
+  QString buffer;
+  QTextStream ss(&buffer);
+
+  // a file that fails to be read reports an error, not empty digests
+  const auto digests =
+      info.isFile() && info.isReadable()
+          ? GpgFrontend::CalculateFileDigests(
+                file_path, {QStringLiteral("MD5"), QStringLiteral("SHA1"),
+                            QStringLiteral("SHA256")})
+          : QContainer<QByteArray>{};
+
+  if (digests.size() == 3) {
+    ss << "# " << QCoreApplication::tr("File Hash Information") << Qt::endl;
+    ss << "- " << QCoreApplication::tr("Filename") << QCoreApplication::tr(": ")
+       << info.fileName() << Qt::endl;
+
+    // read all data
+    ss << "- " << QCoreApplication::tr("File Size") << "(bytes)"
+       << QCoreApplication::tr(": ") << QString::number(info.size())
+       << Qt::endl;
+
+    ss << "- " << QCoreApplication::tr("File Size")
+       << QCoreApplication::tr(": ")
+       << GpgFrontend::GetHumanFriendlyFileSize(info.size()) << Qt::endl;
+
+    // md5
+    ss << "- " << "MD5" << QCoreApplication::tr(": ") << digests[0].toHex()
+       << Qt::endl;
+
+    // sha1
+    ss << "- " << "SHA1" << QCoreApplication::tr(": ") << digests[1].toHex()
+       << Qt::endl;
+
+    // sha256
+    ss << "- " << "SHA256" << QCoreApplication::tr(": ")
+       << digests[2].toHex() << Qt::endl;
+
+    ss << Qt::endl;
+
+  } else {
+    ss << "# " << QCoreApplication::tr("Error: cannot read target file")
+       << Qt::endl;
+    ss << "- " << QCoreApplication::tr("Filename") << QCoreApplication::tr(": ")
+       << info.fileName() << Qt::endl;
   }
-  EVP_MD_CTX_free(ctx);
 
-  return {reinterpret_cast<const char*>(md_value.data()), md_len};
+  return ss.readAll();
 }
+
 }  // namespace
 
 namespace GpgFrontend {
@@ -119,55 +281,99 @@ auto WriteFileGFBuffer(const QString& file_name, GFBuffer data) -> bool {
   }
 
   file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
-  auto n = file.write(data.Data(), static_cast<qsizetype>(data.Size()));
+  auto n = file.write(std::as_const(data).Data(),
+                      static_cast<qsizetype>(data.Size()));
   file.flush();
   file.close();
   return n == static_cast<decltype(n)>(data.Size());
 }
 
-auto CalculateHash(const QString& file_path) -> QString {
-  // Returns empty QByteArray() on failure.
-  QFileInfo const info(file_path);
-  QString buffer;
-  QTextStream ss(&buffer);
-
-  if (info.isFile() && info.isReadable()) {
-    auto md5 = GetFileHashOpenSSL(file_path, EVP_md5()).toHex();
-    auto sha1 = GetFileHashOpenSSL(file_path, EVP_sha1()).toHex();
-    auto sha256 = GetFileHashOpenSSL(file_path, EVP_sha256()).toHex();
+auto SyncFileToDisk(QFile& file) -> bool {
+  if (!file.flush()) return false;
+#ifdef Q_OS_WINDOWS
+  return _commit(file.handle()) == 0;
+#else
+  return ::fsync(file.handle()) == 0;
+#endif
+}
 
-    ss << "# " << QCoreApplication::tr("File Hash Information") << Qt::endl;
-    ss << "- " << QCoreApplication::tr("Filename") << QCoreApplication::tr(": ")
-       << info.fileName() << Qt::endl;
+auto SyncDirectoryToDisk(const QString& path) -> bool {
+#ifdef Q_OS_WINDOWS
+  // directories can't be opened for syncing, ntfs journals the renames
+  return true;
+#else
+  auto fd = ::open(QFile::encodeName(path).constData(), O_RDONLY);
+  if (fd < 0) return false;
+  auto ret = ::fsync(fd);
+  ::close(fd);
+  return ret == 0;
+#endif
+}
 
-    // read all data
-    ss << "- " << QCoreApplication::tr("File Size") << "(bytes)"
-       << QCoreApplication::tr(": ") << QString::number(info.size())
-       << Qt::endl;
+auto CalculateFileDigests(const QString& file_path,
+                          const QStringList& algorithms)
+    -> QContainer<QByteArray> {
+  std::vector<DigestContext> contexts;
+  contexts.reserve(algorithms.size());
+  for (const auto& algorithm : algorithms) {
+    const auto* md = EVP_get_digestbyname(algorithm.toLatin1().constData());
+    if (md == nullptr) {
+      LOG_W() << "unknown digest algorithm: " << algorithm;
+      return {};
+    }
+    contexts.emplace_back(md);
+  }
 
-    ss << "- " << QCoreApplication::tr("File Size")
-       << QCoreApplication::tr(": ") << GetHumanFriendlyFileSize(info.size())
-       << Qt::endl;
+  QFile file(file_path);
+  if (!file.open(QIODevice::ReadOnly)) return {};
 
-    // md5
-    ss << "- " << "MD5" << QCoreApplication::tr(": ") << md5 << Qt::endl;
+  // a mapped file is read from the page cache by every digest in parallel,
+  // anything else is read once and fed to all digests block by block
+  const auto size =
+      file.isSequential() || !QFileInfo(file).isFile() ? 0 : file.size();
+  auto* mapped =
+      size > 0 && size <= kMaxMappedDigestSize ? file.map(0, size) : nullptr;
+  if (mapped != nullptr) {
+    DigestMapped(mapped, size, contexts);
+    file.unmap(mapped);
+  } else if (!DigestStream(file, contexts)) {
+    return {};
+  }
 
-    // sha1
-    ss << "- " << "SHA1" << QCoreApplication::tr(": ") << sha1 << Qt::endl;
+  QContainer<QByteArray> digests;
+  for (auto& c : contexts) {
+    auto digest = c.Final();
+    if (digest.isEmpty()) return {};
+    digests.push_back(digest);
+  }
+  return digests;
+}
 
-    // sha1
-    ss << "- " << "SHA256" << QCoreApplication::tr(": ") << sha256 << Qt::endl;
+auto CalculateHash(const QString& file_path) -> QString {
+  return HashFileInfo(file_path);
+}
 
-    ss << Qt::endl;
+auto CalculateHashes(const QStringList& paths) -> QString {
+  QStringList files;
+  for (const auto& path : paths) {
+    if (!QFileInfo(path).isDir()) {
+      files.append(path);
+      continue;
+    }
 
-  } else {
-    ss << "# " << QCoreApplication::tr("Error: cannot read target file")
-       << Qt::endl;
-    ss << "- " << QCoreApplication::tr("Filename") << QCoreApplication::tr(": ")
-       << info.fileName() << Qt::endl;
+    QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) files.append(it.next());
   }
+  files.sort();
 
-  return ss.readAll();
+  std::vector<QString> results(files.size());
+  ParallelFor(files.size(),
+              [&](qsizetype i) { results[i] = HashFileInfo(files.at(i)); });
+
+  QString ret;
+  for (const auto& result : results) ret.append(result);
+  return ret;
 }
 
 auto GetTempFilePath() -> QString {
@@ -259,4 +465,50 @@ auto CalculateBinaryChacksum(const QString& path) -> QString {
   return hash_sha.result().toHex();
 }
 
+auto MakeStreamReader(QIODevice* device) -> GFStreamReader {
+  return [device](std::byte* buffer, size_t size) -> ssize_t {
+    return device->read(reinterpret_cast<char*>(buffer),
+                        static_cast<qint64>(size));
+  };
+}
+
+auto MakeStreamWriter(QIODevice* device) -> GFStreamWriter {
+  return [device](const std::byte* buffer, size_t size) -> ssize_t {
+    return device->write(reinterpret_cast<const char*>(buffer),
+                         static_cast<qint64>(size));
+  };
+}
+
+auto MakeStreamReader(const QSharedPointer<GFDataExchanger>& ex)
+    -> GFStreamReader {
+  return [ex](std::byte* buffer, size_t size) -> ssize_t {
+    return ex->Read(buffer, size);
+  };
+}
+
+auto MakeStreamWriter(const QSharedPointer<GFDataExchanger>& ex)
+    -> GFStreamWriter {
+  return [ex](const std::byte* buffer, size_t size) -> ssize_t {
+    return ex->Write(buffer, size);
+  };
+}
+
+auto MakeStreamReader(const GFBuffer& buffer) -> GFStreamReader {
+  return [buffer, pos = size_t{0}](std::byte* out,
+                                   size_t size) mutable -> ssize_t {
+    auto n = std::min(size, buffer.Size() - pos);
+    if (n > 0) memcpy(out, std::as_const(buffer).Data() + pos, n);
+    pos += n;
+    return static_cast<ssize_t>(n);
+  };
+}
+
+auto MakeStreamWriter(GFBuffer& buffer) -> GFStreamWriter {
+  return [&buffer](const std::byte* in, size_t size) -> ssize_t {
+    buffer.Append(reinterpret_cast<const char*>(in),
+                  static_cast<ssize_t>(size));
+    return static_cast<ssize_t>(size);
+  };
+}
+
 }  // namespace GpgFrontend
\ No newline at end of file
@@ -29,9 +29,12 @@
 #pragma once
 
 #include "core/model/GFBuffer.h"
+#include "core/typedef/CoreTypedef.h"
 
 namespace GpgFrontend {
 
+class GFDataExchanger;
+
 /**
  * @brief
  *
@@ -52,6 +55,24 @@ auto GF_CORE_EXPORT ReadFileGFBuffer(const QString &file_name)
 auto GF_CORE_EXPORT WriteFileGFBuffer(const QString &file_name, GFBuffer data)
     -> bool;
 
+/**
+ * @brief flush an open file through the os caches down to the disk
+ *
+ * @param file
+ * @return true
+ * @return false
+ */
+auto GF_CORE_EXPORT SyncFileToDisk(QFile &file) -> bool;
+
+/**
+ * @brief persist the entries of a directory, e.g. files just renamed into it
+ *
+ * @param path
+ * @return true
+ * @return false
+ */
+auto GF_CORE_EXPORT SyncDirectoryToDisk(const QString &path) -> bool;
+
 /**
  * @brief read file content
  *
@@ -74,6 +95,18 @@ auto GF_CORE_EXPORT ReadFile(const QString &file_name, QByteArray &data)
 auto GF_CORE_EXPORT WriteFile(const QString &file_name, const QByteArray &data)
     -> bool;
 
+/**
+ * @brief calculate several digests of a file while reading it only once
+ *
+ * @param file_path
+ * @param algorithms OpenSSL digest names, like "SHA256"
+ * @return QContainer<QByteArray> the raw digests in the order of algorithms,
+ * empty on failure
+ */
+auto GF_CORE_EXPORT CalculateFileDigests(const QString &file_path,
+                                         const QStringList &algorithms)
+    -> QContainer<QByteArray>;
+
 /**
  * calculate the hash of a file
  * @param file_path
@@ -81,6 +114,15 @@ auto GF_CORE_EXPORT WriteFile(const QString &file_name, const QByteArray &data)
  */
 auto GF_CORE_EXPORT CalculateHash(const QString &file_path) -> QString;
 
+/**
+ * @brief calculate the hash of many files concurrently, directories are
+ * expanded to the files below them
+ *
+ * @param paths
+ * @return QString the reports of the files, sorted by path
+ */
+auto GF_CORE_EXPORT CalculateHashes(const QStringList &paths) -> QString;
+
 /**
  * @brief
  *
@@ -141,4 +183,58 @@ auto GF_CORE_EXPORT TargetFilePreCheck(const QString &path, bool read)
  */
 auto GF_CORE_EXPORT GetFullExtension(QString path) -> QString;
 
+/**
+ * @brief create a stream reader pulling data from a device, the device
+ * must be open and outlive the reader
+ *
+ * @param device
+ * @return GFStreamReader
+ */
+auto GF_CORE_EXPORT MakeStreamReader(QIODevice *device) -> GFStreamReader;
+
+/**
+ * @brief create a stream writer pushing data to a device, the device
+ * must be open and outlive the writer
+ *
+ * @param device
+ * @return GFStreamWriter
+ */
+auto GF_CORE_EXPORT MakeStreamWriter(QIODevice *device) -> GFStreamWriter;
+
+/**
+ * @brief create a stream reader consuming a data exchanger
+ *
+ * @param ex
+ * @return GFStreamReader
+ */
+auto GF_CORE_EXPORT MakeStreamReader(const QSharedPointer<GFDataExchanger> &ex)
+    -> GFStreamReader;
+
+/**
+ * @brief create a stream writer feeding a data exchanger, the writer does
+ * not close the exchanger
+ *
+ * @param ex
+ * @return GFStreamWriter
+ */
+auto GF_CORE_EXPORT MakeStreamWriter(const QSharedPointer<GFDataExchanger> &ex)
+    -> GFStreamWriter;
+
+/**
+ * @brief create a stream reader over an in-memory buffer
+ *
+ * @param buffer
+ * @return GFStreamReader
+ */
+auto GF_CORE_EXPORT MakeStreamReader(const GFBuffer &buffer) -> GFStreamReader;
+
+/**
+ * @brief create a stream writer appending to an in-memory buffer, the
+ * buffer must outlive the writer
+ *
+ * @param buffer
+ * @return GFStreamWriter
+ */
+auto GF_CORE_EXPORT MakeStreamWriter(GFBuffer &buffer) -> GFStreamWriter;
+
 }  // namespace GpgFrontend
@@ -33,6 +33,10 @@
 #include "GFSDKBasic.h"
 #include "private/GFSDKPrivat.h"
 
+struct GFModuleEventParamBlock {
+  GpgFrontend::Module::EventParamBlockPtr block;
+};
+
 void GFModuleListenEvent(const char *module_id, const char *event_id) {
   return GpgFrontend::Module::ModuleManager::GetInstance().ListenEvent(
       GFUnStrDup(module_id).toLower(), GFUnStrDup(event_id).toUpper());
@@ -95,3 +99,51 @@ auto GFModuleRetrieveRTValueOrDefaultBool(const char *namespace_,
           GFUnStrDup(namespace_), GFUnStrDup(key),
           static_cast<bool>(default_value)));
 }
+
+auto GFModuleAcquireEventParams(GFModuleEvent *module_event)
+    -> GFModuleEventParamBlock * {
+  if (module_event == nullptr) return nullptr;
+
+  auto event = GpgFrontend::Module::ModuleManager::GetInstance().SearchEvent(
+      GFUnStrDup(module_event->trigger_id).toLower());
+  if (!event) return nullptr;
+
+  return GpgFrontend::SecureCreateObject<GFModuleEventParamBlock>(
+      GFModuleEventParamBlock{event.value()->GetParamBlock()});
+}
+
+auto GFModuleEventParamsCount(GFModuleEventParamBlock *block) -> int32_t {
+  if (block == nullptr) return 0;
+  return static_cast<int32_t>(block->block->params.size());
+}
+
+auto GFModuleEventParamsAt(GFModuleEventParamBlock *block, int32_t index,
+                           const char **name, const char **value,
+                           size_t *size) -> int {
+  if (block == nullptr || index < 0 ||
+      index >= static_cast<int32_t>(block->block->params.size())) {
+    return -1;
+  }
+
+  const auto &param = block->block->params[index];
+  if (name != nullptr) *name = param.first.constData();
+  if (value != nullptr) *value = param.second.Data();
+  if (size != nullptr) *size = param.second.Size();
+  return 0;
+}
+
+auto GFModuleEventParamsGet(GFModuleEventParamBlock *block, const char *name,
+                            const char **value, size_t *size) -> int {
+  if (block == nullptr || name == nullptr) return -1;
+
+  const auto *param = block->block->Find(QByteArray(name));
+  if (param == nullptr) return -1;
+
+  if (value != nullptr) *value = param->Data();
+  if (size != nullptr) *size = param->Size();
+  return 0;
+}
+
+void GFModuleReleaseEventParams(GFModuleEventParamBlock *block) {
+  GpgFrontend::SecureDestroyObject(block);
+}
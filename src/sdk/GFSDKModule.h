@@ -32,6 +32,7 @@
 
 extern "C" {
 
+#include <stddef.h>
 #include <stdint.h>
 
 void GF_SDK_EXPORT GFModuleListenEvent(const char *module_id,
@@ -60,4 +61,64 @@ auto GF_SDK_EXPORT GFModuleListRTChildKeys(const char *namespace_,
 void GF_SDK_EXPORT GFModuleTriggerModuleEventCallback(GFModuleEvent *event,
                                                       const char *module_id,
                                                       GFModuleEventParam *argv);
+
+/**
+ * @brief take a reference to the parameters of an event without copying
+ * them. A module declaring "EventParams" = "borrowed" in its meta data gets
+ * its events with an empty params list and reads them this way. Every
+ * block must be given back with GFModuleReleaseEventParams().
+ *
+ * @param event
+ * @return GFModuleEventParamBlock* nullptr if the event is unknown
+ */
+auto GF_SDK_EXPORT GFModuleAcquireEventParams(GFModuleEvent *event)
+    -> GFModuleEventParamBlock *;
+
+/**
+ * @brief the number of parameters in the block
+ *
+ * @param block
+ * @return int32_t
+ */
+auto GF_SDK_EXPORT GFModuleEventParamsCount(GFModuleEventParamBlock *block)
+    -> int32_t;
+
+/**
+ * @brief borrow a parameter by its index. the pointers stay valid until the
+ * block is released, the value isn't null terminated.
+ *
+ * @param block
+ * @param index
+ * @param name
+ * @param value
+ * @param size
+ * @return int 0 on success, -1 if the index is out of range
+ */
+auto GF_SDK_EXPORT GFModuleEventParamsAt(GFModuleEventParamBlock *block,
+                                         int32_t index, const char **name,
+                                         const char **value, size_t *size)
+    -> int;
+
+/**
+ * @brief borrow the value of a parameter by its name, see
+ * GFModuleEventParamsAt()
+ *
+ * @param block
+ * @param name
+ * @param value
+ * @param size
+ * @return int 0 on success, -1 if there's no such parameter
+ */
+auto GF_SDK_EXPORT GFModuleEventParamsGet(GFModuleEventParamBlock *block,
+                                          const char *name,
+                                          const char **value, size_t *size)
+    -> int;
+
+/**
+ * @brief give back a block taken by GFModuleAcquireEventParams(), the
+ * pointers borrowed from it must not be used afterwards
+ *
+ * @param block
+ */
+void GF_SDK_EXPORT GFModuleReleaseEventParams(GFModuleEventParamBlock *block);
 };
\ No newline at end of file
@@ -48,6 +48,13 @@ struct GFModuleEvent {
   GFModuleEventParam *params;
 };
 
+/**
+ * @brief read-only, reference counted parameters of an event, shared by all
+ * its listeners. see GFModuleAcquireEventParams().
+ *
+ */
+struct GFModuleEventParamBlock;
+
 using GFModuleAPIGetModuleGFSDKVersion = auto (*)() -> const char *;
 
 using GFModuleAPIGetModuleQtEnvVersion = auto (*)() -> const char *;
@@ -58,6 +65,22 @@ using GFModuleAPIGetModuleVersion = auto (*)() -> const char *;
 
 using GFModuleAPIGetModuleMetaData = auto (*)() -> GFModuleMetaData *;
 
+/*
+ * threading contract of the calls below, from register to unregister:
+ *
+ * - activate, execute and deactivate of a module never run at the same
+ *   time, and a module gets its events in the order they were triggered.
+ *
+ * - by default they all run on the module thread, which has a Qt event
+ *   loop, so modules take turns.
+ *
+ * - a module declaring the meta data "Dispatch" = "parallel" opts out of
+ *   this: its calls may each run on a different worker thread of the
+ *   application, side by side with other modules. these worker threads
+ *   have no Qt event loop, objects needing one, e.g. timers or network
+ *   replies, belong on a thread of the module's own.
+ */
+
 using GFModuleAPIRegisterModule = auto (*)() -> int;
 
 using GFModuleAPIActivateModule = auto (*)() -> int;
@@ -26,11 +26,16 @@
  *
  */
 
+#include <QCryptographicHash>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QSharedPointer>
 #include <QTemporaryDir>
+#include <atomic>
 
+#include "core/GpgConstants.h"
 #include "core/function/ArchiveFileOperator.h"
 
 namespace {
@@ -43,6 +48,137 @@ void CreateTestFile(const QString& dir, const QString& name,
   f.close();
 }
 
+/**
+ * @brief sizes of the benchmarks, the environment raises them when run by
+ * hand, e.g. to 100000 files or a few GB
+ *
+ */
+auto BenchmarkEnvValue(const char* name, int fallback) -> int {
+  bool ok = false;
+  auto value = qEnvironmentVariableIntValue(name, &ok);
+  return ok && value > 0 ? value : fallback;
+}
+
+auto Throughput(qint64 bytes, qint64 nsecs) -> double {
+  return (static_cast<double>(bytes) / (1024.0 * 1024.0)) /
+         (static_cast<double>(std::max<qint64>(nsecs, 1)) / 1e9);
+}
+
+/**
+ * @brief archive a directory into a file, the test thread drains the
+ * exchanger the way gpgme would
+ *
+ */
+auto ArchiveToFile(const QString& src_dir, const QString& path,
+                   const GpgFrontend::ArchiveCompression& compression = {})
+    -> qint64 {
+  auto exchanger = GpgFrontend::CreateStandardGFDataExchanger();
+  std::atomic<bool> finished = false;
+
+  QElapsedTimer timer;
+  timer.start();
+  GpgFrontend::ArchiveFileOperator::NewArchive2DataExchanger(
+      src_dir, exchanger,
+      [&](GpgFrontend::GFError err, const GpgFrontend::DataObjectPtr&) {
+        EXPECT_EQ(err, 0);
+        finished = true;
+      },
+      compression);
+
+  QFile file(path);
+  EXPECT_TRUE(file.open(QIODevice::WriteOnly));
+  std::vector<std::byte> buf(GpgFrontend::kSecBufferSizeForFile);
+  ssize_t n;
+  while ((n = exchanger->Read(buf.data(), buf.size())) > 0) {
+    file.write(reinterpret_cast<const char*>(buf.data()), n);
+  }
+  const auto elapsed = timer.nsecsElapsed();
+
+  WAIT_FOR_TRUE(finished, 10000);
+  return elapsed;
+}
+
+/**
+ * @brief extract an archive file, the test thread feeds the exchanger the
+ * way gpgme would
+ *
+ */
+auto ExtractFromFile(const QString& path, const QString& dst_dir) -> qint64 {
+  auto exchanger = GpgFrontend::CreateStandardGFDataExchanger();
+  std::atomic<bool> finished = false;
+
+  QElapsedTimer timer;
+  timer.start();
+  GpgFrontend::ArchiveFileOperator::ExtractArchiveFromDataExchanger(
+      exchanger, dst_dir,
+      [&](GpgFrontend::GFError err, const GpgFrontend::DataObjectPtr&) {
+        EXPECT_EQ(err, 0);
+        finished = true;
+      });
+
+  QFile file(path);
+  EXPECT_TRUE(file.open(QIODevice::ReadOnly));
+  auto chunk = file.read(GpgFrontend::kSecBufferSizeForFile);
+  while (!chunk.isEmpty()) {
+    exchanger->Write(reinterpret_cast<const std::byte*>(chunk.constData()),
+                     chunk.size());
+    chunk = file.read(GpgFrontend::kSecBufferSizeForFile);
+  }
+  exchanger->CloseWrite();
+
+  WAIT_FOR_TRUE(finished, 600000);
+  return timer.nsecsElapsed();
+}
+
+/**
+ * @brief a ustar record of a regular file, enough to build archives whose
+ * entry order the archive writer would never produce
+ *
+ */
+auto TarFileRecord(const QByteArray& name, const QByteArray& content)
+    -> QByteArray {
+  QByteArray header(512, '\0');
+  auto put = [&](int offset, const QByteArray& field) {
+    std::copy(field.begin(), field.end(), header.begin() + offset);
+  };
+  put(0, name);
+  put(100, "0000644");
+  put(108, "0000000");
+  put(116, "0000000");
+  put(124, QByteArray::number(content.size(), 8).rightJustified(11, '0'));
+  put(136, "00000000000");
+  put(148, "        ");
+  put(156, "0");
+  put(257, QByteArray("ustar\0", 6));
+  put(263, "00");
+
+  int sum = 0;
+  for (auto c : header) sum += static_cast<unsigned char>(c);
+  put(148, QByteArray::number(sum, 8).rightJustified(6, '0') +
+               QByteArray("\0 ", 2));
+
+  auto padding = (512 - content.size() % 512) % 512;
+  return header + content + QByteArray(padding, '\0');
+}
+
+auto CountFiles(const QString& dir) -> int {
+  int count = 0;
+  QDirIterator it(dir, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    count++;
+  }
+  return count;
+}
+
+auto Sha256(const QString& path) -> QByteArray {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return {};
+  QCryptographicHash hash(QCryptographicHash::Sha256);
+  hash.addData(&file);
+  return hash.result();
+}
+
 }  // namespace
 
 namespace GpgFrontend::Test {
@@ -85,6 +221,84 @@ TEST(ArchiveFileOperatorTest, ArchiveAndExtract) {
   EXPECT_EQ(f2.readAll(), QByteArray("hello world 2"));
 }
 
+TEST(ArchiveFileOperatorTest, CompressedArchiveRoundTrip) {
+  QTemporaryDir temp_dir;
+  ASSERT_TRUE(temp_dir.isValid());
+  const auto src_dir = temp_dir.path() + "/src";
+  QDir().mkpath(src_dir + "/sub");
+
+  CreateTestFile(src_dir, "text.txt", QByteArray(256 * 1024, 'g'));
+  CreateTestFile(src_dir + "/sub", "small.txt", "hello world");
+
+  const auto plain_path = temp_dir.path() + "/plain.tar";
+  ArchiveToFile(src_dir, plain_path);
+
+  const auto cases = {
+      std::make_pair(ArchiveCompression{ArchiveCompression::kFilter_Gzip, 6},
+                     QByteArray("\x1f\x8b")),
+      std::make_pair(
+          ArchiveCompression{ArchiveCompression::kFilter_Zstd, 3, 2},
+          QByteArray("\x28\xb5\x2f\xfd")),
+  };
+
+  for (const auto& [compression, magic] : cases) {
+    const auto archive_path = temp_dir.path() + "/compressed.tar";
+    ArchiveToFile(src_dir, archive_path, compression);
+
+    QFile archive(archive_path);
+    ASSERT_TRUE(archive.open(QIODevice::ReadOnly));
+    EXPECT_EQ(archive.read(magic.size()), magic);
+    EXPECT_LT(archive.size(), QFileInfo(plain_path).size() / 10);
+    archive.close();
+
+    // the reader has to find the filter on its own
+    QTemporaryDir extract_dir;
+    ASSERT_TRUE(extract_dir.isValid());
+    ExtractFromFile(archive_path, extract_dir.path());
+
+    EXPECT_EQ(Sha256(extract_dir.path() + "/text.txt"),
+              Sha256(src_dir + "/text.txt"));
+    EXPECT_EQ(Sha256(extract_dir.path() + "/sub/small.txt"),
+              Sha256(src_dir + "/sub/small.txt"));
+  }
+}
+
+TEST(ArchiveFileOperatorTest, ExtractKeepsArchiveOrderPerPath) {
+  QTemporaryDir temp_dir;
+  ASSERT_TRUE(temp_dir.isValid());
+
+  // later entries replace earlier ones of the same path, however many
+  // writers the extraction runs
+  QByteArray tar;
+  for (int i = 0; i < 64; i++) {
+    const auto size = (i % 2 == 0 ? 256 * 1024 : 16) + i;
+    tar += TarFileRecord("dup.txt", QByteArray(size, 'a' + i % 26));
+    tar += TarFileRecord("sub/dup.txt", QByteArray(size, 'a' + i % 26));
+    tar += TarFileRecord(QString("other/%1.txt").arg(i).toUtf8(),
+                         QByteArray(size, 'o'));
+  }
+  tar += QByteArray(1024, '\0');
+
+  const auto archive_path = temp_dir.path() + "/order.tar";
+  QFile archive(archive_path);
+  ASSERT_TRUE(archive.open(QIODevice::WriteOnly));
+  archive.write(tar);
+  archive.close();
+
+  QTemporaryDir extract_dir;
+  ASSERT_TRUE(extract_dir.isValid());
+  ExtractFromFile(archive_path, extract_dir.path());
+
+  const auto last = QByteArray(16 + 63, 'a' + 63 % 26);
+  QFile dup(extract_dir.path() + "/dup.txt");
+  ASSERT_TRUE(dup.open(QIODevice::ReadOnly));
+  EXPECT_EQ(dup.readAll(), last);
+  QFile sub_dup(extract_dir.path() + "/sub/dup.txt");
+  ASSERT_TRUE(sub_dup.open(QIODevice::ReadOnly));
+  EXPECT_EQ(sub_dup.readAll(), last);
+  EXPECT_EQ(CountFiles(extract_dir.path() + "/other"), 64);
+}
+
 TEST(ArchiveFileOperatorTest, ListArchive) {
   GpgFrontend::ArchiveFileOperator::ListArchive("/tmp/archive.tar");
 }
@@ -108,4 +322,88 @@ TEST(ArchiveFileOperatorTest, HandleInvalidInput) {
       });
   WAIT_FOR_TRUE(extract_finished, 3000);
 }
+
+TEST(ArchiveFileOperatorTest, ManySmallFilesBenchmark) {
+  const auto count = BenchmarkEnvValue("GF_TEST_BENCHMARK_ARCHIVE_FILES", 2000);
+
+  QTemporaryDir temp_dir;
+  ASSERT_TRUE(temp_dir.isValid());
+  const auto src_dir = temp_dir.path() + "/src";
+  const auto dst_dir = temp_dir.path() + "/dst";
+  QDir().mkpath(dst_dir);
+
+  qint64 total = 0;
+  for (int i = 0; i < count; i++) {
+    const auto dir = QString("%1/d%2").arg(src_dir).arg(i / 1000);
+    if (i % 1000 == 0) QDir().mkpath(dir);
+
+    auto content =
+        QByteArray(100 + (i % 40) * 100, static_cast<char>('a' + i % 26));
+    CreateTestFile(dir, QString("f%1.txt").arg(i), content);
+    total += content.size();
+  }
+
+  const auto archive_path = temp_dir.path() + "/small.tar";
+  const auto archive_ns = ArchiveToFile(src_dir, archive_path);
+  const auto extract_ns = ExtractFromFile(archive_path, dst_dir);
+
+  EXPECT_EQ(CountFiles(dst_dir), count);
+  QFile last(QString("%1/d%2/f%3.txt")
+                 .arg(dst_dir)
+                 .arg((count - 1) / 1000)
+                 .arg(count - 1));
+  ASSERT_TRUE(last.open(QIODevice::ReadOnly));
+  EXPECT_EQ(last.size(), 100 + ((count - 1) % 40) * 100);
+
+  LOG_I() << "archived" << count << "small files,"
+          << Throughput(total, archive_ns) << "MB/s,"
+          << count / (static_cast<double>(archive_ns) / 1e9) << "files/s";
+  LOG_I() << "extracted" << count << "small files,"
+          << Throughput(total, extract_ns) << "MB/s,"
+          << count / (static_cast<double>(extract_ns) / 1e9) << "files/s";
+}
+
+TEST(ArchiveFileOperatorTest, FewHugeFilesBenchmark) {
+  constexpr int kFiles = 4;
+  const auto size = static_cast<qint64>(
+                        BenchmarkEnvValue("GF_TEST_BENCHMARK_FILE_MB", 64)) *
+                    1024 * 1024 / kFiles;
+
+  QTemporaryDir temp_dir;
+  ASSERT_TRUE(temp_dir.isValid());
+  const auto src_dir = temp_dir.path() + "/src";
+  const auto dst_dir = temp_dir.path() + "/dst";
+  QDir().mkpath(src_dir);
+  QDir().mkpath(dst_dir);
+
+  QByteArray block(1024 * 1024, '\0');
+  for (qsizetype i = 0; i < block.size(); i++) {
+    block[i] = static_cast<char>((i * 31) % 251);
+  }
+
+  for (int i = 0; i < kFiles; i++) {
+    QFile file(QString("%1/huge%2.bin").arg(src_dir).arg(i));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    for (qint64 written = 0; written < size; written += block.size()) {
+      file.write(block.constData(),
+                 std::min<qint64>(block.size(), size - written));
+    }
+  }
+
+  const auto archive_path = temp_dir.path() + "/huge.tar";
+  const auto archive_ns = ArchiveToFile(src_dir, archive_path);
+  const auto extract_ns = ExtractFromFile(archive_path, dst_dir);
+
+  for (int i = 0; i < kFiles; i++) {
+    const auto name = QString("/huge%1.bin").arg(i);
+    EXPECT_EQ(QFileInfo(dst_dir + name).size(), size);
+    EXPECT_EQ(Sha256(dst_dir + name), Sha256(src_dir + name));
+  }
+
+  LOG_I() << "archived" << kFiles << "huge files,"
+          << Throughput(size * kFiles, archive_ns) << "MB/s";
+  LOG_I() << "extracted" << kFiles << "huge files,"
+          << Throughput(size * kFiles, extract_ns) << "MB/s";
+}
+
 }  // namespace GpgFrontend::Test
@@ -26,12 +26,16 @@
  *
  */
 
+#include <atomic>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 #include "GpgCoreTest.h"
 #include "core/GpgConstants.h"
 #include "core/function/CacheManager.h"
+#include "core/function/DataObjectStore.h"
+#include "core/function/GlobalSettingStation.h"
 #include "core/utils/GpgUtils.h"
 
 namespace GpgFrontend::Test {
@@ -54,4 +58,96 @@ TEST_F(GpgCoreTest, CoreCacheTestC) {
   ASSERT_EQ(CacheManager::GetInstance().LoadCache("ABCDEF"), QString(""));
 }
 
+TEST_F(GpgCoreTest, CoreCacheConcurrentStress) {
+  constexpr int kThreads = 8;
+  constexpr int kRounds = 20000;
+  constexpr int kKeys = 500;
+
+  auto& cache = CacheManager::GetInstance();
+  const auto before = cache.GetRuntimeCacheStats();
+
+  std::atomic<int> corrupted = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kRounds; i++) {
+        const auto key = QString("stress_%1").arg((i * 7 + t) % kKeys);
+        switch (i % 4) {
+          case 0:
+            cache.SaveSecCache(key, GFBuffer(key + "_value"), i % 2 ? 60 : -1);
+            break;
+          case 1:
+            if (i % 40 == 1) cache.ResetCache(key);
+            break;
+          default: {
+            // a key only ever maps to one value, anything else is a torn read
+            auto value = cache.LoadSecCache(key);
+            if (!value.Empty() && value.ConvertToQString() != key + "_value") {
+              corrupted++;
+            }
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const auto after = cache.GetRuntimeCacheStats();
+  EXPECT_EQ(corrupted, 0);
+  EXPECT_GE((after.hits - before.hits) + (after.misses - before.misses),
+            kThreads * kRounds / 2);
+  EXPECT_LE(after.bytes, after.capacity);
+
+  for (int k = 0; k < kKeys; k++) cache.ResetCache(QString("stress_%1").arg(k));
+}
+
+TEST_F(GpgCoreTest, CoreCacheEvictsLeastRecentlyUsed) {
+  auto& cache = CacheManager::GetInstance();
+  const auto before = cache.GetRuntimeCacheStats();
+
+  // overfill the byte budget with 256KB values, touching the first key so
+  // it stays recently used
+  const auto value = GFBuffer(QByteArray(256 * 1024, 'x'));
+  const auto count = before.capacity / (256 * 1024) * 8;
+  cache.SaveSecCache("lru_keep", value);
+  for (qint64 i = 0; i < count; i++) {
+    cache.SaveSecCache(QString("lru_%1").arg(i), value);
+    ASSERT_FALSE(cache.LoadSecCache("lru_keep").Empty());
+  }
+
+  const auto after = cache.GetRuntimeCacheStats();
+  EXPECT_GT(after.evictions, before.evictions);
+  EXPECT_LE(after.bytes, after.capacity);
+  EXPECT_TRUE(cache.LoadSecCache("lru_0").Empty());
+  EXPECT_FALSE(cache.LoadSecCache(QString("lru_%1").arg(count - 1)).Empty());
+
+  cache.ResetCache("lru_keep");
+  for (qint64 i = 0; i < count; i++) cache.ResetCache(QString("lru_%1").arg(i));
+}
+
+TEST_F(GpgCoreTest, CoreCacheDurableFlushesDirtyKeysOnly) {
+  auto& cache = CacheManager::GetInstance();
+  auto store = DataObjectStore::Open(
+      GlobalSettingStation::GetInstance().GetDataObjectsDir());
+
+  cache.SaveSecDurableCache("durable_a", GFBuffer("value a"), true);
+  cache.SaveSecDurableCache("durable_b", GFBuffer("value b"), true);
+  const auto appended = store->GetStats().appended;
+
+  // durable_b is written once however often it changed, durable_a not at all
+  cache.SaveSecDurableCache("durable_b", GFBuffer("value b1"));
+  cache.SaveSecDurableCache("durable_b", GFBuffer("value b2"), true);
+  EXPECT_EQ(store->GetStats().appended - appended, 1);
+
+  // nothing changed, nothing to write
+  cache.FlushCacheStorage();
+  EXPECT_EQ(store->GetStats().appended - appended, 1);
+
+  EXPECT_EQ(cache.LoadSecDurableCache("durable_a"), GFBuffer("value a"));
+  EXPECT_EQ(cache.LoadSecDurableCache("durable_b"), GFBuffer("value b2"));
+
+  cache.ResetDurableCache("durable_a");
+  cache.ResetDurableCache("durable_b");
+}
+
 }  // namespace GpgFrontend::Test
\ No newline at end of file
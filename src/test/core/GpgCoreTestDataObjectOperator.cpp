@@ -26,7 +26,29 @@
  *
  */
 
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
 #include "core/function/DataObjectOperator.h"
+#include "core/function/DataObjectStore.h"
+#include "core/function/SettingsObjectStore.h"
+#include "core/model/SettingsObject.h"
+#include "core/utils/IOUtils.h"
+
+namespace {
+
+auto TestRef(int i) -> GpgFrontend::GFBuffer {
+  return GpgFrontend::GFBuffer(
+      QCryptographicHash::hash(QByteArray::number(i),
+                               QCryptographicHash::Sha256));
+}
+
+auto TestPayload(int i, int size) -> GpgFrontend::GFBuffer {
+  return GpgFrontend::GFBuffer(
+      QByteArray(size, static_cast<char>('a' + i % 26)));
+}
+
+}  // namespace
 
 namespace GpgFrontend::Test {
 
@@ -56,6 +78,39 @@ TEST(DataObjectOperatorSingletonTest, StoreAndLoadBuffer) {
   EXPECT_EQ(*got, plain);
 }
 
+TEST(DataObjectOperatorSingletonTest, SettingsObjectWriteBack) {
+  auto& store = SettingsObjectStore::GetInstance();
+  store.Flush();
+
+  {
+    SettingsObject settings("settings-write-back");
+    settings["value"] = 1;
+  }
+  store.Flush();
+  auto writes = store.GetWriteCount();
+
+  // an object that wasn't changed isn't written again
+  for (int i = 0; i < 16; i++) {
+    SettingsObject settings("settings-write-back");
+    EXPECT_EQ(settings["value"].toInt(), 1);
+  }
+  store.Flush();
+  EXPECT_EQ(store.GetWriteCount(), writes);
+
+  // changes before the write back are written once
+  for (int i = 2; i <= 16; i++) {
+    SettingsObject settings("settings-write-back");
+    settings["value"] = i;
+  }
+  store.Flush();
+  EXPECT_EQ(store.GetWriteCount(), writes + 1);
+
+  auto stored = DataObjectOperator::GetInstance().GetDataObject(
+      "settings-write-back");
+  ASSERT_TRUE(stored.has_value());
+  EXPECT_EQ(stored->object().value("value").toInt(), 16);
+}
+
 TEST(DataObjectOperatorSingletonTest, GetByRef) {
   auto& op = DataObjectOperator::GetInstance();
 
@@ -70,6 +125,66 @@ TEST(DataObjectOperatorSingletonTest, GetByRef) {
   EXPECT_EQ(result.value().toJson(), doc.toJson());
 }
 
+TEST(DataObjectOperatorSingletonTest, StoreBatchAtomically) {
+  auto& op = DataObjectOperator::GetInstance();
+
+  QContainer<QPair<QString, GFBuffer>> objects;
+  for (int i = 0; i < 8; i++) {
+    objects.push_back({QString("singleton-batch-%1").arg(i),
+                       GFBuffer(QString("batch value %1").arg(i))});
+  }
+
+  auto refs = op.StoreSecDataObjs(objects);
+  ASSERT_EQ(refs.size(), objects.size());
+  for (qsizetype i = 0; i < objects.size(); i++) {
+    ASSERT_FALSE(refs[i].isEmpty());
+
+    auto got = op.GetSecDataObjectByRef(refs[i]);
+    ASSERT_TRUE(got.has_value());
+    EXPECT_EQ(*got, objects[i].second);
+  }
+
+  // overwriting replaces the objects in place, no temporary file is left
+  objects[0].second = GFBuffer("batch value replaced");
+  EXPECT_EQ(op.StoreSecDataObjs(objects), refs);
+  EXPECT_EQ(*op.GetSecDataObjectByRef(refs[0]), objects[0].second);
+
+  auto dir = GlobalSettingStation::GetInstance().GetDataObjectsDir();
+  EXPECT_TRUE(QDir(dir).entryList({"*.tmp"}, QDir::Files).isEmpty());
+}
+
+TEST(DataObjectOperatorSingletonTest, DerivedKeyCacheBenchmark) {
+  auto& op = DataObjectOperator::GetInstance();
+  constexpr int kCount = 2000;
+
+  QContainer<QPair<QString, GFBuffer>> objects;
+  for (int i = 0; i < kCount; i++) {
+    objects.push_back({QString("singleton-derive-%1").arg(i),
+                       GFBuffer(QByteArray(256, 'd'))});
+  }
+  ASSERT_EQ(op.StoreSecDataObjs(objects).size(), kCount);
+
+  // more objects than the cache holds, each load derives its key
+  QElapsedTimer timer;
+  timer.start();
+  for (const auto& object : objects) {
+    ASSERT_TRUE(op.GetSecDataObject(object.first).has_value());
+  }
+  const auto uncached_ns = timer.nsecsElapsed();
+
+  // one object over and over, its key comes from the cache
+  timer.restart();
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_TRUE(op.GetSecDataObject(objects[0].first).has_value());
+  }
+  const auto cached_ns = timer.nsecsElapsed();
+
+  LOG_I() << "object load with key derivation:"
+          << uncached_ns / kCount / 1000.0 << "us";
+  LOG_I() << "object load with cached key:" << cached_ns / kCount / 1000.0
+          << "us";
+}
+
 TEST(DataObjectOperatorSingletonTest, InvalidRefReturnsEmpty) {
   auto& op = DataObjectOperator::GetInstance();
 
@@ -77,4 +192,164 @@ TEST(DataObjectOperatorSingletonTest, InvalidRefReturnsEmpty) {
   EXPECT_FALSE(result.has_value());
 }
 
+TEST(DataObjectStoreTest, PutRemoveAndReopen) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  const auto path = dir.filePath("objects.gfstore");
+
+  {
+    DataObjectStore store(path);
+    QContainer<QPair<GFBuffer, GFBuffer>> batch;
+    for (int i = 0; i < 100; i++) {
+      batch.push_back({TestRef(i), TestPayload(i, 64)});
+    }
+    ASSERT_TRUE(store.Put(batch));
+    ASSERT_TRUE(store.Put({{TestRef(1), TestPayload(2, 128)}}));
+    EXPECT_TRUE(store.Remove(TestRef(2)));
+    EXPECT_FALSE(store.Remove(TestRef(2)));
+  }
+
+  DataObjectStore store(path);
+  EXPECT_EQ(store.GetStats().objects, 99);
+  EXPECT_EQ(*store.Get(TestRef(0)), TestPayload(0, 64));
+  EXPECT_EQ(*store.Get(TestRef(1)), TestPayload(2, 128));
+  EXPECT_FALSE(store.Get(TestRef(2)).has_value());
+}
+
+TEST(DataObjectStoreTest, RejectsObjectsOutOfLimits) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  const auto path = dir.filePath("objects.gfstore");
+
+  {
+    DataObjectStore store(path);
+    ASSERT_TRUE(store.Put({{TestRef(0), TestPayload(0, 64)}}));
+
+    // a bad object fails the whole batch, nothing of it is written
+    EXPECT_FALSE(store.Put({{TestRef(1), TestPayload(1, 64)},
+                            {GFBuffer(QByteArray(65, 'r')),
+                             TestPayload(2, 64)}}));
+    EXPECT_FALSE(store.Put({{GFBuffer(), TestPayload(3, 64)}}));
+    EXPECT_FALSE(store.Get(TestRef(1)).has_value());
+
+    ASSERT_TRUE(store.Put({{TestRef(4), TestPayload(4, 64)}}));
+  }
+
+  DataObjectStore store(path);
+  EXPECT_EQ(store.GetStats().objects, 2);
+  EXPECT_EQ(*store.Get(TestRef(0)), TestPayload(0, 64));
+  EXPECT_EQ(*store.Get(TestRef(4)), TestPayload(4, 64));
+}
+
+TEST(DataObjectStoreTest, DropsTornTail) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  const auto path = dir.filePath("objects.gfstore");
+
+  qint64 size = 0;
+  {
+    DataObjectStore store(path);
+    ASSERT_TRUE(store.Put({{TestRef(0), TestPayload(0, 64)}}));
+    size = store.GetStats().file_bytes;
+    ASSERT_TRUE(store.Put({{TestRef(1), TestPayload(1, 64)}}));
+  }
+
+  // a crash in the middle of the second record
+  QFile file(path);
+  ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+  file.resize(file.size() - 10);
+  file.close();
+
+  DataObjectStore store(path);
+  EXPECT_EQ(store.GetStats().file_bytes, size);
+  EXPECT_EQ(*store.Get(TestRef(0)), TestPayload(0, 64));
+  EXPECT_FALSE(store.Get(TestRef(1)).has_value());
+  ASSERT_TRUE(store.Put({{TestRef(1), TestPayload(1, 64)}}));
+  EXPECT_EQ(*store.Get(TestRef(1)), TestPayload(1, 64));
+}
+
+TEST(DataObjectStoreTest, CompactsOverwrittenObjects) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  DataObjectStore store(dir.filePath("objects.gfstore"));
+
+  for (int round = 0; round < 40; round++) {
+    QContainer<QPair<GFBuffer, GFBuffer>> batch;
+    for (int i = 0; i < 100; i++) {
+      batch.push_back({TestRef(i), TestPayload(round, 1024)});
+    }
+    ASSERT_TRUE(store.Put(batch));
+  }
+
+  auto stats = store.GetStats();
+  EXPECT_GT(stats.compactions, 0);
+  EXPECT_EQ(stats.objects, 100);
+  EXPECT_LT(stats.file_bytes, stats.live_bytes * 3);
+  EXPECT_EQ(*store.Get(TestRef(99)), TestPayload(39, 1024));
+
+  ASSERT_TRUE(store.Compact());
+  stats = store.GetStats();
+  EXPECT_LT(stats.file_bytes - stats.live_bytes, 64);
+  EXPECT_EQ(*store.Get(TestRef(0)), TestPayload(39, 1024));
+}
+
+TEST(DataObjectStoreTest, MigratesFilePerObjectLayout) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+
+  for (int i = 0; i < 10; i++) {
+    const auto name = TestRef(i).ConvertToQByteArray().toHex();
+    ASSERT_TRUE(WriteFileGFBuffer(dir.filePath(name), TestPayload(i, 100)));
+  }
+
+  auto store = DataObjectStore::Open(dir.path());
+  EXPECT_EQ(store->GetStats().objects, 10);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(*store->Get(TestRef(i)), TestPayload(i, 100));
+  }
+  EXPECT_EQ(QDir(dir.path()).entryList(QDir::Files),
+            QStringList{"objects.gfstore"});
+}
+
+TEST(DataObjectStoreTest, StartupBenchmark) {
+  const auto count =
+      qEnvironmentVariableIsSet("GF_TEST_BENCHMARK_DATA_OBJECTS")
+          ? qEnvironmentVariableIntValue("GF_TEST_BENCHMARK_DATA_OBJECTS")
+          : 2000;
+
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  for (int i = 0; i < count; i++) {
+    const auto name = TestRef(i).ConvertToQByteArray().toHex();
+    ASSERT_TRUE(WriteFileGFBuffer(dir.filePath(name), TestPayload(i, 512)));
+  }
+
+  // what loading used to cost: one existence check and one read per object
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < count; i++) {
+    const auto name = dir.filePath(TestRef(i).ConvertToQByteArray().toHex());
+    ASSERT_TRUE(QFileInfo(name).exists());
+    ASSERT_TRUE(std::get<0>(ReadFileGFBuffer(name)));
+  }
+  const auto files_ns = timer.nsecsElapsed();
+
+  timer.restart();
+  auto store = DataObjectStore::Open(dir.path());
+  const auto migrate_ns = timer.nsecsElapsed();
+  store.reset();
+
+  timer.restart();
+  DataObjectStore reopened(dir.filePath("objects.gfstore"));
+  for (int i = 0; i < count; i++) ASSERT_TRUE(reopened.Get(TestRef(i)));
+  const auto store_ns = timer.nsecsElapsed();
+
+  LOG_I() << "loaded" << count << "objects from files in"
+          << files_ns / 1000000.0 << "ms";
+  LOG_I() << "migrated" << count << "objects in" << migrate_ns / 1000000.0
+          << "ms";
+  LOG_I() << "opened the store and loaded" << count << "objects in"
+          << store_ns / 1000000.0 << "ms";
+}
+
 }  // namespace GpgFrontend::Test
\ No newline at end of file
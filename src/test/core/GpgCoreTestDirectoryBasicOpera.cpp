@@ -26,4 +26,163 @@
  *
  */
 
+#include <QElapsedTimer>
+#include <array>
+#include <queue>
+#include <thread>
+
 #include "GpgCoreTest.h"
+#include "core/GpgConstants.h"
+#include "core/model/GFDataExchanger.h"
+
+namespace {
+
+/**
+ * @brief the former per-byte queue exchanger, kept here only as a
+ * throughput reference for the ring buffer implementation.
+ *
+ */
+class ByteQueueExchanger {
+ public:
+  explicit ByteQueueExchanger(size_t size) : max_size_(size) {}
+
+  auto Write(const std::byte* buffer, size_t size) -> ssize_t {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < size; i++) {
+      if (queue_.size() == max_size_) not_empty_.notify_all();
+      not_full_.wait(lock, [this] { return queue_.size() < max_size_; });
+      queue_.push(buffer[i]);
+    }
+    not_empty_.notify_all();
+    return static_cast<ssize_t>(size);
+  }
+
+  auto Read(std::byte* buffer, size_t size) -> ssize_t {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t i = 0;
+    for (; i < size; ++i) {
+      if (queue_.empty()) not_full_.notify_all();
+      not_empty_.wait(lock, [this] { return !queue_.empty() || close_; });
+      if (queue_.empty()) break;
+      buffer[i] = queue_.front();
+      queue_.pop();
+    }
+    not_full_.notify_all();
+    return static_cast<ssize_t>(i);
+  }
+
+  void CloseWrite() {
+    std::unique_lock<std::mutex> const lock(mutex_);
+    close_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  std::condition_variable not_full_, not_empty_;
+  std::queue<std::byte> queue_;
+  std::mutex mutex_;
+  const size_t max_size_;
+  bool close_ = false;
+};
+
+template <typename Exchanger>
+auto PumpThroughExchanger(Exchanger& ex, const QByteArray& data,
+                          size_t chunk_size) -> QByteArray {
+  std::thread writer([&] {
+    const auto* p = reinterpret_cast<const std::byte*>(data.constData());
+    size_t offset = 0;
+    while (offset < static_cast<size_t>(data.size())) {
+      auto len =
+          std::min(chunk_size, static_cast<size_t>(data.size()) - offset);
+      if (ex.Write(p + offset, len) < 0) break;
+      offset += len;
+    }
+    ex.CloseWrite();
+  });
+
+  QByteArray out;
+  QByteArray buffer(static_cast<qsizetype>(chunk_size), '\0');
+  for (;;) {
+    auto len = ex.Read(reinterpret_cast<std::byte*>(buffer.data()),
+                       buffer.size());
+    if (len <= 0) break;
+    out.append(buffer.constData(), len);
+  }
+
+  writer.join();
+  return out;
+}
+
+auto MakePatternData(qsizetype size) -> QByteArray {
+  QByteArray data(size, '\0');
+  for (qsizetype i = 0; i < size; i++) {
+    data[i] = static_cast<char>((i * 31) % 251);
+  }
+  return data;
+}
+
+/**
+ * @brief data pumped by the throughput test, GF_TEST_BENCHMARK_EXCHANGER_MB
+ * raises it when run by hand
+ *
+ */
+auto BenchmarkDataSize() -> qsizetype {
+  bool ok = false;
+  auto mb =
+      qEnvironmentVariableIntValue("GF_TEST_BENCHMARK_EXCHANGER_MB", &ok);
+  return static_cast<qsizetype>(ok && mb > 0 ? mb : 16) * 1024 * 1024;
+}
+
+template <typename Exchanger>
+auto MeasureThroughput(Exchanger& ex, const QByteArray& data) -> double {
+  QElapsedTimer timer;
+  timer.start();
+  auto out = PumpThroughExchanger(ex, data, 64 * 1024);
+  auto elapsed = std::max<qint64>(timer.nsecsElapsed(), 1);
+  EXPECT_EQ(out, data);
+
+  return (static_cast<double>(data.size()) / (1024.0 * 1024.0)) /
+         (static_cast<double>(elapsed) / 1e9);
+}
+
+}  // namespace
+
+namespace GpgFrontend::Test {
+
+TEST(GFDataExchangerTest, RoundTripAcrossWrapAround) {
+  // odd capacity and chunk sizes force copies to split at the wrap point
+  GFDataExchanger ex(1000);
+  auto data = MakePatternData(1024 * 1024 + 7);
+  EXPECT_EQ(PumpThroughExchanger(ex, data, 777), data);
+}
+
+TEST(GFDataExchangerTest, ReadAfterCloseDrainsThenEnds) {
+  GFDataExchanger ex(16);
+  const char* hello = "hello";
+  ASSERT_EQ(ex.Write(reinterpret_cast<const std::byte*>(hello), 5), 5);
+  ex.CloseWrite();
+
+  std::array<std::byte, 16> buf;
+  EXPECT_EQ(ex.Read(buf.data(), buf.size()), 5);
+  EXPECT_EQ(ex.Read(buf.data(), buf.size()), 0);
+  EXPECT_EQ(ex.Write(reinterpret_cast<const std::byte*>(hello), 5), -1);
+}
+
+TEST(GFDataExchangerTest, Throughput) {
+  const auto size = BenchmarkDataSize();
+
+  // the per-byte reference is too slow to feed the same amount of data
+  auto legacy_data = MakePatternData(std::max<qsizetype>(size / 32, 1024));
+  ByteQueueExchanger legacy_ex(kSecBufferSizeForFile);
+  auto legacy_mbps = MeasureThroughput(legacy_ex, legacy_data);
+
+  auto data = MakePatternData(size);
+  auto ex = CreateStandardGFDataExchanger();
+  auto ring_mbps = MeasureThroughput(*ex, data);
+
+  // timings depend on the machine, only the data is checked
+  LOG_I() << "gf data exchanger throughput, per-byte queue:" << legacy_mbps
+          << "MB/s, ring buffer:" << ring_mbps << "MB/s";
+}
+
+}  // namespace GpgFrontend::Test
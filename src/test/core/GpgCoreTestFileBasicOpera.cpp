@@ -26,10 +26,13 @@
  *
  */
 
+#include <QElapsedTimer>
+
 #include "GpgCoreTest.h"
 #include "core/function/gpg/GpgFileOpera.h"
 #include "core/function/gpg/GpgKeyGetter.h"
 #include "core/model/DataObject.h"
+#include "core/model/GpgData.h"
 #include "core/model/GpgDecryptResult.h"
 #include "core/model/GpgEncryptResult.h"
 #include "core/model/GpgSignResult.h"
@@ -37,8 +40,76 @@
 #include "core/utils/GpgUtils.h"
 #include "core/utils/IOUtils.h"
 
+namespace {
+
+/**
+ * @brief size of the files used by the benchmarks, GF_TEST_BENCHMARK_FILE_MB
+ * raises it to the 1-10 GB range when run by hand
+ *
+ */
+auto BenchmarkFileSize() -> qint64 {
+  bool ok = false;
+  auto mb = qEnvironmentVariableIntValue("GF_TEST_BENCHMARK_FILE_MB", &ok);
+  return static_cast<qint64>(ok && mb > 0 ? mb : 64) * 1024 * 1024;
+}
+
+auto CreateLargeTempFile(qint64 size) -> QString {
+  auto path = GpgFrontend::GetTempFilePath();
+
+  QByteArray block(1024 * 1024, '\0');
+  for (qsizetype i = 0; i < block.size(); i++) {
+    block[i] = static_cast<char>((i * 31) % 251);
+  }
+
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) return {};
+  for (qint64 written = 0; written < size; written += block.size()) {
+    file.write(block.constData(),
+               std::min<qint64>(block.size(), size - written));
+  }
+  return path;
+}
+
+auto MeasureReadThroughput(const QString& path, bool map) -> double {
+  QElapsedTimer timer;
+  timer.start();
+
+  GpgFrontend::GpgData data(path, true, map);
+  EXPECT_EQ(data.IsMapped(), map);
+
+  qint64 total = 0;
+  std::vector<char> buf(GpgFrontend::kSecBufferSizeForFile);
+  ssize_t n;
+  while ((n = gpgme_data_read(data, buf.data(), buf.size())) > 0) total += n;
+  EXPECT_EQ(total, QFileInfo(path).size());
+
+  auto elapsed = std::max<qint64>(timer.nsecsElapsed(), 1);
+  return (static_cast<double>(total) / (1024.0 * 1024.0)) /
+         (static_cast<double>(elapsed) / 1e9);
+}
+
+}  // namespace
+
 namespace GpgFrontend::Test {
 
+TEST_F(GpgCoreTest, CoreFileMappedGpgDataTest) {
+  auto input_file = CreateTempFileAndWriteData("Hello GpgFrontend!");
+
+  GpgData mapped(input_file, true, true);
+  ASSERT_TRUE(mapped.IsMapped());
+  ASSERT_EQ(mapped.Read2GFBuffer(), GFBuffer("Hello GpgFrontend!"));
+
+  // streamed unless mapping is asked for
+  GpgData streamed(input_file, true);
+  ASSERT_FALSE(streamed.IsMapped());
+  ASSERT_EQ(streamed.Read2GFBuffer(), GFBuffer("Hello GpgFrontend!"));
+
+  // nothing to map in an empty file
+  GpgData empty(CreateTempFileAndWriteData(QString{}), true, true);
+  ASSERT_FALSE(empty.IsMapped());
+  ASSERT_TRUE(empty.Read2GFBuffer().Empty());
+}
+
 TEST_F(GpgCoreTest, CoreFileEncryptDecrTest) {
   auto encrypt_key = GpgKeyGetter::GetInstance().GetPubkeyPtr(
       "E87C6A2D8D95C818DE93B3AE6A2764F8298DEB29");
@@ -316,4 +387,87 @@ TEST_F(GpgCoreTest, CoreFileEncryptSignDecrVerifyBinaryTest) {
   ASSERT_EQ(buffer, out_buffer);
 }
 
+TEST_F(GpgCoreTest, CoreFileDigestsTest) {
+  const QStringList algorithms{"MD5", "SHA1", "SHA256"};
+  const QContainer<QCryptographicHash::Algorithm> expected_algorithms{
+      QCryptographicHash::Md5, QCryptographicHash::Sha1,
+      QCryptographicHash::Sha256};
+
+  // the small file is hashed on one thread, the large one on several
+  for (auto size : {static_cast<qint64>(1000), static_cast<qint64>(20) << 20}) {
+    auto path = CreateLargeTempFile(size);
+    QByteArray data;
+    ASSERT_TRUE(ReadFile(path, data));
+
+    auto digests = CalculateFileDigests(path, algorithms);
+    ASSERT_EQ(digests.size(), algorithms.size());
+    for (qsizetype i = 0; i < algorithms.size(); i++) {
+      EXPECT_EQ(digests[i],
+                QCryptographicHash::hash(data, expected_algorithms[i]));
+    }
+    QFile::remove(path);
+  }
+
+  EXPECT_TRUE(CalculateFileDigests(GetTempFilePath(), algorithms).isEmpty());
+  EXPECT_TRUE(
+      CalculateFileDigests(CreateTempFileAndWriteData("a"), {"NO-SUCH-MD"})
+          .isEmpty());
+}
+
+TEST_F(GpgCoreTest, CoreFileCalculateHashesTest) {
+  QTemporaryDir dir;
+  ASSERT_TRUE(dir.isValid());
+  ASSERT_TRUE(QDir(dir.path()).mkpath("sub"));
+  ASSERT_TRUE(WriteFile(dir.filePath("a.txt"), "a"));
+  ASSERT_TRUE(WriteFile(dir.filePath("sub/b.txt"), "b"));
+
+  auto result = CalculateHashes({dir.path()});
+  EXPECT_TRUE(result.contains("a.txt"));
+  EXPECT_TRUE(result.contains("b.txt"));
+  EXPECT_TRUE(result.contains(
+      QCryptographicHash::hash("b", QCryptographicHash::Sha256).toHex()));
+  EXPECT_EQ(result.count("# "), 2);
+
+  // no digests for a file that can't be read
+  auto missing = CalculateHashes({dir.filePath("missing.txt")});
+  EXPECT_TRUE(missing.contains("Error"));
+  EXPECT_FALSE(missing.contains("MD5"));
+}
+
+TEST_F(GpgCoreTest, CoreFileSignVerifyLargeBenchmark) {
+  auto sign_key = GpgKeyGetter::GetInstance().GetKeyPtr(
+      "467F14220CE8DCF780CF4BAD8465C55B25C9B7D1");
+  ASSERT_TRUE(sign_key != nullptr);
+
+  const auto size = BenchmarkFileSize();
+  auto input_file = CreateLargeTempFile(size);
+  ASSERT_FALSE(input_file.isEmpty());
+  auto output_file = GetTempFilePath();
+
+  auto stream_mbps = MeasureReadThroughput(input_file, false);
+  auto mapped_mbps = MeasureReadThroughput(input_file, true);
+
+  QElapsedTimer timer;
+  timer.start();
+  auto [err, data_object] = GpgFileOpera::GetInstance().SignFileSync(
+      {sign_key}, input_file, false, output_file);
+  auto sign_ms = timer.restart();
+  ASSERT_EQ(CheckGpgError(err), GPG_ERR_NO_ERROR);
+
+  auto [err_0, data_object_0] =
+      GpgFileOpera::GetInstance().VerifyFileSync(input_file, output_file);
+  auto verify_ms = timer.elapsed();
+  ASSERT_EQ(CheckGpgError(err_0), GPG_ERR_NO_ERROR);
+  auto verify_result = ExtractParams<GpgVerifyResult>(data_object_0, 0);
+  ASSERT_FALSE(verify_result.GetSignature().empty());
+
+  LOG_I() << "gpg data read of" << size / (1024 * 1024)
+          << "MB file, stream:" << stream_mbps
+          << "MB/s, mapped:" << mapped_mbps << "MB/s; sign:" << sign_ms
+          << "ms, verify:" << verify_ms << "ms";
+
+  QFile::remove(input_file);
+  QFile::remove(output_file);
+}
+
 }  // namespace GpgFrontend::Test
@@ -305,4 +305,131 @@ TEST(GFBufferTest, CombineSelfBuffer) {
   EXPECT_EQ(result, "abcabc");
 }
 
+TEST(GFBufferTest, ReserveKeepsContent) {
+  GFBuffer a("abc");
+  a.Reserve(1024);
+  EXPECT_GE(a.Capacity(), 1024);
+  EXPECT_EQ(a, "abc");
+
+  // appending within the capacity doesn't move the data
+  const auto* data = a.Data();
+  a.Append("def", 3);
+  EXPECT_EQ(a.Data(), data);
+  EXPECT_EQ(a, "abcdef");
+}
+
+TEST(GFBufferTest, AppendGrowsGeometrically) {
+  GFBuffer a;
+  int reallocations = 0;
+  size_t capacity = a.Capacity();
+
+  constexpr int kAppends = 100000;
+  for (int i = 0; i < kAppends; ++i) {
+    a.Append("0123456789", 10);
+    if (a.Capacity() != capacity) {
+      reallocations++;
+      capacity = a.Capacity();
+    }
+  }
+
+  EXPECT_EQ(a.Size(), static_cast<size_t>(kAppends) * 10);
+  EXPECT_LT(reallocations, 40);
+  EXPECT_EQ(memcmp(a.Data() + a.Size() - 10, "0123456789", 10), 0);
+}
+
+TEST(GFBufferTest, ShrinkToFit) {
+  GFBuffer a("abc");
+  a.Reserve(4096);
+  a.ShrinkToFit();
+  EXPECT_EQ(a.Capacity(), a.Size());
+  EXPECT_EQ(a, "abc");
+
+  a.Resize(0);
+  a.ShrinkToFit();
+  EXPECT_EQ(a.Capacity(), 0);
+}
+
+TEST(GFBufferTest, ResizeWithinCapacityClearsTail) {
+  GFBuffer a("secretdata");
+  a.Resize(3);
+  a.Resize(10);
+  EXPECT_EQ(memcmp(a.Data(), "sec", 3), 0);
+  for (size_t i = 3; i < a.Size(); ++i) EXPECT_EQ(a.Data()[i], 0);
+}
+
+TEST(GFBufferTest, SlicesShareStorage) {
+  GFBuffer a(QByteArray(1024 * 1024, 'x'));
+  const auto before = GFBuffer::GetStatistics();
+
+  const auto left = a.Left(4096);
+  const auto mid = a.Mid(4096, 64 * 1024);
+  const auto right = a.Right(512);
+  const auto copy = a;
+
+  const auto after = GFBuffer::GetStatistics();
+  EXPECT_EQ(after.allocations, before.allocations);
+  EXPECT_EQ(after.copied_bytes, before.copied_bytes);
+
+  const auto& c_a = a;
+  EXPECT_EQ(left.Data(), c_a.Data());
+  EXPECT_EQ(mid.Data(), c_a.Data() + 4096);
+  EXPECT_EQ(right.Data(), c_a.Data() + a.Size() - 512);
+  EXPECT_EQ(left.Size(), 4096);
+  EXPECT_EQ(mid.Size(), 64 * 1024);
+  EXPECT_EQ(right.Size(), 512);
+  EXPECT_EQ(copy, a);
+}
+
+TEST(GFBufferTest, WritingToSliceCopiesOnlyTheSlice) {
+  GFBuffer a("0123456789");
+  auto mid = a.Mid(2, 4);
+  const auto before = GFBuffer::GetStatistics();
+
+  mid.Data()[0] = 'x';
+
+  const auto after = GFBuffer::GetStatistics();
+  EXPECT_EQ(after.allocations - before.allocations, 1);
+  EXPECT_EQ(after.copied_bytes - before.copied_bytes, mid.Size());
+  EXPECT_EQ(mid, "x345");
+  EXPECT_EQ(a, "0123456789");
+
+  // the slice owns its storage now, further writes copy nothing
+  mid.Data()[1] = 'y';
+  mid.Append("z", 1);
+  EXPECT_EQ(GFBuffer::GetStatistics().copied_bytes, after.copied_bytes);
+  EXPECT_EQ(mid, "xy45z");
+}
+
+TEST(GFBufferTest, WritingToParentKeepsSlice) {
+  GFBuffer a("0123456789");
+  const auto right = a.Right(3);
+  GFBuffer b = a;
+
+  a.Data()[9] = 'x';
+  a.Resize(4);
+  EXPECT_EQ(a, "0123");
+  EXPECT_EQ(b, "0123456789");
+  EXPECT_EQ(right, "789");
+}
+
+TEST(GFBufferTest, AppendToSlice) {
+  GFBuffer a("hello world");
+  auto hello = a.Left(5);
+  hello.Append("!", 1);
+  EXPECT_EQ(hello, "hello!");
+  EXPECT_EQ(a, "hello world");
+
+  auto tail = a.Right(5);
+  tail.Resize(2);
+  EXPECT_EQ(tail, "wo");
+  EXPECT_EQ(a, "hello world");
+}
+
+TEST(GFBufferTest, ZeroizeWipesSharedStorage) {
+  GFBuffer a("secret");
+  const auto view = a.Left(3);
+  a.Zeroize();
+  for (size_t i = 0; i < view.Size(); ++i) EXPECT_EQ(view.Data()[i], 0);
+}
+
 }  // namespace GpgFrontend::Test
\ No newline at end of file
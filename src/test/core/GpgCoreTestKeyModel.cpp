@@ -28,6 +28,12 @@
 
 #include <gtest/gtest.h>
 
+#include <QElapsedTimer>
+#include <QThread>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "GpgCoreTest.h"
 #include "core/function/gpg/GpgContext.h"
 #include "core/function/gpg/GpgKeyGetter.h"
@@ -191,4 +197,62 @@ TEST_F(GpgCoreTest, GpgKeyGetterTest) {
   ASSERT_TRUE(std::find(keys.begin(), keys.end(), key) != keys.end());
 }
 
+TEST_F(GpgCoreTest, GpgKeyCacheUpdateTest) {
+  auto& key_getter = GpgKeyGetter::GetInstance(kGpgFrontendDefaultChannel);
+
+  auto keys = key_getter.UpdateKeyCache(
+      {"9490795B78F8AFE9F93BD09281704859182661FB",
+       "0000000000000000000000000000000000000000"});
+  ASSERT_EQ(keys.size(), 1);
+  ASSERT_EQ(keys.front()->Fingerprint(),
+            "9490795B78F8AFE9F93BD09281704859182661FB");
+
+  // the patched key is served from the cache by both id and fingerprint
+  auto key = key_getter.GetKeyPtr("9490795B78F8AFE9F93BD09281704859182661FB");
+  ASSERT_TRUE(key != nullptr);
+  ASSERT_EQ(key.get(), keys.front().get());
+  ASSERT_EQ(key_getter.GetKeyPtr(key->ID()).get(), keys.front().get());
+}
+
+TEST_F(GpgCoreTest, GpgKeyLookupThroughputTest) {
+  auto& key_getter = GpgKeyGetter::GetInstance(kGpgFrontendDefaultChannel);
+
+  auto key_ids = QStringList{};
+  for (const auto& key : key_getter.Fetch()) {
+    key_ids.append(key->ID());
+    key_ids.append(key->Fingerprint());
+  }
+  ASSERT_FALSE(key_ids.isEmpty());
+
+  const int readers = std::max(4, QThread::idealThreadCount());
+  const int lookups_per_reader = 200000;
+  std::atomic_int misses{0};
+
+  QElapsedTimer timer;
+  timer.start();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < readers; i++) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < lookups_per_reader; j++) {
+        const auto& key_id = key_ids[(i + j) % key_ids.size()];
+        if (key_getter.GetKeyORSubkeyPtr(key_id) == nullptr) misses++;
+      }
+    });
+  }
+
+  // republish the index a few times while the readers are running
+  for (int i = 0; i < 3; i++) key_getter.FlushKeyCache();
+
+  for (auto& thread : threads) thread.join();
+
+  auto elapsed = std::max<qint64>(timer.nsecsElapsed(), 1);
+  auto lookups = static_cast<double>(readers) * lookups_per_reader;
+
+  LOG_I() << "key lookup throughput with" << readers
+          << "readers:" << lookups / (static_cast<double>(elapsed) / 1e9)
+          << "lookups/s";
+  ASSERT_EQ(misses, 0);
+}
+
 }  // namespace GpgFrontend::Test
\ No newline at end of file
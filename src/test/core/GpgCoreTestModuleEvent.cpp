@@ -0,0 +1,359 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "GpgCoreTest.h"
+#include "core/function/GlobalSettingStation.h"
+#include "core/module/Event.h"
+#include "core/module/GlobalModuleContext.h"
+#include "core/module/Module.h"
+#include "core/thread/TaskRunnerGetter.h"
+#include "sdk/GFSDKModuleModel.h"
+
+namespace {
+
+using GpgFrontend::Module::EventReference;
+
+auto WaitFor(const std::function<bool()>& done, int timeout_ms = 30000)
+    -> bool {
+  QElapsedTimer timer;
+  timer.start();
+  while (!done()) {
+    if (timer.elapsed() > timeout_ms) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+/**
+ * @brief records the sequence numbers of the events it gets
+ *
+ */
+class RecordingModule : public GpgFrontend::Module::Module {
+ public:
+  explicit RecordingModule(const QString& id, int delay_ms = 0,
+                           bool parallel = false)
+      : Module(id, "1.0.0",
+               parallel ? GpgFrontend::Module::ModuleMetaData{{"Dispatch",
+                                                               "parallel"}}
+                        : GpgFrontend::Module::ModuleMetaData{}),
+        delay_ms_(delay_ms) {}
+
+  auto Register() -> int override { return 0; }
+
+  auto Active() -> int override { return 0; }
+
+  auto Deactivate() -> int override { return 0; }
+
+  auto Exec(EventReference event) -> int override {
+    if (delay_ms_ > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+    }
+
+    auto seq = (*event)["seq"];
+    std::lock_guard lock(lock_);
+    seen_.push_back(
+        seq ? std::any_cast<GpgFrontend::GFBuffer>(*seq).ConvertToQByteArray()
+                  .toInt()
+            : -1);
+    count_++;
+    return 0;
+  }
+
+  [[nodiscard]] auto Count() const -> int { return count_; }
+
+  auto Seen() -> QContainer<int> {
+    std::lock_guard lock(lock_);
+    return seen_;
+  }
+
+ private:
+  int delay_ms_;
+  std::atomic_int count_{0};
+  std::mutex lock_;
+  QContainer<int> seen_;
+};
+
+/**
+ * @brief records the calls it gets, started only by the events it lists in
+ * its meta data
+ *
+ */
+class LazyModule : public GpgFrontend::Module::Module {
+ public:
+  explicit LazyModule(const QString& id, const QString& events)
+      : Module(id, "1.0.0",
+               GpgFrontend::Module::ModuleMetaData{{"ListenEvents", events}}) {
+  }
+
+  auto Register() -> int override { return 0; }
+
+  auto Active() -> int override {
+    record("active");
+    return 0;
+  }
+
+  auto Exec(EventReference) -> int override {
+    record("exec");
+    return 0;
+  }
+
+  auto Deactivate() -> int override {
+    record("deactivate");
+    return 0;
+  }
+
+  auto Calls() -> QStringList {
+    std::lock_guard lock(lock_);
+    return calls_;
+  }
+
+ private:
+  std::mutex lock_;
+  QStringList calls_;
+
+  void record(const QString& call) {
+    std::lock_guard lock(lock_);
+    calls_.append(call);
+  }
+};
+
+/**
+ * @brief sets a setting for the life of the guard
+ *
+ */
+class ScopedSetting {
+ public:
+  ScopedSetting(QString key, const QVariant& value) : key_(std::move(key)) {
+    auto settings = GpgFrontend::GetSettings();
+    old_ = settings.value(key_);
+    settings.setValue(key_, value);
+  }
+
+  ~ScopedSetting() {
+    auto settings = GpgFrontend::GetSettings();
+    if (old_.isValid()) {
+      settings.setValue(key_, old_);
+    } else {
+      settings.remove(key_);
+    }
+  }
+
+ private:
+  QString key_;
+  QVariant old_;
+};
+
+auto MakeSeqEvent(const QString& event_id, int seq) -> EventReference {
+  return GpgFrontend::Module::MakeEvent(
+      event_id, {{"seq", GpgFrontend::GFBuffer(QString::number(seq))}},
+      nullptr);
+}
+
+}  // namespace
+
+namespace GpgFrontend::Test {
+
+TEST(ModuleEventTest, KeepsEventOrderPerModule) {
+  constexpr int kModules = 4;
+  constexpr int kEvents = 1000;
+
+  // serial and parallel modules alike
+  Module::GlobalModuleContext gmc;
+  QContainer<QSharedPointer<RecordingModule>> modules;
+  for (int i = 0; i < kModules; i++) {
+    auto module = SecureCreateSharedObject<RecordingModule>(
+        QString("com.gpgfrontend.test.order_%1").arg(i), 0, i % 2 == 1);
+    ASSERT_TRUE(gmc.RegisterModule(module, false));
+    ASSERT_TRUE(gmc.ActiveModule(module->GetModuleIdentifier()));
+    ASSERT_TRUE(gmc.ListenEvent(module->GetModuleIdentifier(), "TEST_ORDER"));
+    modules.push_back(module);
+  }
+
+  for (int i = 0; i < kEvents; i++) {
+    ASSERT_TRUE(gmc.TriggerEvent(MakeSeqEvent("TEST_ORDER", i)));
+  }
+
+  ASSERT_TRUE(WaitFor([&]() {
+    return std::all_of(modules.cbegin(), modules.cend(),
+                       [](const auto& m) { return m->Count() == kEvents; });
+  }));
+
+  for (const auto& module : modules) {
+    auto seen = module->Seen();
+    ASSERT_EQ(seen.size(), kEvents);
+    for (int i = 0; i < kEvents; i++) EXPECT_EQ(seen[i], i);
+  }
+}
+
+TEST(ModuleEventTest, SlowModuleDoesNotDelayOthers) {
+  if (Thread::TaskRunnerGetter::GetWorkerCount(
+          Thread::TaskRunnerGetter::kTaskRunnerType_Default) < 2) {
+    GTEST_SKIP() << "needs a parallel default runner";
+  }
+  constexpr int kEvents = 20;
+
+  Module::GlobalModuleContext gmc;
+  auto slow = SecureCreateSharedObject<RecordingModule>(
+      "com.gpgfrontend.test.slow", 20, true);
+  auto fast = SecureCreateSharedObject<RecordingModule>(
+      "com.gpgfrontend.test.fast", 0, true);
+  for (const auto& module : {slow, fast}) {
+    ASSERT_TRUE(gmc.RegisterModule(module, false));
+    ASSERT_TRUE(gmc.ActiveModule(module->GetModuleIdentifier()));
+    ASSERT_TRUE(gmc.ListenEvent(module->GetModuleIdentifier(), "TEST_SLOW"));
+  }
+
+  for (int i = 0; i < kEvents; i++) {
+    ASSERT_TRUE(gmc.TriggerEvent(MakeSeqEvent("TEST_SLOW", i)));
+  }
+
+  ASSERT_TRUE(WaitFor([&]() { return fast->Count() == kEvents; }));
+  EXPECT_LT(slow->Count(), kEvents);
+
+  ASSERT_TRUE(WaitFor([&]() { return slow->Count() == kEvents; }));
+}
+
+TEST(ModuleEventTest, RunsOnModuleRunnerUnlessParallel) {
+  Module::GlobalModuleContext gmc;
+  auto serial =
+      SecureCreateSharedObject<RecordingModule>("com.gpgfrontend.test.serial");
+  auto parallel = SecureCreateSharedObject<RecordingModule>(
+      "com.gpgfrontend.test.parallel", 0, true);
+  for (const auto& module : {serial, parallel}) {
+    ASSERT_TRUE(gmc.RegisterModule(module, false));
+  }
+
+  auto& getter = Thread::TaskRunnerGetter::GetInstance();
+  EXPECT_EQ(gmc.GetTaskRunner(serial->GetModuleIdentifier()),
+            getter.GetTaskRunner(
+                Thread::TaskRunnerGetter::kTaskRunnerType_Module));
+  EXPECT_EQ(gmc.GetTaskRunner(parallel->GetModuleIdentifier()),
+            getter.GetTaskRunner(
+                Thread::TaskRunnerGetter::kTaskRunnerType_Default));
+}
+
+TEST(ModuleEventTest, LazyModuleStartsOnEventAndStopsWhenIdle) {
+  const ScopedSetting lazy("module/lazy_activation", true);
+  const ScopedSetting idle("module/idle_deactivate_seconds", 1);
+
+  Module::GlobalModuleContext gmc;
+  auto module = SecureCreateSharedObject<LazyModule>(
+      "com.gpgfrontend.test.lazy", "TEST_LAZY");
+  const auto id = module->GetModuleIdentifier();
+  ASSERT_TRUE(gmc.RegisterModule(module, false));
+  ASSERT_TRUE(gmc.ActivateModuleOnDemand(id));
+
+  // listening, but not started before its first event
+  EXPECT_TRUE(gmc.IsModuleActivated(id));
+  EXPECT_TRUE(gmc.GetModuleListening(id).contains("TEST_LAZY"));
+  EXPECT_TRUE(module->Calls().isEmpty());
+
+  ASSERT_TRUE(gmc.TriggerEvent(MakeSeqEvent("TEST_LAZY", 0)));
+  ASSERT_TRUE(WaitFor([&]() { return module->Calls().size() >= 2; }));
+  EXPECT_EQ(module->Calls().mid(0, 2), QStringList({"active", "exec"}));
+
+  // no event for the idle timeout, the sweep stops it
+  ASSERT_TRUE(WaitFor([&]() { return module->Calls().size() >= 3; }));
+  EXPECT_EQ(module->Calls(), QStringList({"active", "exec", "deactivate"}));
+  EXPECT_TRUE(gmc.IsModuleActivated(id));
+
+  // the next event starts it again
+  ASSERT_TRUE(gmc.TriggerEvent(MakeSeqEvent("TEST_LAZY", 1)));
+  ASSERT_TRUE(WaitFor([&]() { return module->Calls().size() >= 5; }));
+  EXPECT_EQ(module->Calls().mid(3, 2), QStringList({"active", "exec"}));
+}
+
+TEST(ModuleEventTest, SharesParamBlockAcrossListeners) {
+  const GFBuffer payload(QByteArray(1024 * 1024, 's'));
+  auto event = Module::MakeEvent("TEST_PARAMS", {{"signature", payload}},
+                                 nullptr);
+
+  auto block = event->GetParamBlock();
+  ASSERT_EQ(block->params.size(), 1);
+  const auto* value = block->Find("signature");
+  ASSERT_NE(value, nullptr);
+
+  // the block shares the bytes of the event, nothing was copied
+  EXPECT_EQ(value->Data(), payload.Data());
+  EXPECT_EQ(event->GetParamBlock(), block);
+
+  // modules reading the block get no copies in their event
+  auto* module_event = event->ToModuleEvent(false);
+  EXPECT_EQ(module_event->params, nullptr);
+  SMAFree(const_cast<char*>(module_event->id));
+  SMAFree(const_cast<char*>(module_event->trigger_id));
+  SMAFree(module_event);
+
+  // a block taken before stays as it was
+  event->AddParameter("extra", GFBuffer(QString("x")));
+  EXPECT_EQ(event->GetParamBlock()->params.size(), 2);
+  EXPECT_EQ(block->params.size(), 1);
+}
+
+TEST(ModuleEventTest, ThroughputBenchmark) {
+  const auto events =
+      qEnvironmentVariableIsSet("GF_TEST_BENCHMARK_MODULE_EVENTS")
+          ? qEnvironmentVariableIntValue("GF_TEST_BENCHMARK_MODULE_EVENTS")
+          : 20000;
+  constexpr int kModules = 8;
+
+  Module::GlobalModuleContext gmc;
+  QContainer<QSharedPointer<RecordingModule>> modules;
+  for (int i = 0; i < kModules; i++) {
+    auto module = SecureCreateSharedObject<RecordingModule>(
+        QString("com.gpgfrontend.test.bench_%1").arg(i), 0, true);
+    ASSERT_TRUE(gmc.RegisterModule(module, false));
+    ASSERT_TRUE(gmc.ActiveModule(module->GetModuleIdentifier()));
+    ASSERT_TRUE(gmc.ListenEvent(module->GetModuleIdentifier(), "TEST_BENCH"));
+    modules.push_back(module);
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < events; i++) {
+    gmc.TriggerEvent(MakeSeqEvent("TEST_BENCH", i));
+  }
+  ASSERT_TRUE(WaitFor([&]() {
+    return std::all_of(modules.cbegin(), modules.cend(),
+                       [&](const auto& m) { return m->Count() == events; });
+  }));
+  const auto elapsed_ms = std::max<qint64>(timer.elapsed(), 1);
+
+  LOG_I() << "module event dispatch:" << events << "events to" << kModules
+          << "modules in" << elapsed_ms << "ms,"
+          << events * 1000 / elapsed_ms << "events/s";
+}
+
+}  // namespace GpgFrontend::Test
@@ -0,0 +1,122 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include "GpgCoreTest.h"
+#include "core/function/GlobalSettingStation.h"
+#include "core/module/Module.h"
+#include "core/module/ModuleManager.h"
+
+namespace {
+
+using GpgFrontend::Module::ModulePtr;
+
+auto MakeModule(const QString& id, const QString& dependencies = {})
+    -> ModulePtr {
+  GpgFrontend::Module::ModuleMetaData meta_data;
+  if (!dependencies.isEmpty()) meta_data["Dependencies"] = dependencies;
+  return GpgFrontend::SecureCreateSharedObject<GpgFrontend::Module::Module>(
+      id, "1.0.0", meta_data);
+}
+
+auto Ids(const GpgFrontend::QContainer<ModulePtr>& modules) -> QStringList {
+  QStringList ids;
+  for (const auto& module : modules) ids.append(module->GetModuleIdentifier());
+  return ids;
+}
+
+}  // namespace
+
+namespace GpgFrontend::Test {
+
+TEST(ModuleManagerTest, SortsDependencyChain) {
+  const auto sorted = Module::SortModulesByDependencies({
+      MakeModule("com.gpgfrontend.test.c", "com.gpgfrontend.test.b"),
+      MakeModule("com.gpgfrontend.test.b", " com.gpgfrontend.test.a "),
+      MakeModule("com.gpgfrontend.test.a"),
+  });
+
+  EXPECT_EQ(Ids(sorted),
+            QStringList({"com.gpgfrontend.test.a", "com.gpgfrontend.test.b",
+                         "com.gpgfrontend.test.c"}));
+}
+
+TEST(ModuleManagerTest, IgnoresDependenciesOutsideTheBatch) {
+  // a dependency that isn't loaded here doesn't hold the module back
+  const auto sorted = Module::SortModulesByDependencies({
+      MakeModule("com.gpgfrontend.test.a",
+                 "com.gpgfrontend.test.missing,com.gpgfrontend.test.b"),
+      MakeModule("com.gpgfrontend.test.b", "com.gpgfrontend.test.missing"),
+      MakeModule("com.gpgfrontend.test.c"),
+  });
+
+  EXPECT_EQ(Ids(sorted),
+            QStringList({"com.gpgfrontend.test.b", "com.gpgfrontend.test.c",
+                         "com.gpgfrontend.test.a"}));
+}
+
+TEST(ModuleManagerTest, PutsDependencyCycleLast) {
+  const auto sorted = Module::SortModulesByDependencies({
+      MakeModule("com.gpgfrontend.test.x", "com.gpgfrontend.test.y"),
+      MakeModule("com.gpgfrontend.test.y", "com.gpgfrontend.test.x"),
+      MakeModule("com.gpgfrontend.test.z", "com.gpgfrontend.test.w"),
+      MakeModule("com.gpgfrontend.test.w"),
+  });
+
+  EXPECT_EQ(Ids(sorted),
+            QStringList({"com.gpgfrontend.test.w", "com.gpgfrontend.test.z",
+                         "com.gpgfrontend.test.x", "com.gpgfrontend.test.y"}));
+}
+
+TEST(ModuleManagerTest, HonoursParallelLoadingSetting) {
+  auto settings = GetSettings();
+  const auto old = settings.value("module/parallel_loading");
+
+  for (const auto parallel : {false, true}) {
+    settings.setValue("module/parallel_loading", parallel);
+    settings.sync();
+
+    // libraries that can't be loaded leave nothing to register
+    Module::ModuleManager manager(kGpgFrontendDefaultChannel + 64);
+    EXPECT_EQ(manager.LoadModules({{"/nonexistent/libgf_test_a.so", false},
+                                   {"/nonexistent/libgf_test_b.so", true}}),
+              0);
+
+    auto value = manager.RetrieveRTValue("core", "module.startup.parallel");
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(std::any_cast<bool>(value.value()), parallel);
+    EXPECT_TRUE(manager.ListAllRegisteredModuleID().isEmpty());
+  }
+
+  if (old.isValid()) {
+    settings.setValue("module/parallel_loading", old);
+  } else {
+    settings.remove("module/parallel_loading");
+  }
+}
+
+}  // namespace GpgFrontend::Test
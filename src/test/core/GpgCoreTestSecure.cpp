@@ -26,10 +26,19 @@
  *
  */
 
+#include <openssl/crypto.h>
+
+#include <QElapsedTimer>
+#include <array>
+#include <thread>
+#include <vector>
+
 #include "GpgCoreTest.h"
 #include "core/function/AESCryptoHelper.h"
 #include "core/function/GFBufferFactory.h"
 #include "core/function/SecureRandomGenerator.h"
+#include "core/model/GFDataExchanger.h"
+#include "core/utils/IOUtils.h"
 
 namespace GpgFrontend::Test {
 
@@ -122,6 +131,34 @@ TEST(SecureMemoryAllocatorTest, SecDoubleFreeShouldWarn) {
 #endif
 }
 
+TEST(SecureMemoryAllocatorTest, PowerOfTwoSecureBlocksKeepTheirSize) {
+  const auto secure_level = qApp->property("GFSecureLevel").toInt();
+  // only secure level 2 allocates from the OpenSSL secure heap
+  if (secure_level < 2 || CRYPTO_secure_malloc_initialized() == 0) return;
+
+  // the buddy allocator behind the secure heap rounds up to a power of two,
+  // a header on top of a power of two request used to double it
+  constexpr int kBlocks = 64;
+  std::vector<void*> blocks;
+  const auto before = CRYPTO_secure_used();
+  for (int i = 0; i < kBlocks; ++i) blocks.push_back(SMASecMalloc(4096));
+  const auto pooled = CRYPTO_secure_used() - before;
+  for (auto* ptr : blocks) SMASecFree(ptr);
+  EXPECT_LT(pooled, static_cast<size_t>(kBlocks) * 6144);
+
+  constexpr size_t kRingSize = 4 * 1024 * 1024;
+  const auto used = CRYPTO_secure_used();
+  auto* ring = SMASecMalloc(kRingSize);
+  ASSERT_NE(ring, nullptr);
+  EXPECT_LT(CRYPTO_secure_used() - used, 2 * kRingSize);
+  memset(ring, 0xAB, kRingSize);
+
+  ring = SMASecRealloc(ring, kRingSize / 2);
+  ASSERT_NE(ring, nullptr);
+  EXPECT_EQ(static_cast<unsigned char*>(ring)[kRingSize / 2 - 1], 0xAB);
+  SMASecFree(ring);
+}
+
 TEST(SecureMemoryAllocatorTest, ParallelAllocAndFree) {
   constexpr int kThreads = 8;
   constexpr int kIters = 100;
@@ -156,6 +193,66 @@ TEST(SecureMemoryAllocatorTest, ParallelSecAllocAndFree) {
   for (auto& t : threads) t.join();
 }
 
+TEST(SecureMemoryAllocatorTest, ReusedBlocksAreZeroed) {
+  const auto secure_level = qApp->property("GFSecureLevel").toInt();
+  // do not test for normal malloc()
+  if (secure_level < 1) return;
+
+  for (int i = 0; i < 4; ++i) {
+    auto* ptr = static_cast<unsigned char*>(SMASecMalloc(100));
+    ASSERT_NE(ptr, nullptr);
+    for (int j = 0; j < 100; ++j) ASSERT_EQ(ptr[j], 0);
+    memset(ptr, 0xEF, 100);
+    SMASecFree(ptr);
+  }
+}
+
+TEST(SecureMemoryAllocatorTest, FreeOnAnotherThread) {
+  constexpr int kBlocks = 1000;
+  std::vector<void*> blocks;
+  blocks.reserve(kBlocks);
+  for (int i = 0; i < kBlocks; ++i) blocks.push_back(SMAMalloc(16 + i));
+
+  std::thread([&]() {
+    for (auto* ptr : blocks) SMAFree(ptr);
+  }).join();
+}
+
+TEST(SecureMemoryAllocatorTest, ContentionAcross16Threads) {
+  constexpr int kThreads = 16;
+  constexpr int kIters = 100000;
+  constexpr int kLive = 32;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  std::vector<std::thread> threads;
+  threads.reserve(kThreads);
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([i]() {
+      std::array<void*, kLive> live{};
+      for (int j = 0; j < kIters; ++j) {
+        auto& slot = live[j % kLive];
+        if (slot != nullptr) SMASecFree(slot);
+
+        // a mix of GFBuffer and object sized requests
+        const auto size = static_cast<size_t>(16 + ((j * 37 + i) % 2048));
+        slot = SMASecMalloc(size);
+        ASSERT_NE(slot, nullptr);
+        memset(slot, 0xCD, size);
+      }
+      for (auto* ptr : live) SMASecFree(ptr);
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  auto elapsed = std::max<qint64>(timer.nsecsElapsed(), 1);
+  LOG_I() << "secure allocator with" << kThreads << "threads:"
+          << static_cast<double>(kThreads) * kIters /
+                 (static_cast<double>(elapsed) / 1e9)
+          << "alloc/free pairs per second";
+}
+
 TEST_F(GpgCoreTest, CoreSecureTestA) {
   auto buffer = SecureRandomGenerator::GetInstance().GnuPGGenerateZBase32();
   ASSERT_TRUE(buffer.has_value());
@@ -287,4 +384,75 @@ TEST(GFBufferFactoryTest, ToFileAndFromFile) {
   // Cleanup
   QFile::remove(path);
 }
+TEST(GFBufferFactoryTest, EncryptStreamAndDecryptStream) {
+  GFBuffer pass("streampw");
+
+  // cover the empty stream, a short chunk and an exact multiple of chunks
+  for (const size_t size :
+       {size_t{0}, size_t{1000}, 2 * AESCryptoHelper::kStreamChunkSize,
+        3 * AESCryptoHelper::kStreamChunkSize + 17}) {
+    GFBuffer plain(size);
+    for (size_t i = 0; i < size; i++) plain.Data()[i] = static_cast<char>(i);
+
+    GFBuffer enc;
+    ASSERT_TRUE(GFBufferFactory::EncryptLiteStream(
+        pass, MakeStreamReader(plain), MakeStreamWriter(enc)));
+    EXPECT_TRUE(GFBufferFactory::IsEncryptedStream(enc));
+
+    GFBuffer dec;
+    ASSERT_TRUE(GFBufferFactory::DecryptStream(pass, MakeStreamReader(enc),
+                                               MakeStreamWriter(dec)));
+    EXPECT_EQ(dec, plain);
+  }
+}
+
+TEST(GFBufferFactoryTest, DecryptStreamRejectsTampering) {
+  GFBuffer pass("streampw");
+  GFBuffer plain(2 * AESCryptoHelper::kStreamChunkSize + 5);
+
+  GFBuffer enc;
+  ASSERT_TRUE(GFBufferFactory::EncryptStream(pass, MakeStreamReader(plain),
+                                             MakeStreamWriter(enc)));
+
+  // a flipped bit in the last tag
+  auto flipped = enc.Left(static_cast<ssize_t>(enc.Size()));
+  flipped.Data()[flipped.Size() - 1] ^= 1;
+  GFBuffer dec;
+  EXPECT_FALSE(GFBufferFactory::DecryptStream(
+      pass, MakeStreamReader(flipped), MakeStreamWriter(dec)));
+
+  // the last chunk is dropped
+  auto truncated = enc.Left(static_cast<ssize_t>(
+      enc.Size() - (4 + 5 + 16)));  // frame length, plaintext and tag
+  dec = GFBuffer{};
+  EXPECT_FALSE(GFBufferFactory::DecryptStream(
+      pass, MakeStreamReader(truncated), MakeStreamWriter(dec)));
+
+  // a wrong passphrase
+  dec = GFBuffer{};
+  EXPECT_FALSE(GFBufferFactory::DecryptStream(
+      GFBuffer("wrongpw"), MakeStreamReader(enc), MakeStreamWriter(dec)));
+}
+
+TEST(GFBufferFactoryTest, EncryptStreamThroughExchanger) {
+  GFBuffer pass("streampw");
+  GFBuffer plain(5 * AESCryptoHelper::kStreamChunkSize + 3);
+  for (size_t i = 0; i < plain.Size(); i++) {
+    plain.Data()[i] = static_cast<char>(i * 31);
+  }
+
+  // the producer blocks on the bounded exchanger until the consumer reads
+  auto ex = CreateStandardGFDataExchanger();
+  std::thread producer([&]() {
+    EXPECT_TRUE(GFBufferFactory::EncryptStream(pass, MakeStreamReader(plain),
+                                               MakeStreamWriter(ex)));
+    ex->CloseWrite();
+  });
+
+  GFBuffer dec;
+  EXPECT_TRUE(GFBufferFactory::DecryptStream(pass, MakeStreamReader(ex),
+                                             MakeStreamWriter(dec)));
+  producer.join();
+  EXPECT_EQ(dec, plain);
+}
 }  // namespace GpgFrontend::Test
\ No newline at end of file
@@ -0,0 +1,603 @@
+/**
+ * Copyright (C) 2021-2024 Saturneric <eric@bktus.com>
+ *
+ * This file is part of GpgFrontend.
+ *
+ * GpgFrontend is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * GpgFrontend is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GpgFrontend. If not, see <https://www.gnu.org/licenses/>.
+ *
+ * The initial version of the source code is inherited from
+ * the gpg4usb project, which is under GPL-3.0-or-later.
+ *
+ * All the source code of GpgFrontend was modified and released by
+ * Saturneric <eric@bktus.com> starting on May 12, 2021.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "GpgCoreTest.h"
+#include "core/thread/CancellationToken.h"
+#include "core/thread/Task.h"
+#include "core/thread/TaskMetrics.h"
+#include "core/thread/TaskRunner.h"
+#include "core/thread/TaskScheduler.h"
+#include "core/thread/WorkStealingExecutor.h"
+
+namespace {
+
+auto WaitFor(const std::function<bool()>& done, int timeout_ms = 10000)
+    -> bool {
+  QElapsedTimer timer;
+  timer.start();
+  while (!done()) {
+    if (timer.elapsed() > timeout_ms) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace GpgFrontend::Test {
+
+TEST(WorkStealingExecutorTest, RunsAllJobs) {
+  constexpr int kJobs = 10000;
+  std::atomic<int> count{0};
+
+  Thread::WorkStealingExecutor ex("test", 4);
+  ASSERT_EQ(ex.WorkerCount(), 4);
+
+  // half of the jobs are spawned by a worker, into its own deque
+  ex.Submit([&]() {
+    EXPECT_TRUE(ex.IsWorkerThread());
+    for (int i = 0; i < kJobs; i++) ex.Submit([&]() { count++; });
+  });
+  for (int i = 0; i < kJobs; i++) ex.Submit([&]() { count++; });
+
+  ASSERT_TRUE(WaitFor([&]() { return count == 2 * kJobs; }));
+  EXPECT_FALSE(ex.IsWorkerThread());
+  ex.Shutdown();
+}
+
+TEST(WorkStealingExecutorTest, IdleWorkersSteal) {
+  std::atomic<int> count{0};
+  std::mutex lock;
+  std::set<std::thread::id> threads;
+
+  Thread::WorkStealingExecutor ex("test", 4);
+  ex.Submit([&]() {
+    // all of them land in the deque of this worker
+    for (int i = 0; i < 64; i++) {
+      ex.Submit([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        {
+          std::lock_guard<std::mutex> guard(lock);
+          threads.insert(std::this_thread::get_id());
+        }
+        count++;
+      });
+    }
+  });
+
+  ASSERT_TRUE(WaitFor([&]() { return count == 64; }));
+  ex.Shutdown();
+
+  EXPECT_GT(ex.StolenJobs(), 0);
+  EXPECT_GT(threads.size(), 1);
+}
+
+TEST(WorkStealingExecutorTest, ShutdownRunsQueuedJobs) {
+  std::atomic<int> count{0};
+  {
+    Thread::WorkStealingExecutor ex("test", 2);
+    for (int i = 0; i < 100; i++) {
+      ex.Submit([&]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        count++;
+      });
+    }
+  }
+  EXPECT_EQ(count, 100);
+
+  Thread::WorkStealingExecutor ex("test", 1);
+  ex.Shutdown();
+  ex.Submit([&]() { count++; });
+  EXPECT_EQ(count, 100);
+}
+
+TEST(WorkStealingExecutorTest, NoJobIsStrandedBySubmitDuringShutdown) {
+  for (int round = 0; round < 20; round++) {
+    std::atomic<int> ran{0};
+    auto token = std::make_shared<int>(0);
+
+    Thread::WorkStealingExecutor ex("test", 2);
+    std::thread submitter([&]() {
+      for (int i = 0; i < 1000; i++) {
+        ex.Submit([&ran, token]() { ran++; });
+      }
+    });
+    ex.Shutdown();
+    submitter.join();
+
+    // every job either ran or was refused, none waits in a deque
+    EXPECT_EQ(token.use_count(), 1);
+    EXPECT_LE(ran, 1000);
+  }
+}
+
+TEST(WorkStealingExecutorTest, TaskRunnerDispatchesToExecutor) {
+  constexpr int kTasks = 16;
+  std::atomic<int> count{0};
+  std::mutex lock;
+  std::set<QThread*> threads;
+
+  Thread::TaskRunner runner(4);
+  runner.Start();
+  ASSERT_NE(runner.GetExecutor(), nullptr);
+
+  for (int i = 0; i < kTasks; i++) {
+    runner.PostTask(new Thread::Task(
+        [&](const DataObjectPtr&) -> int {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          {
+            std::lock_guard<std::mutex> guard(lock);
+            threads.insert(QThread::currentThread());
+          }
+          count++;
+          return 0;
+        },
+        "executor_test"));
+  }
+
+  ASSERT_TRUE(WaitFor([&]() { return count == kTasks; }));
+  runner.Stop();
+
+  EXPECT_GT(threads.size(), 1);
+  EXPECT_EQ(threads.count(runner.GetThread()), 0);
+}
+
+TEST(WorkStealingExecutorTest, UrgentJobsFirst) {
+  std::atomic<bool> release{false};
+  std::mutex lock;
+  std::vector<int> order;
+
+  Thread::WorkStealingExecutor ex("test", 1);
+  ex.Submit([&]() { WaitFor([&]() { return release.load(); }); });
+
+  for (int priority : {2, 1, 0, 2, 0}) {
+    ex.Submit(
+        [&, priority]() {
+          std::lock_guard<std::mutex> guard(lock);
+          order.push_back(priority);
+        },
+        priority);
+  }
+  release = true;
+
+  ASSERT_TRUE(WaitFor([&]() {
+    std::lock_guard<std::mutex> guard(lock);
+    return order.size() == 5;
+  }));
+  EXPECT_EQ(order, std::vector<int>({0, 0, 1, 2, 2}));
+}
+
+TEST(TaskTest, SerialRunnerServesPriorities) {
+  std::atomic<bool> release{false};
+  std::mutex lock;
+  std::vector<int> order;
+
+  Thread::TaskRunner runner;
+  runner.Start();
+
+  runner.PostTask(new Thread::Task(
+      [&](const DataObjectPtr&) -> int {
+        WaitFor([&]() { return release.load(); });
+        return 0;
+      },
+      "blocking_test"));
+
+  for (auto priority :
+       {Thread::Task::kPriority_Bulk, Thread::Task::kPriority_Normal,
+        Thread::Task::kPriority_Interactive}) {
+    auto* task = new Thread::Task(
+        [&, priority](const DataObjectPtr&) -> int {
+          std::lock_guard<std::mutex> guard(lock);
+          order.push_back(priority);
+          return 0;
+        },
+        "priority_test");
+    task->SetPriority(priority);
+    runner.PostTask(task);
+  }
+  release = true;
+
+  ASSERT_TRUE(WaitFor([&]() {
+    std::lock_guard<std::mutex> guard(lock);
+    return order.size() == 3;
+  }));
+  runner.Stop();
+
+  EXPECT_EQ(order, std::vector<int>({Thread::Task::kPriority_Interactive,
+                                     Thread::Task::kPriority_Normal,
+                                     Thread::Task::kPriority_Bulk}));
+}
+
+TEST(TaskTest, RunnableSeesCancellation) {
+  std::atomic<bool> started{false};
+  std::atomic<bool> canceled{false};
+
+  EXPECT_FALSE(Thread::CancellationToken::Current().IsCanceled());
+
+  Thread::TaskRunner runner(2);
+  runner.Start();
+
+  auto handler = runner.RegisterTask(
+      "cancel_test",
+      [&](const DataObjectPtr&) -> int {
+        auto token = Thread::CancellationToken::Current();
+        std::atomic<int> called{0};
+        const Thread::CancelCallback callback(token, [&]() { called++; });
+
+        started = true;
+        canceled = WaitFor([&]() { return token.IsCanceled(); });
+        EXPECT_EQ(called, 1);
+        return 0;
+      },
+      nullptr, nullptr);
+  handler.Start();
+
+  ASSERT_TRUE(WaitFor([&]() { return started.load(); }));
+  handler.Cancel();
+  ASSERT_TRUE(WaitFor([&]() { return canceled.load(); }));
+  runner.Stop();
+
+  // registered after the fact, it runs at once
+  int called = 0;
+  Thread::CancellationToken token;
+  token.Cancel();
+  const Thread::CancelCallback callback(token, [&]() { called++; });
+  EXPECT_EQ(called, 1);
+}
+
+TEST(TaskTest, CanceledBeforeStartIsDropped) {
+  std::atomic<bool> release{false};
+  std::atomic<int> count{0};
+
+  Thread::TaskRunner runner;
+  runner.Start();
+
+  runner.PostTask(new Thread::Task(
+      [&](const DataObjectPtr&) -> int {
+        WaitFor([&]() { return release.load(); });
+        return 0;
+      },
+      "blocking_test"));
+
+  auto handler = runner.RegisterTask(
+      "dropped_test",
+      [&](const DataObjectPtr&) -> int {
+        count++;
+        return 0;
+      },
+      nullptr, nullptr);
+  handler.Start();
+  handler.Cancel();
+
+  runner.PostTask(new Thread::Task(
+      [&](const DataObjectPtr&) -> int {
+        count += 10;
+        return 0;
+      },
+      "after_test"));
+  release = true;
+
+  ASSERT_TRUE(WaitFor([&]() { return count >= 10; }));
+  runner.Stop();
+  EXPECT_EQ(count, 10);
+}
+
+TEST(TaskTest, CanceledWhileQueuedOnExecutorIsEndedByItsJob) {
+  std::atomic<bool> release{false};
+  std::atomic<int> count{0};
+  std::atomic<int> destroyed{0};
+
+  // one worker, kept busy so that the canceled task waits in its deque
+  Thread::TaskRunner runner(1);
+  runner.Start();
+
+  runner.PostTask(new Thread::Task(
+      [&](const DataObjectPtr&) -> int {
+        WaitFor([&]() { return release.load(); });
+        return 0;
+      },
+      "blocking_test"));
+
+  auto handler = runner.RegisterTask(
+      "queued_cancel_test",
+      [&](const DataObjectPtr&) -> int {
+        count++;
+        return 0;
+      },
+      nullptr, nullptr);
+  QObject::connect(handler.GetTask(), &QObject::destroyed,
+                   [&]() { destroyed++; });
+  handler.Start();
+  handler.Cancel();
+  release = true;
+
+  ASSERT_TRUE(WaitFor([&]() { return destroyed.load() == 1; }));
+  runner.Stop();
+  EXPECT_EQ(count, 0);
+}
+
+TEST(TaskTest, CancelRacingItsJobEndsTaskOnce) {
+  constexpr int kTasks = 200;
+  std::atomic<int> ended{0};
+  std::atomic<int> destroyed{0};
+
+  Thread::TaskRunner runner(2);
+  runner.Start();
+
+  for (int i = 0; i < kTasks; i++) {
+    auto handler = runner.RegisterTask(
+        "race_test", [](const DataObjectPtr&) -> int { return 0; }, nullptr,
+        nullptr);
+    auto* task = handler.GetTask();
+    QObject::connect(
+        task, &Thread::Task::SignalTaskEnd, task, [&]() { ended++; },
+        Qt::DirectConnection);
+    QObject::connect(task, &QObject::destroyed, [&]() { destroyed++; });
+
+    // the job claims the task on a worker while it's canceled here, only
+    // one of them may end it
+    handler.Start();
+    std::thread canceler([&handler]() { handler.Cancel(); });
+    canceler.join();
+  }
+
+  // a task that ran ends through its callback, on this thread
+  ASSERT_TRUE(WaitFor([&]() {
+    QCoreApplication::processEvents();
+    return destroyed.load() == kTasks;
+  }));
+  runner.Stop();
+  EXPECT_EQ(ended, kTasks);
+}
+
+TEST(TaskMetricsTest, HistogramPercentiles) {
+  Thread::LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Percentile(0.5), 0);
+
+  for (int i = 1; i <= 1000; i++) histogram.Record(i);
+  EXPECT_EQ(histogram.Count(), 1000);
+
+  // the bound of the bucket, at most 12.5% above the value
+  EXPECT_EQ(histogram.Percentile(0), 1);
+  EXPECT_GE(histogram.Percentile(0.5), 500);
+  EXPECT_LE(histogram.Percentile(0.5), 563);
+  EXPECT_GE(histogram.Percentile(0.99), 990);
+  EXPECT_LE(histogram.Percentile(0.99), 1114);
+}
+
+TEST(TaskMetricsTest, RunnerCountsAndTrace) {
+  constexpr int kTasks = 8;
+  auto& metrics = Thread::TaskMetrics::GetInstance();
+  auto* stats = metrics.Runner("metrics_test");
+  metrics.SetTracing(true);
+
+  Thread::TaskRunner runner(2, "metrics_test");
+  runner.Start();
+
+  for (int i = 0; i < kTasks; i++) {
+    runner.PostTask(new Thread::Task(
+        [i](const DataObjectPtr&) -> int {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          return i % 4 == 0 ? -1 : 0;
+        },
+        "metrics_task"));
+  }
+
+  ASSERT_TRUE(
+      WaitFor([&]() { return stats->completed + stats->failed == kTasks; }));
+  runner.Stop();
+  metrics.SetTracing(false);
+
+  EXPECT_EQ(stats->completed, 6);
+  EXPECT_EQ(stats->failed, 2);
+  EXPECT_EQ(stats->queued, 0);
+  EXPECT_EQ(stats->running, 0);
+  EXPECT_EQ(stats->Task("metrics_task")->wait.Count(), kTasks);
+  EXPECT_GE(stats->Task("metrics_task")->run.Percentile(0.5), 1000);
+
+  auto task = metrics.Snapshot()["metrics_test"]
+                  .toObject()["tasks"]
+                  .toObject()["metrics_task"]
+                  .toObject();
+  EXPECT_EQ(task["count"].toInt(), kTasks);
+
+  int traced = 0;
+  auto events = QJsonDocument::fromJson(metrics.ExportChromeTrace())
+                    .object()["traceEvents"]
+                    .toArray();
+  for (const auto& event : events) {
+    const auto object = event.toObject();
+    if (object["name"] == "metrics_task" && object["ph"] == "X") traced++;
+  }
+  EXPECT_EQ(traced, kTasks);
+}
+
+TEST(TaskSchedulerTest, DelayedJobRunsOnce) {
+  using namespace std::chrono_literals;
+  Thread::TaskScheduler scheduler;
+  std::atomic<int> count{0};
+
+  QElapsedTimer timer;
+  timer.start();
+  Thread::TaskScheduler::Options options;
+  options.delay = 100ms;
+  auto id = scheduler.Schedule([&]() { count++; }, options);
+  EXPECT_TRUE(scheduler.IsScheduled(id));
+
+  ASSERT_TRUE(WaitFor([&]() { return count == 1; }));
+  EXPECT_GE(timer.elapsed(), 100);
+  EXPECT_FALSE(scheduler.IsScheduled(id));
+
+  std::this_thread::sleep_for(200ms);
+  EXPECT_EQ(count, 1);
+}
+
+TEST(TaskSchedulerTest, PeriodicJobUntilCancelled) {
+  using namespace std::chrono_literals;
+  Thread::TaskScheduler scheduler;
+  std::atomic<int> count{0};
+
+  Thread::TaskScheduler::Options options;
+  options.period = 20ms;
+  auto id = scheduler.Schedule([&]() { count++; }, options);
+
+  ASSERT_TRUE(WaitFor([&]() { return count >= 5; }));
+  EXPECT_TRUE(scheduler.Cancel(id));
+  EXPECT_FALSE(scheduler.Cancel(id));
+
+  const int stopped_at = count;
+  std::this_thread::sleep_for(100ms);
+  EXPECT_LE(count, stopped_at + 1);
+}
+
+TEST(TaskSchedulerTest, JobsRunInDueOrder) {
+  using namespace std::chrono_literals;
+  Thread::TaskScheduler scheduler;
+  std::mutex lock;
+  std::vector<int> order;
+
+  for (int i : {3, 1, 4, 2, 0}) {
+    Thread::TaskScheduler::Options options;
+    options.delay = i * 30ms;
+    scheduler.Schedule(
+        [&, i]() {
+          std::lock_guard<std::mutex> guard(lock);
+          order.push_back(i);
+        },
+        options);
+  }
+
+  ASSERT_TRUE(WaitFor([&]() {
+    std::lock_guard<std::mutex> guard(lock);
+    return order.size() == 5;
+  }));
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4}));
+}
+
+TEST(TaskSchedulerTest, CoalescedJobsRunOnce) {
+  using namespace std::chrono_literals;
+  Thread::TaskScheduler scheduler;
+  std::atomic<int> count{0};
+
+  Thread::TaskScheduler::Options options;
+  options.delay = 200ms;
+  options.coalesce_key = "flush";
+  auto id = scheduler.Schedule([&]() { count++; }, options);
+
+  // a later request merges into the pending one, an earlier one moves it
+  EXPECT_EQ(scheduler.Schedule([&]() { count++; }, options), id);
+  options.delay = 50ms;
+  EXPECT_EQ(scheduler.Schedule([&]() { count++; }, options), id);
+
+  ASSERT_TRUE(WaitFor([&]() { return count == 1; }, 150));
+  std::this_thread::sleep_for(250ms);
+  EXPECT_EQ(count, 1);
+
+  // once it ran, the key is free again
+  EXPECT_NE(scheduler.Schedule([&]() { count++; }, options), id);
+  ASSERT_TRUE(WaitFor([&]() { return count == 2; }));
+}
+
+TEST(TaskSchedulerTest, TaskRunnerPostScheduleTask) {
+  using namespace std::chrono_literals;
+  std::atomic<int> count{0};
+
+  Thread::TaskRunner runner(2);
+  runner.Start();
+
+  runner.PostScheduleTask(new Thread::Task(
+                              [&](const DataObjectPtr&) -> int {
+                                count++;
+                                return 0;
+                              },
+                              "delayed_test"),
+                          1);
+
+  Thread::TaskScheduler::Options options;
+  options.period = 30ms;
+  auto id = runner.PostScheduleTask(
+      "periodic_test",
+      [&](const DataObjectPtr&) -> int {
+        count += 10;
+        return 0;
+      },
+      options);
+
+  ASSERT_TRUE(WaitFor([&]() { return count % 10 == 1 && count > 30; }));
+  EXPECT_TRUE(runner.CancelScheduleTask(id));
+  runner.Stop();
+  EXPECT_FALSE(runner.CancelScheduleTask(id));
+}
+
+TEST(TaskSchedulerTest, TaskRunnerForgetsFiredOneShots) {
+  using namespace std::chrono_literals;
+  std::atomic<int> count{0};
+
+  Thread::TaskRunner runner(2);
+  runner.Start();
+
+  Thread::TaskScheduler::Options options;
+  options.delay = 20ms;
+  auto id = runner.PostScheduleTask(
+      "one_shot_test",
+      [&](const DataObjectPtr&) -> int {
+        count++;
+        return 0;
+      },
+      options);
+  EXPECT_TRUE(runner.IsScheduled(id));
+
+  ASSERT_TRUE(WaitFor([&]() { return count == 1; }));
+  EXPECT_FALSE(runner.IsScheduled(id));
+  EXPECT_FALSE(runner.CancelScheduleTask(id));
+
+  // due at once, it may fire before its id is known
+  options.delay = 0ms;
+  id = runner.PostScheduleTask(
+      "immediate_test",
+      [&](const DataObjectPtr&) -> int {
+        count++;
+        return 0;
+      },
+      options);
+  ASSERT_TRUE(WaitFor([&]() { return count == 2; }));
+  ASSERT_TRUE(WaitFor([&]() { return !runner.IsScheduled(id); }));
+  runner.Stop();
+}
+
+}  // namespace GpgFrontend::Test
@@ -65,6 +65,18 @@ class UISignalStation : public QObject {
    */
   void SignalKeyDatabaseRefreshDone();
 
+  /**
+   * @brief refresh only the given keys of a key database
+   *
+   */
+  void SignalKeyDatabaseKeysRefresh(int channel, QStringList key_ids);
+
+  /**
+   * @brief emit when the given keys are refreshed
+   *
+   */
+  void SignalKeyDatabaseKeysRefreshDone(int channel, QStringList key_ids);
+
   /**
    * @brief
    *
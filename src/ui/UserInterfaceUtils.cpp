@@ -106,6 +106,10 @@ CommonUtils::CommonUtils() : QWidget(nullptr) {
           &UISignalStation::SignalKeyDatabaseRefresh, this,
           &CommonUtils::slot_update_key_status);
 
+  connect(UISignalStation::GetInstance(),
+          &UISignalStation::SignalKeyDatabaseKeysRefresh, this,
+          &CommonUtils::slot_update_keys_status);
+
   connect(this, &CommonUtils::SignalRestartApplication,
           UISignalStation::GetInstance(),
           &UISignalStation::SignalRestartApplication);
@@ -195,13 +199,16 @@ void CommonUtils::SlotImportKeys(QWidget *parent, int channel,
   auto *connection = new QMetaObject::Connection;
   *connection =
       connect(UISignalStation::GetInstance(),
-              &UISignalStation::SignalKeyDatabaseRefreshDone, this, [=]() {
+              &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+              [=](int, const QStringList &) {
                 (new KeyImportDetailDialog(channel, info, parent));
                 QObject::disconnect(*connection);
                 delete connection;
               });
 
-  emit SignalKeyStatusUpdated();
+  emit UISignalStation::GetInstance() -> SignalKeyDatabaseKeysRefresh(
+      channel, info != nullptr ? info->ImportedKeyFingerprints()
+                               : QStringList{});
 }
 
 void CommonUtils::SlotImportKeyFromFile(QWidget *parent, int channel) {
@@ -489,6 +496,27 @@ void CommonUtils::slot_update_key_status() {
       ->PostTask(refresh_task);
 }
 
+void CommonUtils::slot_update_keys_status(int channel,
+                                          const QStringList &key_ids) {
+  auto *refresh_task = new Thread::Task(
+      [=](DataObjectPtr) -> int {
+        LOG_D() << "refreshing keys at channel: " << channel
+                << "keys: " << key_ids;
+        GpgAbstractKeyGetter::GetInstance(channel).UpdateCache(key_ids);
+        return 0;
+      },
+      "update_keys_task");
+
+  connect(refresh_task, &Thread::Task::SignalTaskEnd, this, [=]() {
+    emit UISignalStation::GetInstance()->SignalKeyDatabaseKeysRefreshDone(
+        channel, key_ids);
+  });
+
+  Thread::TaskRunnerGetter::GetInstance()
+      .GetTaskRunner(Thread::TaskRunnerGetter::kTaskRunnerType_GPG)
+      ->PostTask(refresh_task);
+}
+
 void CommonUtils::slot_update_key_from_server_finished(
     int channel, bool success, QString err_msg, QByteArray buffer,
     QSharedPointer<GpgImportInformation> info) {
@@ -498,17 +526,20 @@ void CommonUtils::slot_update_key_from_server_finished(
     return;
   }
 
-  // refresh the key database
-  emit UISignalStation::GetInstance() -> SignalKeyDatabaseRefresh();
-
   auto *connection = new QMetaObject::Connection;
   *connection =
       connect(UISignalStation::GetInstance(),
-              &UISignalStation::SignalKeyDatabaseRefreshDone, this, [=]() {
+              &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+              [=](int, const QStringList &) {
                 (new KeyImportDetailDialog(channel, info, this));
                 QObject::disconnect(*connection);
                 delete connection;
               });
+
+  // refresh the imported keys
+  emit UISignalStation::GetInstance() -> SignalKeyDatabaseKeysRefresh(
+      channel, info != nullptr ? info->ImportedKeyFingerprints()
+                               : QStringList{});
 }
 
 void CommonUtils::SlotRestartApplication(int code) {
@@ -280,6 +280,12 @@ class CommonUtils : public QWidget {
    */
   void slot_update_key_status();
 
+  /**
+   * @brief update only the given keys when signal is emitted
+   *
+   */
+  void slot_update_keys_status(int channel, const QStringList &key_ids);
+
   /**
    * @brief
    *
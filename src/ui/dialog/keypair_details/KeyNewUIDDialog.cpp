@@ -71,9 +71,10 @@ KeyNewUIDDialog::KeyNewUIDDialog(int channel, GpgKeyPtr key, QWidget* parent)
   this->setAttribute(Qt::WA_DeleteOnClose, true);
   this->setModal(true);
 
-  connect(this, &KeyNewUIDDialog::SignalUIDCreated,
-          UISignalStation::GetInstance(),
-          &UISignalStation::SignalKeyDatabaseRefresh);
+  connect(this, &KeyNewUIDDialog::SignalUIDCreated, this, [=]() {
+    emit UISignalStation::GetInstance()->SignalKeyDatabaseKeysRefresh(
+        current_gpg_context_channel_, {m_key_->Fingerprint()});
+  });
   connect(this, &KeyNewUIDDialog::SignalUIDCreated, this,
           &KeyNewUIDDialog::close);
 }
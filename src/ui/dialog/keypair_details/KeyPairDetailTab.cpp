@@ -166,6 +166,9 @@ KeyPairDetailTab::KeyPairDetailTab(int channel, GpgKeyPtr key, QWidget* parent)
   connect(UISignalStation::GetInstance(),
           &UISignalStation::SignalKeyDatabaseRefreshDone, this,
           &KeyPairDetailTab::slot_refresh_key);
+  connect(UISignalStation::GetInstance(),
+          &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+          &KeyPairDetailTab::slot_refresh_key);
 
   slot_refresh_key_info();
   setAttribute(Qt::WA_DeleteOnClose, true);
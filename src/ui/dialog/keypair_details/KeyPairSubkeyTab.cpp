@@ -161,6 +161,12 @@ KeyPairSubkeyTab::KeyPairSubkeyTab(int channel, GpgKeyPtr key, QWidget* parent)
   connect(UISignalStation::GetInstance(),
           &UISignalStation::SignalKeyDatabaseRefreshDone, this,
           &KeyPairSubkeyTab::slot_refresh_subkey_list);
+  connect(UISignalStation::GetInstance(),
+          &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+          &KeyPairSubkeyTab::slot_refresh_key_info);
+  connect(UISignalStation::GetInstance(),
+          &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+          &KeyPairSubkeyTab::slot_refresh_subkey_list);
 
   base_layout->setContentsMargins(0, 0, 0, 0);
 
@@ -107,10 +107,14 @@ KeyPairUIDTab::KeyPairUIDTab(int channel, GpgKeyPtr key, QWidget* parent)
   connect(UISignalStation::GetInstance(),
           &UISignalStation::SignalKeyDatabaseRefreshDone, this,
           &KeyPairUIDTab::slot_refresh_key);
+  connect(UISignalStation::GetInstance(),
+          &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+          &KeyPairUIDTab::slot_refresh_key);
 
-  connect(this, &KeyPairUIDTab::SignalUpdateUIDInfo,
-          UISignalStation::GetInstance(),
-          &UISignalStation::SignalKeyDatabaseRefresh);
+  connect(this, &KeyPairUIDTab::SignalUpdateUIDInfo, this, [=]() {
+    emit UISignalStation::GetInstance()->SignalKeyDatabaseKeysRefresh(
+        current_gpg_context_channel_, {m_key_->Fingerprint()});
+  });
 
   setLayout(vbox_layout);
   setAttribute(Qt::WA_DeleteOnClose, true);
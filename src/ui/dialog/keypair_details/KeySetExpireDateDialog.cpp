@@ -107,9 +107,11 @@ void KeySetExpireDateDialog::init() {
           &KeySetExpireDateDialog::slot_non_expired_checked);
   connect(ui_->button_box_, &QDialogButtonBox::accepted, this,
           &KeySetExpireDateDialog::slot_confirm);
-  connect(this, &KeySetExpireDateDialog::SignalKeyExpireDateUpdated,
-          UISignalStation::GetInstance(),
-          &UISignalStation::SignalKeyDatabaseRefresh);
+  connect(this, &KeySetExpireDateDialog::SignalKeyExpireDateUpdated, this,
+          [=]() {
+            emit UISignalStation::GetInstance()->SignalKeyDatabaseKeysRefresh(
+                current_gpg_context_channel_, {m_key_->Fingerprint()});
+          });
 
   if (m_key_->ExpirationTime().toSecsSinceEpoch() == 0) {
     ui_->noExpirationCheckBox->setCheckState(Qt::Checked);
@@ -399,8 +399,7 @@ void FileTreeView::slot_show_custom_context_menu(const QPoint& point) {
                                        file_info.isWritable());
     action_create_empty_file_->setEnabled(file_info.isDir() &&
                                           file_info.isWritable());
-    action_calculate_hash_->setEnabled(file_info.isFile() &&
-                                       file_info.isReadable());
+    action_calculate_hash_->setEnabled(file_info.isReadable());
   } else {
     action_create_empty_file_->setEnabled(true);
     action_make_directory_->setEnabled(true);
@@ -410,14 +409,14 @@ void FileTreeView::slot_show_custom_context_menu(const QPoint& point) {
 }
 
 void FileTreeView::slot_calculate_hash() {
-  if (GetSelectedPaths().empty()) return;
-  auto selected_path = GetSelectedPaths().front();
+  auto selected_paths = GetSelectedPaths();
+  if (selected_paths.empty()) return;
 
   GpgOperaHelper::WaitForOpera(
       this->parentWidget(), tr("Calculating"), [=](const OperaWaitingHd& hd) {
         RunOperaAsync(
             [=](const DataObjectPtr& data_object) {
-              data_object->Swap({CalculateHash(selected_path)});
+              data_object->Swap({CalculateHashes(selected_paths)});
               return 0;
             },
             [hd](int rtn, const DataObjectPtr& data_object) {
@@ -237,6 +237,9 @@ void KeyList::init() {
   connect(UISignalStation::GetInstance(),
           &UISignalStation::SignalKeyDatabaseRefreshDone, this,
           &KeyList::SlotRefresh);
+  connect(UISignalStation::GetInstance(),
+          &UISignalStation::SignalKeyDatabaseKeysRefreshDone, this,
+          &KeyList::SlotRefreshKeys);
   connect(UISignalStation::GetInstance(), &UISignalStation::SignalUIRefresh,
           this, &KeyList::SlotRefreshUI);
 
@@ -333,6 +336,24 @@ void KeyList::SlotRefresh() {
   this->SlotRefreshUI();
 }
 
+void KeyList::SlotRefreshKeys(int channel, const QStringList& key_ids) {
+  if (channel != current_gpg_context_channel_ || model_ == nullptr) return;
+
+  auto keys = GpgAbstractKeyPtrList{};
+  auto removed_key_ids = QStringList{};
+  for (const auto& key_id : key_ids) {
+    auto key = GpgKeyGetter::GetInstance(channel).GetKeyPtr(key_id);
+    if (key == nullptr) {
+      removed_key_ids.append(key_id);
+      continue;
+    }
+    keys.push_back(key);
+  }
+
+  model_->UpdateKeys(keys, removed_key_ids);
+  this->SlotRefreshUI();
+}
+
 void KeyList::SlotRefreshUI() {
   emit SignalRefreshStatusBar(tr("Key List Refreshed."), 1000);
   ui_->refreshKeyListButton->setDisabled(false);
@@ -242,6 +242,12 @@ class KeyList : public QWidget {
    */
   void SlotRefresh();
 
+  /**
+   * @brief patch the rows of the given keys without reloading the model
+   *
+   */
+  void SlotRefreshKeys(int channel, const QStringList& key_ids);
+
   /**
    * @brief
    *